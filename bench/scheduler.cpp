@@ -0,0 +1,83 @@
+// Per-update cost of the scheduler policies: sessions wait for messages of
+// their user, every update wakes exactly one of them and is handled before
+// the next one is sent.
+
+#include <atgbot/awaitables/message.hpp>
+#include <atgbot/tools/scheduler.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace ATgBot::Awaitables;
+using namespace ATgBot::Tools;
+
+namespace {
+
+constexpr int kSessions = 1000;
+constexpr int kUpdates = 100000;
+
+ATgBot::Coroutine Listener(std::atomic<int>& received, int64_t user) {
+  while (true) {
+    co_await getMessageU(user);
+    ++received;
+  }
+}
+
+std::vector<TgBot::Message::Ptr> makeUpdates() {
+  std::vector<TgBot::Message::Ptr> updates;
+  for (int i = 0; i < kUpdates; ++i) {
+    auto message = std::make_shared<TgBot::Message>();
+    message->from = std::make_shared<TgBot::User>();
+    message->from->id = i % kSessions;
+    message->chat = std::make_shared<TgBot::Chat>();
+    message->chat->id = i % kSessions;
+    updates.push_back(message);
+  }
+  return updates;
+}
+
+// one worker, so a session has re-armed its filter before the next session
+// is resumed
+template <class Policy>
+double measure(const std::vector<TgBot::Message::Ptr>& updates) {
+  std::atomic<int> received = 0;
+  BasicScheduler<Policy> scheduler(1);
+  for (int i = 0; i < kSessions; ++i)
+    scheduler.pushCoro(Listener(received, i));
+  if constexpr (Policy::kThreaded) {
+    while (scheduler.botStats(0).resumed < kSessions)
+      std::this_thread::yield();
+  } else {
+    scheduler.runPending();
+  }
+
+  auto begin = std::chrono::steady_clock::now();
+  for (int i = 0; i < kUpdates; ++i) {
+    scheduler.handleMessage(updates[i]);
+    if constexpr (Policy::kThreaded) {
+      while (received <= i)
+        std::this_thread::yield();
+    } else {
+      scheduler.runPending();
+    }
+  }
+  auto end = std::chrono::steady_clock::now();
+
+  scheduler.drain(std::chrono::seconds(5));
+  return std::chrono::duration<double, std::nano>(end - begin).count() /
+         kUpdates;
+}
+
+}  // namespace
+
+int main() {
+  auto updates = makeUpdates();
+  std::cout << "multi-threaded:  " << measure<MultiThreaded>(updates)
+            << " ns/update\n";
+  std::cout << "single-threaded: " << measure<SingleThreaded>(updates)
+            << " ns/update\n";
+  return 0;
+}
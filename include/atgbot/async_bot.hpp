@@ -1,15 +1,37 @@
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <functional>
+#include <memory>
+#include <thread>
 #include <unordered_map>
+#include <unordered_set>
 
+#include "atgbot/tools/apicache.hpp"
+#include "atgbot/tools/inlinequeries.hpp"
+#include "atgbot/tools/log.hpp"
+#include "atgbot/tools/spawnoptions.hpp"
 #include "atgbot/tools/scheduler.hpp"
 #include "atgbot/tools/session.hpp"
+#include "atgbot/tools/sharding.hpp"
+#include "atgbot/tools/updatecheckpoint.hpp"
+#include "atgbot/tools/updatewindow.hpp"
 
 namespace ATgBot {
 
-class AsyncBot {
+/**
+ * @brief Telegram bot running its handlers as coroutines.
+ *
+ * @tparam Policy Threading policy of the scheduler. With SingleThreaded the
+ * sessions run inside run() on the polling thread, which must be the thread
+ * that created the scheduler.
+ */
+template <class Policy>
+class BasicAsyncBot {
  public:
+  using Scheduler = Tools::BasicScheduler<Policy>;
+
   using MessageListener = std::function<Coroutine(TgBot::Message::Ptr)>;
   using InlineQueryListener = std::function<Coroutine(TgBot::InlineQuery::Ptr)>;
   using ChosenInlineResultListener =
@@ -27,47 +49,217 @@ class AsyncBot {
   using ChatJoinRequestListener =
       std::function<Coroutine(TgBot::ChatJoinRequest::Ptr)>;
 
-  AsyncBot(TgBot::Bot& bot) : m_bot(bot) {
+  enum class UpdateType {
+    kMessage,
+    kCommand,
+    kCallbackQuery,
+    kEditedMessage,
+    kInlineQuery,
+    kChosenInlineResult,
+    kShippingQuery,
+    kPreCheckoutQuery,
+    kPoll,
+    kPollAnswer,
+    kChatMember,
+    kChatJoinRequest,
+    kCount
+  };
+
+  //runs the bot on its own scheduler
+  BasicAsyncBot(TgBot::Bot& bot)
+      : BasicAsyncBot(bot, std::make_unique<Scheduler>(), nullptr) {}
+
+  /**
+   * @brief Runs the bot on a scheduler shared with other bots.
+   *
+   * The scheduler must outlive the bot, and the bot must be drained before
+   * it is destroyed.
+   */
+  BasicAsyncBot(TgBot::Bot& bot, Scheduler& scheduler)
+      : BasicAsyncBot(bot, nullptr, &scheduler) {}
+
+  BasicAsyncBot(const BasicAsyncBot&) = delete;
+  BasicAsyncBot& operator=(const BasicAsyncBot&) = delete;
+
+ private:
+  BasicAsyncBot(TgBot::Bot& bot, std::unique_ptr<Scheduler> own_scheduler,
+                Scheduler* shared_scheduler)
+      : m_bot(bot),
+        m_own_scheduler(std::move(own_scheduler)),
+        m_scheduler(shared_scheduler ? *shared_scheduler : *m_own_scheduler),
+        m_bot_id(m_scheduler.addBot()),
+        m_api_cache(bot.getApi()) {
+    lane(UpdateType::kCallbackQuery) = {Tools::Priority::kHigh,
+                                        std::chrono::seconds(5)};
+    lane(UpdateType::kInlineQuery).priority = Tools::Priority::kHigh;
+    lane(UpdateType::kShippingQuery).priority = Tools::Priority::kCritical;
+    lane(UpdateType::kPreCheckoutQuery) = {Tools::Priority::kCritical,
+                                           std::chrono::seconds(10)};
+
     m_bot.getEvents().onAnyMessage(
-        std::bind(&AsyncBot::onMessage, this, std::placeholders::_1));
-    m_bot.getEvents().onCallbackQuery(
-        std::bind(&AsyncBot::onCallbackQuery, this, std::placeholders::_1));
-    m_bot.getEvents().onEditedMessage(
-        std::bind(&AsyncBot::onEditedMessage, this, std::placeholders::_1));
+        std::bind(&BasicAsyncBot::onMessage, this, std::placeholders::_1));
+    m_bot.getEvents().onCallbackQuery(std::bind(
+        &BasicAsyncBot::onCallbackQuery, this, std::placeholders::_1));
+    m_bot.getEvents().onEditedMessage(std::bind(
+        &BasicAsyncBot::onEditedMessage, this, std::placeholders::_1));
     m_bot.getEvents().onInlineQuery(
-        std::bind(&AsyncBot::onInlineQuery, this, std::placeholders::_1));
+        std::bind(&BasicAsyncBot::onInlineQuery, this, std::placeholders::_1));
     m_bot.getEvents().onChosenInlineResult(std::bind(
-        &AsyncBot::onChosenInlineResult, this, std::placeholders::_1));
-    m_bot.getEvents().onShippingQuery(
-        std::bind(&AsyncBot::onShippingQuery, this, std::placeholders::_1));
-    m_bot.getEvents().onPreCheckoutQuery(
-        std::bind(&AsyncBot::onPreCheckoutQuery, this, std::placeholders::_1));
+        &BasicAsyncBot::onChosenInlineResult, this, std::placeholders::_1));
+    m_bot.getEvents().onShippingQuery(std::bind(
+        &BasicAsyncBot::onShippingQuery, this, std::placeholders::_1));
+    m_bot.getEvents().onPreCheckoutQuery(std::bind(
+        &BasicAsyncBot::onPreCheckoutQuery, this, std::placeholders::_1));
     m_bot.getEvents().onPoll(
-        std::bind(&AsyncBot::onPoll, this, std::placeholders::_1));
+        std::bind(&BasicAsyncBot::onPoll, this, std::placeholders::_1));
     m_bot.getEvents().onPollAnswer(
-        std::bind(&AsyncBot::onPollAnswer, this, std::placeholders::_1));
+        std::bind(&BasicAsyncBot::onPollAnswer, this, std::placeholders::_1));
     m_bot.getEvents().onChatMember(
-        std::bind(&AsyncBot::onChatMember, this, std::placeholders::_1));
-    m_bot.getEvents().onChatJoinRequest(
-        std::bind(&AsyncBot::onChatJoinRequest, this, std::placeholders::_1));
+        std::bind(&BasicAsyncBot::onChatMember, this, std::placeholders::_1));
+    m_bot.getEvents().onChatJoinRequest(std::bind(
+        &BasicAsyncBot::onChatJoinRequest, this, std::placeholders::_1));
   }
 
+ public:
+  /**
+   * @brief Runs the long poll until drain() is called.
+   *
+   * Every update is dispatched once: duplicates are dropped by the update id
+   * window. The server confirms every update below the poll offset, so the
+   * offset stops at the lowest update whose sessions were not resumed for
+   * it yet; the updates after it come back and are dropped until it is
+   * finished. If a checkpoint is set, that offset is committed after every
+   * batch. Returns after the in-flight sessions are drained.
+   */
   void run() {
-    assert(!m_commands.empty());
-    try {
-      PLOGI << "Bot username: " << m_bot.getApi().getMe()->username.c_str();
-      PLOGI << "Telegram bot longpoll started";
-      TgBot::TgLongPoll longPoll(m_bot);
-      while (true) {
-        longPoll.start();
-      }
-    } catch (TgBot::TgException& e) {
-      PLOGE << e.what();
-      throw;
-    }
+    runLoop(
+        [this]() {
+          auto updates = m_bot.getApi().getUpdates(pollOffset(), kPollLimit,
+                                                   kPollTimeout, nullptr);
+          //only updates that are still in flight came back
+          if (!updates.empty() && updates.back()->updateId < m_next_update)
+            std::this_thread::sleep_for(kHeldBackSleep);
+          return updates;
+        },
+        [](const TgBot::Update::Ptr&) {});
   }
 
-  void addCoro(Coroutine&& coro) { m_scheduler.pushCoro(std::move(coro)); }
+  /**
+   * @brief Runs the bot on the updates of one shard until drain() is called.
+   *
+   * The long poll is owned by a ShardIngest in another process. An update
+   * leaves the ring of the shard once it is dispatched, so a worker that
+   * crashes before gets it again on restart.
+   */
+  void run(Tools::ShardWorker& worker) {
+    runLoop(
+        [&worker]() {
+          auto updates = worker.poll(kPollLimit);
+          if (updates.empty())
+            std::this_thread::sleep_for(kShardIdleSleep);
+          return updates;
+        },
+        [&worker](const TgBot::Update::Ptr&) { worker.acknowledge(1); });
+  }
+
+  /**
+   * @brief Stores the long-poll offset in a file.
+   *
+   * The offset stops at the lowest update whose sessions were not resumed
+   * for it yet, the same offset run() polls with, so a restart gets that
+   * update again from the server. Must be called before run().
+   */
+  void setCheckpoint(const std::string& path) {
+    m_checkpoint = std::make_unique<Tools::UpdateCheckpoint>(path);
+    m_seen_updates = m_checkpoint->window();
+    m_next_update = m_checkpoint->offset();
+  }
+
+  /**
+   * @brief Stops polling; run() returns after in-flight sessions finish or
+   * the timeout expires. Remaining sessions are cancelled.
+   */
+  void drain(Tools::DefaultTimer::duration timeout) {
+    m_drain_timeout = timeout;
+    m_polling = false;
+  }
+
+  void addCoro(Coroutine&& coro, Tools::SpawnOptions options = {}) {
+    options.bot = m_bot_id;
+    if (options.origin.empty())
+      options.origin = "addCoro";
+    m_scheduler.pushCoro(std::move(coro), options);
+  }
+
+  //limits the live sessions of this bot on a shared scheduler
+  void setSessionQuota(std::size_t max_sessions) {
+    m_scheduler.setBotQuota(m_bot_id, max_sessions);
+  }
+
+  typename Scheduler::BotStats getStats() {
+    return m_scheduler.botStats(m_bot_id);
+  }
+
+  //priority class of handlers spawned for the update type
+  void setUpdatePriority(UpdateType type, Tools::Priority priority) {
+    lane(type).priority = priority;
+  }
+
+  //deadline of handlers relative to the update arrival, zero disables it
+  void setUpdateDeadline(UpdateType type, Tools::DefaultTimer::duration d) {
+    lane(type).deadline = d;
+  }
+
+  /**
+   * @brief Answers a callback query with an empty answer if its handler is
+   * still running shortly before the callback query deadline and has not
+   * answered it through Awaitables::answerCallbackQuery.
+   */
+  void setCallbackQueryAutoAnswer(bool enabled) {
+    m_callback_auto_answer = enabled;
+  }
+
+  /**
+   * @brief Runs only the latest inline query of every user: earlier queries
+   * of the same poll batch are skipped and the running handler of an older
+   * query is cancelled.
+   */
+  void setInlineQueryDebounce(bool enabled) { m_inline_debounce = enabled; }
+
+  /**
+   * @brief Runs message, command and edited message handlers on the polling
+   * thread until they first await something; a session is only created for
+   * handlers that suspend. Long synchronous handlers delay polling.
+   */
+  void setHandlerFastPath(bool enabled) { m_fast_path = enabled; }
+
+  /**
+   * @brief Answers repeated inline queries from the results given to
+   * answerInlineQuery() instead of running the handler.
+   *
+   * Must be called before run().
+   */
+  void setInlineResultCache(
+      std::size_t max_entries = Tools::InlineResultCache::kDefaultMaxEntries,
+      std::size_t max_results = Tools::InlineResultCache::kDefaultMaxResults) {
+    m_inline_cache =
+        std::make_unique<Tools::InlineResultCache>(max_entries, max_results);
+  }
+
+  //answers the query and caches results that are not personal for equal
+  //queries for cache_time seconds
+  bool answerInlineQuery(
+      const TgBot::InlineQuery::Ptr& query,
+      const std::vector<TgBot::InlineQueryResult::Ptr>& results,
+      std::int32_t cache_time = 300, bool is_personal = false,
+      const std::string& next_offset = "") {
+    bool answered = m_bot.getApi().answerInlineQuery(
+        query->id, results, cache_time, is_personal, next_offset);
+    if (m_inline_cache && !is_personal)
+      m_inline_cache->store(query->query, query->offset,
+                            {results, next_offset, cache_time});
+    return answered;
+  }
 
   void addCommand(const std::string& command, MessageListener handler) {
     m_commands[command] = handler;
@@ -75,6 +267,22 @@ class AsyncBot {
 
   const TgBot::Api& getApi() const { return m_bot.getApi(); };
 
+  //cached getChat, getChatMember and getChatAdministrators, kept fresh by
+  //chat member updates and join requests
+  Tools::ApiCache& getApiCache() { return m_api_cache; }
+
+  void setSessionLimits(const Tools::SessionLimits& limits) {
+    m_scheduler.setSessionLimits(limits);
+  }
+
+  //queue bounds and admission control of the scheduler; handlers are shed
+  //by the priority set with setUpdatePriority()
+  void setLoadLimits(const Tools::LoadLimits& limits) {
+    m_scheduler.setLoadLimits(limits);
+  }
+
+  Tools::LoadStats getLoadStats() { return m_scheduler.loadStats(); }
+
   void setMessageHandler(MessageListener handler) {
     m_message_handler = handler;
   }
@@ -120,108 +328,301 @@ class AsyncBot {
  private:
 
   void onMessage(const TgBot::Message::Ptr message) {
-    PLOGD << "Bot received new message";
-    m_scheduler.handleMessage(message);
+    ATGBOT_LOGD << "Bot received new message";
+    m_scheduler.handleMessage(message, m_bot_id);
 
     if (m_message_handler) {
-      m_scheduler.pushCoro(m_message_handler(message));
+      startHandler(m_message_handler(message),
+                   spawnOptions(UpdateType::kMessage));
     }
 
     if (!message->text.empty()) {
-      PLOGD << "Bot received new command";
+      ATGBOT_LOGD << "Bot received new command";
       for (auto command : m_commands)
-        if (AsyncBot::checkCommand(command.first, message->text))
-          m_scheduler.pushCoro(command.second(message));
+        if (BasicAsyncBot::checkCommand(command.first, message->text))
+          startHandler(command.second(message),
+                       spawnOptions(UpdateType::kCommand, command.first));
     }
   }
 
   void onCallbackQuery(const TgBot::CallbackQuery::Ptr query) {
-    PLOGD << "Bot received callback query";
-    m_scheduler.handleCallbackQuery(query);
+    ATGBOT_LOGD << "Bot received callback query";
+    m_scheduler.handleCallbackQuery(query, m_bot_id);
     if (m_callback_handler) {
-      m_scheduler.pushCoro(m_callback_handler(query));
+      m_scheduler.pushCoro(m_callback_handler(query),
+                           callbackQueryOptions(query));
     }
   }
 
   void onEditedMessage(const TgBot::Message::Ptr message) {
-    PLOGD << "Bot received edited message";
-    m_scheduler.handleEditedMessage(message);
+    ATGBOT_LOGD << "Bot received edited message";
+    m_scheduler.handleEditedMessage(message, m_bot_id);
     if (m_edited_message_handler) {
-      m_scheduler.pushCoro(m_edited_message_handler(message));
+      startHandler(m_edited_message_handler(message),
+                   spawnOptions(UpdateType::kEditedMessage));
     }
   }
 
   void onInlineQuery(const TgBot::InlineQuery::Ptr query) {
-    PLOGD << "Bot received inline query";
-    m_scheduler.handleInlineQuery(query);
-    if (m_inline_query_handler) {
-      m_scheduler.pushCoro(m_inline_query_handler(query));
+    ATGBOT_LOGD << "Bot received inline query";
+    m_scheduler.handleInlineQuery(query, m_bot_id);
+    if (!m_inline_query_handler)
+      return;
+
+    if (m_inline_cache) {
+      if (auto answer = m_inline_cache->find(query->query, query->offset)) {
+        m_scheduler.pushCoro(
+            answerFromCache(query, std::move(*answer)),
+            spawnOptions(UpdateType::kInlineQuery, "inline result cache"));
+        return;
+      }
+    }
+    auto session = m_scheduler.spawn(m_inline_query_handler(query),
+                                     spawnOptions(UpdateType::kInlineQuery));
+    if (session && m_inline_debounce && query->from) {
+      if (auto previous = m_inline_debouncer.replace(query->from->id, session))
+        m_scheduler.discard(previous);
     }
   }
 
+  Coroutine answerFromCache(TgBot::InlineQuery::Ptr query,
+                            Tools::InlineResultCache::Answer answer) {
+    try {
+      m_bot.getApi().answerInlineQuery(query->id, answer.results,
+                                       answer.cache_time, false,
+                                       answer.next_offset);
+    } catch (TgBot::TgException& e) {
+      ATGBOT_LOGD << "Cached inline query answer failed: " << e.what();
+    }
+    co_return;
+  }
+
   void onChosenInlineResult(const TgBot::ChosenInlineResult::Ptr result) {
-    PLOGD << "Bot received chosen inline result";
-    m_scheduler.handleChosenInlineResult(result);
+    ATGBOT_LOGD << "Bot received chosen inline result";
+    m_scheduler.handleChosenInlineResult(result, m_bot_id);
     if (m_chosen_inline_result_handler) {
-      m_scheduler.pushCoro(m_chosen_inline_result_handler(result));
+      m_scheduler.pushCoro(m_chosen_inline_result_handler(result),
+                           spawnOptions(UpdateType::kChosenInlineResult));
     }
   }
 
   void onShippingQuery(const TgBot::ShippingQuery::Ptr query) {
-    PLOGD << "Bot received shipping query";
-    m_scheduler.handleShippingQuery(query);
+    ATGBOT_LOGD << "Bot received shipping query";
+    m_scheduler.handleShippingQuery(query, m_bot_id);
     if (m_shipping_query_handler) {
-      m_scheduler.pushCoro(m_shipping_query_handler(query));
+      m_scheduler.pushCoro(m_shipping_query_handler(query),
+                           spawnOptions(UpdateType::kShippingQuery));
     }
   }
 
   void onPreCheckoutQuery(const TgBot::PreCheckoutQuery::Ptr query) {
-    PLOGD << "Bot received pre-checkout query";
-    m_scheduler.handlePreCheckoutQuery(query);
+    ATGBOT_LOGD << "Bot received pre-checkout query";
+    m_scheduler.handlePreCheckoutQuery(query, m_bot_id);
     if (m_pre_checkout_query_handler) {
-      m_scheduler.pushCoro(m_pre_checkout_query_handler(query));
+      m_scheduler.pushCoro(m_pre_checkout_query_handler(query),
+                           spawnOptions(UpdateType::kPreCheckoutQuery));
     }
   }
 
   void onPoll(const TgBot::Poll::Ptr poll) {
-    PLOGD << "Bot received poll update";
-    m_scheduler.handlePoll(poll);
+    ATGBOT_LOGD << "Bot received poll update";
+    m_scheduler.handlePoll(poll, m_bot_id);
     if (m_poll_handler) {
-      m_scheduler.pushCoro(m_poll_handler(poll));
+      m_scheduler.pushCoro(m_poll_handler(poll),
+                           spawnOptions(UpdateType::kPoll));
     }
   }
 
   void onPollAnswer(const TgBot::PollAnswer::Ptr answer) {
-    PLOGD << "Bot received poll answer";
-    m_scheduler.handlePollAnswer(answer);
+    ATGBOT_LOGD << "Bot received poll answer";
+    m_scheduler.handlePollAnswer(answer, m_bot_id);
     if (m_poll_answer_handler) {
-      m_scheduler.pushCoro(m_poll_answer_handler(answer));
+      m_scheduler.pushCoro(m_poll_answer_handler(answer),
+                           spawnOptions(UpdateType::kPollAnswer));
     }
   }
 
   void onChatMember(const TgBot::ChatMemberUpdated::Ptr update) {
-    PLOGD << "Bot received chat member update";
-    m_scheduler.handleChatMember(update);
+    ATGBOT_LOGD << "Bot received chat member update";
+    m_api_cache.invalidate(update);
+    m_scheduler.handleChatMember(update, m_bot_id);
     if (m_chat_member_handler) {
-      m_scheduler.pushCoro(m_chat_member_handler(update));
+      m_scheduler.pushCoro(m_chat_member_handler(update),
+                           spawnOptions(UpdateType::kChatMember));
     }
   }
 
   void onChatJoinRequest(const TgBot::ChatJoinRequest::Ptr request) {
-    PLOGD << "Bot received chat join request";
-    m_scheduler.handleChatJoinRequest(request);
+    ATGBOT_LOGD << "Bot received chat join request";
+    m_api_cache.invalidate(request);
+    m_scheduler.handleChatJoinRequest(request, m_bot_id);
     if (m_chat_join_request_handler) {
-      m_scheduler.pushCoro(m_chat_join_request_handler(request));
+      m_scheduler.pushCoro(m_chat_join_request_handler(request),
+                           spawnOptions(UpdateType::kChatJoinRequest));
     }
   }
 
  private:
+  struct UpdateLane {
+    Tools::Priority priority = Tools::Priority::kNormal;
+    Tools::DefaultTimer::duration deadline =
+        Tools::DefaultTimer::duration::zero();
+  };
+
+  UpdateLane& lane(UpdateType type) {
+    return m_lanes[static_cast<std::size_t>(type)];
+  }
+
+  //origin defaults to the handler of the update type
+  Tools::SpawnOptions spawnOptions(UpdateType type, std::string origin = {}) {
+    const UpdateLane& l = lane(type);
+    if (origin.empty())
+      origin = kHandlerNames[static_cast<std::size_t>(type)];
+    Tools::SpawnOptions options{
+        .priority = l.priority, .bot = m_bot_id, .origin = std::move(origin)};
+    if (l.deadline != Tools::DefaultTimer::duration::zero())
+      options.deadline = m_scheduler.now() + l.deadline;
+    return options;
+  }
+
+  void startHandler(Coroutine&& coro, const Tools::SpawnOptions& options) {
+    if (m_fast_path)
+      m_scheduler.runInline(std::move(coro), options);
+    else
+      m_scheduler.pushCoro(std::move(coro), options);
+  }
+
+  Tools::SpawnOptions callbackQueryOptions(
+      const TgBot::CallbackQuery::Ptr& query) {
+    auto options = spawnOptions(UpdateType::kCallbackQuery);
+    if (m_callback_auto_answer &&
+        options.deadline.time_since_epoch().count() != 0) {
+      options.on_deadline = [&api = m_bot.getApi(), id = query->id]() {
+        try {
+          api.answerCallbackQuery(id);
+        } catch (TgBot::TgException& e) {
+          ATGBOT_LOGD << "Callback query auto answer failed: " << e.what();
+        }
+      };
+    }
+    return options;
+  }
+
+  //routes the whole batch before any session is woken
+  //handled is called for every update of the batch once it is dispatched
+  template <typename H>
+  void dispatchBatch(const std::vector<TgBot::Update::Ptr>& updates,
+                     H handled) {
+    std::unordered_set<std::int32_t> superseded;
+    if (m_inline_debounce)
+      superseded = Tools::InlineDebouncer::supersededInBatch(updates);
+    auto batch = m_scheduler.batch();
+    for (auto& update : updates) {
+      m_next_update = std::max(m_next_update, update->updateId + 1);
+      if (!m_seen_updates.insert(update->updateId)) {
+        ATGBOT_LOGD << "Bot dropped duplicate update " << update->updateId;
+        handled(update);
+        continue;
+      }
+      if (superseded.contains(update->updateId)) {
+        ATGBOT_LOGD << "Bot skipped superseded inline query";
+      } else {
+        Tools::Trace::UpdateScope trace(update->updateId);
+        batch.setUpdate(update->updateId);
+        m_bot.getEventHandler().handleUpdate(update);
+      }
+      handled(update);
+    }
+  }
+
+  //unfinished updates are left out of the window, so a restart does not
+  //drop them as duplicates
+  void commitCheckpoint() {
+    if (!m_checkpoint)
+      return;
+    auto window = m_seen_updates;
+    for (auto update : m_scheduler.unfinishedUpdates(m_bot_id))
+      window.erase(update);
+    m_checkpoint->commit(pollOffset(), window);
+  }
+
+  //lowest update that is not finished, else the one after the last
+  std::int32_t pollOffset() {
+    auto unfinished = m_scheduler.unfinishedUpdates(m_bot_id);
+    if (!unfinished.empty() && unfinished.front() < m_next_update)
+      return static_cast<std::int32_t>(unfinished.front());
+    return m_next_update;
+  }
+
+  template <typename F, typename H>
+  void runLoop(F fetch, H handled) {
+    assert(!m_commands.empty());
+    try {
+      PLOGI << "Bot username: " << m_bot.getApi().getMe()->username.c_str();
+      PLOGI << "Telegram bot longpoll started";
+      m_polling = true;
+      while (m_polling) {
+        dispatchBatch(fetch(), handled);
+        if constexpr (!Policy::kThreaded)
+          m_scheduler.runPending();
+        commitCheckpoint();
+      }
+      PLOGI << "Telegram bot longpoll stopped, draining sessions";
+      if (!m_scheduler.drain(m_drain_timeout, m_bot_id))
+        PLOGW << "Drain deadline exceeded";
+      commitCheckpoint();
+    } catch (TgBot::TgException& e) {
+      PLOGE << e.what();
+      throw;
+    }
+  }
+
   static bool checkCommand(std::string command, std::string text) {
     return text == command || text.starts_with(command + " ");
   };
 
+  static constexpr std::array<const char*,
+                              static_cast<std::size_t>(UpdateType::kCount)>
+      kHandlerNames = {"message handler",
+                       "command",
+                       "callback query handler",
+                       "edited message handler",
+                       "inline query handler",
+                       "chosen inline result handler",
+                       "shipping query handler",
+                       "pre-checkout query handler",
+                       "poll handler",
+                       "poll answer handler",
+                       "chat member handler",
+                       "chat join request handler"};
+
+  static constexpr std::int32_t kPollLimit = 100;
+  // a single-threaded bot runs its timers between polls
+  static constexpr std::int32_t kPollTimeout = Policy::kThreaded ? 10 : 1;
+  static constexpr auto kShardIdleSleep = std::chrono::milliseconds(1);
+  // pause before polling again while an update holds the offset back
+  static constexpr auto kHeldBackSleep = std::chrono::milliseconds(20);
+
   TgBot::Bot& m_bot;
-  ATgBot::Tools::Scheduler m_scheduler;
+  std::unique_ptr<Scheduler> m_own_scheduler;
+  Scheduler& m_scheduler;
+  const Tools::BotId m_bot_id;
+  Tools::ApiCache m_api_cache;
+
+  std::atomic<bool> m_polling{false};
+  std::atomic<Tools::DefaultTimer::duration> m_drain_timeout{
+      std::chrono::seconds(10)};
+  std::unique_ptr<Tools::UpdateCheckpoint> m_checkpoint;
+  // offset after the highest dispatched update
+  std::int32_t m_next_update = 0;
+
+  std::array<UpdateLane, static_cast<std::size_t>(UpdateType::kCount)> m_lanes;
+  std::atomic<bool> m_callback_auto_answer{false};
+  std::atomic<bool> m_inline_debounce{false};
+  std::atomic<bool> m_fast_path{false};
+  Tools::InlineDebouncer m_inline_debouncer;
+  std::unique_ptr<Tools::InlineResultCache> m_inline_cache;
+  Tools::UpdateIdWindow m_seen_updates;
 
   std::unordered_map<std::string, MessageListener> m_commands;
   MessageListener m_message_handler;
@@ -237,4 +638,7 @@ class AsyncBot {
   ChatJoinRequestListener m_chat_join_request_handler;
 };
 
+using AsyncBot = BasicAsyncBot<Tools::MultiThreaded>;
+using SingleThreadedAsyncBot = BasicAsyncBot<Tools::SingleThreaded>;
+
 };  // namespace ATgBot
@@ -6,7 +6,17 @@
 
 //awaitables
 #include "atgbot/awaitables/message.hpp"
+#include "atgbot/awaitables/flatmessage.hpp"
 #include "atgbot/awaitables/callbackquery.hpp"
+#include "atgbot/awaitables/stream.hpp"
+#include "atgbot/awaitables/sync.hpp"
+#include "atgbot/awaitables/channel.hpp"
+#include "atgbot/awaitables/bus.hpp"
 #include "atgbot/awaitables/makeasync.hpp"
 #include "atgbot/awaitables/create.hpp"
 #include "atgbot/awaitables/timer.hpp"
+#include "atgbot/awaitables/idlettl.hpp"
+#include "atgbot/awaitables/priority.hpp"
+#include "atgbot/awaitables/download.hpp"
+#include "atgbot/awaitables/sharedresult.hpp"
+#include "atgbot/awaitables/fileidcache.hpp"
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <boost/asio/async_result.hpp>
+#include <boost/system/error_code.hpp>
+#include <boost/system/system_error.hpp>
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "atgbot/coroutine.hpp"
+#include "atgbot/tools/session.hpp"
+
+namespace ATgBot::Awaitables {
+
+/**
+ * @brief Completion token that lets a coroutine await Boost.Asio async
+ * operations directly.
+ *
+ *   co_await timer.async_wait(useCoroutine);
+ *   auto n = co_await socket.async_read_some(buffer, useCoroutine);
+ *
+ * A leading error_code is thrown as boost::system::system_error; the rest
+ * of the completion arguments is returned as nothing, one value or a
+ * tuple. The session is queued when the operation completes, on the
+ * scheduler's own backend.
+ */
+struct UseCoroutine {};
+inline constexpr UseCoroutine useCoroutine{};
+
+namespace Detail {
+
+template <class... Args>
+struct AsioState {
+  std::optional<std::tuple<Args...>> result;
+  std::atomic<bool> done{false};
+  std::weak_ptr<Tools::Session> session;
+};
+
+template <class... Args>
+struct AsioHandler {
+  std::shared_ptr<AsioState<Args...>> state;
+
+  void operator()(Args... args) {
+    state->result.emplace(std::move(args)...);
+    state->done = true;
+    if (auto session = state->session.lock())
+      session->execute();
+  }
+};
+
+template <class... Values>
+auto unpackValues(Values&&... values) {
+  if constexpr (sizeof...(Values) == 0)
+    return;
+  else if constexpr (sizeof...(Values) == 1)
+    return std::move(values...);
+  else
+    return std::make_tuple(std::move(values)...);
+}
+
+template <class First, class... Rest>
+auto unpack(std::tuple<First, Rest...>&& result) {
+  if constexpr (std::is_same_v<First, boost::system::error_code>) {
+    if (auto& error = std::get<0>(result))
+      throw boost::system::system_error(error);
+    return std::apply(
+        [](auto&&, auto&&... rest) { return unpackValues(std::move(rest)...); },
+        std::move(result));
+  } else {
+    return std::apply(
+        [](auto&&... values) { return unpackValues(std::move(values)...); },
+        std::move(result));
+  }
+}
+
+inline void unpack(std::tuple<>&&) {}
+
+}  // namespace Detail
+
+/**
+ * @brief Awaitable returned by an Asio initiating function for useCoroutine;
+ * the operation starts when the coroutine suspends on it.
+ */
+template <class Start, class... Args>
+class AsioAwaitable {
+ public:
+  explicit AsioAwaitable(Start start) : m_start(std::move(start)) {}
+
+  bool await_ready() const noexcept { return false; }
+
+  void await_suspend(Coroutine::handle_type handle) {
+    m_handle = handle;
+    m_state = std::make_shared<Detail::AsioState<Args...>>();
+    m_state->session = m_handle.promise().session()->weak_from_this();
+
+    m_handle.promise().m_awaiting = "asio";
+    m_handle.promise().pause(
+        [state = m_state]() { return state->done.load(); });
+    std::move(m_start)(Detail::AsioHandler<Args...>{m_state});
+  }
+
+  auto await_resume() {
+    m_handle.promise().throwIfCancelled();
+    return Detail::unpack(std::move(*m_state->result));
+  }
+
+ private:
+  Start m_start;
+  Coroutine::handle_type m_handle;
+  std::shared_ptr<Detail::AsioState<Args...>> m_state;
+};
+
+}  // namespace ATgBot::Awaitables
+
+template <class R, class... Args>
+struct boost::asio::async_result<ATgBot::Awaitables::UseCoroutine,
+                                 R(Args...)> {
+  template <class Initiation, class... InitArgs>
+  static auto initiate(Initiation initiation,
+                       ATgBot::Awaitables::UseCoroutine, InitArgs... args) {
+    auto start = [initiation = std::move(initiation),
+                  ... args = std::move(args)](auto handler) mutable {
+      std::move(initiation)(std::move(handler), std::move(args)...);
+    };
+    return ATgBot::Awaitables::AsioAwaitable<decltype(start),
+                                             std::decay_t<Args>...>(
+        std::move(start));
+  }
+};
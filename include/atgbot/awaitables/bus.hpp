@@ -0,0 +1,177 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "atgbot/awaitables/stream.hpp"
+#include "atgbot/coroutine.hpp"
+#include "atgbot/tools/eventqueue.hpp"
+#include "atgbot/tools/session.hpp"
+
+namespace ATgBot::Awaitables {
+
+/**
+ * @brief Topic publish/subscribe between sessions.
+ *
+ * Every subscription owns a bounded EventQueue of shared immutable events.
+ * Subscriptions are indexed by topic the way EventRouter indexes sessions
+ * by chat, so publish() builds the event once and only touches and wakes
+ * the subscribers of its topic.
+ *
+ *   auto approvals = bus.subscribe("approve/" + std::to_string(id));
+ *   auto decision = co_await approvals.next();
+ *
+ * The bus must outlive its subscriptions.
+ */
+template <class T>
+class Bus {
+  struct Mailbox {
+    Tools::EventQueue<std::shared_ptr<const T>> queue;
+    std::weak_ptr<Tools::Session> session;  ///< guarded by the bus mutex
+  };
+
+ public:
+  using Event = std::shared_ptr<const T>;
+
+  class Subscription {
+   public:
+    Subscription(Bus* bus, std::string topic, std::shared_ptr<Mailbox> box)
+        : m_bus(bus), m_topic(std::move(topic)), m_mailbox(std::move(box)) {}
+    Subscription(Subscription&& other) noexcept
+        : m_bus(std::exchange(other.m_bus, nullptr)),
+          m_topic(std::move(other.m_topic)),
+          m_mailbox(std::move(other.m_mailbox)) {}
+    Subscription(const Subscription&) = delete;
+    Subscription& operator=(const Subscription&) = delete;
+
+    ~Subscription() {
+      if (m_bus)
+        m_bus->unsubscribe(m_topic, m_mailbox);
+    }
+
+    class NextAwaitable {
+     public:
+      explicit NextAwaitable(Subscription& subscription)
+          : m_subscription(subscription) {}
+
+      bool await_ready() { return !m_subscription.m_mailbox->queue.empty(); }
+
+      bool await_suspend(Coroutine::handle_type handle) {
+        m_handle = handle;
+        auto session = m_handle.promise().session();
+        auto& mailbox = m_subscription.m_mailbox;
+        m_subscription.m_bus->attach(*mailbox, *session);
+        if (!mailbox->queue.empty())
+          return false;
+
+        m_handle.promise().m_awaiting = "getPublished";
+        m_handle.promise().pause(
+            [mailbox]() { return !mailbox->queue.empty(); });
+        m_suspended = true;
+        return true;
+      }
+
+      Event await_resume() {
+        if (m_suspended)
+          m_handle.promise().throwIfCancelled();
+        return m_subscription.m_mailbox->queue.pop().value();
+      }
+
+     private:
+      Subscription& m_subscription;
+      Coroutine::handle_type m_handle;
+      bool m_suspended = false;
+    };
+
+    //waits for the next event published to the topic
+    NextAwaitable next() { return NextAwaitable(*this); }
+    std::optional<Event> tryNext() { return m_mailbox->queue.pop(); }
+
+    const std::string& topic() const { return m_topic; }
+    //events lost to the limit of the subscription
+    std::uint64_t droppedCount() const {
+      return m_mailbox->queue.droppedCount();
+    }
+
+   private:
+    Bus* m_bus;
+    std::string m_topic;
+    std::shared_ptr<Mailbox> m_mailbox;
+  };
+
+  Bus() = default;
+  Bus(const Bus&) = delete;
+  Bus& operator=(const Bus&) = delete;
+
+  //events published before the call are not delivered
+  Subscription subscribe(std::string topic,
+                         Tools::QueueLimit limit = kDefaultStreamLimit) {
+    auto mailbox = std::make_shared<Mailbox>();
+    Tools::EventFilter<Event> filter;
+    filter.setEnabled(true);
+    mailbox->queue.setFilter(filter);
+    mailbox->queue.setLimit(limit);
+    std::lock_guard _(m_mutex);
+    m_topics[topic].push_back(mailbox);
+    return Subscription(this, std::move(topic), std::move(mailbox));
+  }
+
+  //returns the number of subscribers the event was offered to
+  std::size_t publish(const std::string& topic, T value) {
+    return publish(topic, std::make_shared<const T>(std::move(value)));
+  }
+  std::size_t publish(const std::string& topic, Event event) {
+    std::vector<std::shared_ptr<Tools::Session>> sessions;
+    std::size_t count = 0;
+    {
+      std::lock_guard _(m_mutex);
+      auto it = m_topics.find(topic);
+      if (it == m_topics.end())
+        return 0;
+      for (auto& mailbox : it->second) {
+        mailbox->queue.push(event);
+        if (auto session = mailbox->session.lock())
+          sessions.push_back(std::move(session));
+      }
+      count = it->second.size();
+    }
+    for (auto& session : sessions)
+      session->execute();
+    return count;
+  }
+
+  std::size_t subscribers(const std::string& topic) {
+    std::lock_guard _(m_mutex);
+    auto it = m_topics.find(topic);
+    return it == m_topics.end() ? 0 : it->second.size();
+  }
+
+ private:
+  void attach(Mailbox& mailbox, Tools::Session& session) {
+    std::lock_guard _(m_mutex);
+    mailbox.session = session.weak_from_this();
+  }
+
+  void unsubscribe(const std::string& topic,
+                   const std::shared_ptr<Mailbox>& mailbox) {
+    std::lock_guard _(m_mutex);
+    auto it = m_topics.find(topic);
+    if (it == m_topics.end())
+      return;
+    std::erase(it->second, mailbox);
+    if (it->second.empty())
+      m_topics.erase(it);
+  }
+
+  std::mutex m_mutex;
+  std::unordered_map<std::string, std::vector<std::shared_ptr<Mailbox>>>
+      m_topics;
+};
+
+}  // namespace ATgBot::Awaitables
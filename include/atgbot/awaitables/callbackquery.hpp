@@ -1,7 +1,10 @@
 #pragma once
 
+#include <string>
+
 #include "atgbot/coroutine.hpp"
 #include "atgbot/tools/eventfilter.hpp"
+#include "atgbot/tools/filters.hpp"
 
 namespace ATgBot::Awaitables {
 
@@ -14,18 +17,20 @@ class CBQueryAwaitable {
 
   void await_suspend(Coroutine::handle_type handle) noexcept {
     this->m_handle = handle;
-    auto session = m_handle.promise().m_session;
+    auto session = m_handle.promise().session();
 
     session->callback_queue.setFilter(m_filter);
 
+    m_handle.promise().m_awaiting = "getCBQuery";
     m_handle.promise().pause(
         [session]() { return !session->callback_queue.empty(); });
   }
 
-  TgBot::CallbackQuery::Ptr await_resume() noexcept {
-    auto e = m_handle.promise().m_session->callback_queue.pop();
+  TgBot::CallbackQuery::Ptr await_resume() {
+    m_handle.promise().throwIfCancelled();
+    auto e = m_handle.promise().session()->callback_queue.pop();
 
-    m_handle.promise().m_session->callback_queue.setFilter(
+    m_handle.promise().session()->callback_queue.setFilter(
         Tools::EventFilter<TgBot::CallbackQuery::Ptr>{});
 
     return e.value();
@@ -36,29 +41,56 @@ class CBQueryAwaitable {
   ATgBot::Tools::EventFilter<TgBot::CallbackQuery::Ptr> m_filter;
 };
 
+/**
+ * @brief Answers a callback query and records it on the session, so the
+ * auto answer of the bot does not answer it a second time.
+ *
+ * Does not suspend; errors of the api call are thrown from co_await.
+ */
+class answerCallbackQuery {
+ public:
+  answerCallbackQuery(const TgBot::Api& api, std::string query_id,
+                      std::string text = {}, bool show_alert = false)
+      : m_api(api),
+        m_query_id(std::move(query_id)),
+        m_text(std::move(text)),
+        m_show_alert(show_alert) {}
+
+  bool await_ready() const noexcept { return false; }
+
+  //marked before the call, the deadline check runs on another thread
+  bool await_suspend(Coroutine::handle_type handle) noexcept {
+    handle.promise().session()->setAnswered();
+    return false;
+  }
+
+  bool await_resume() const {
+    return m_api.answerCallbackQuery(m_query_id, m_text, m_show_alert);
+  }
+
+ private:
+  const TgBot::Api& m_api;
+  std::string m_query_id;
+  std::string m_text;
+  bool m_show_alert;
+};
+
+//waits for a callback query matching a predicate built with ATgBot::Filters
+template <Filters::Term P>
+CBQueryAwaitable getCBQuery(P predicate) {
+  return CBQueryAwaitable(
+      Tools::makeFilter<TgBot::CallbackQuery::Ptr>(std::move(predicate)));
+}
+
 inline CBQueryAwaitable getCBQueryP(std::string prefix) {
-  Tools::EventFilter<TgBot::CallbackQuery::Ptr> filter;
-  filter.setEnabled(true);
-  filter.setAdditionalFilter([prefix](TgBot::CallbackQuery::Ptr message) -> bool {
-    return message->data.starts_with(prefix);
-    });
-  return CBQueryAwaitable(filter);
+  return getCBQuery(Filters::textPrefix(std::move(prefix)));
 }
 inline CBQueryAwaitable getCBQueryM(int64_t message_id) {
-  Tools::EventFilter<TgBot::CallbackQuery::Ptr> filter;
-  filter.setEnabled(true);
-  filter.setAdditionalFilter([message_id](TgBot::CallbackQuery::Ptr message) -> bool {
-    return message->message->messageId == message_id;
-    });
-  return CBQueryAwaitable(filter);
+  return getCBQuery(Filters::messageId(message_id));
 }
 inline CBQueryAwaitable getCBQueryPM(std::string_view prefix, int64_t message_id) {
-  Tools::EventFilter<TgBot::CallbackQuery::Ptr> filter;
-  filter.setEnabled(true);
-  filter.setAdditionalFilter([message_id,prefix](TgBot::CallbackQuery::Ptr message) -> bool {
-    return message->message->messageId == message_id && message->data.starts_with(prefix);
-    });
-  return CBQueryAwaitable(filter);
+  return getCBQuery(Filters::messageId(message_id) &&
+                    Filters::textPrefix(std::string(prefix)));
 }
 
 }  
@@ -0,0 +1,318 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+#include "atgbot/awaitables/sync.hpp"
+#include "atgbot/coroutine.hpp"
+#include "atgbot/tools/session.hpp"
+
+namespace ATgBot::Awaitables {
+
+/**
+ * @brief Bounded queue between coroutines of different sessions.
+ *
+ * send() suspends while the channel is full and receive() while it is
+ * empty; neither blocks a worker. Values are moved from the sender to the
+ * receiver, a waiting receiver gets the value directly. Only the session
+ * on the other end is woken, in FIFO order.
+ *
+ *   Channel<Move> moves(8);
+ *   //player
+ *   co_await moves.send(Move{...});
+ *   //lobby
+ *   while (auto move = co_await moves.receive()) ...
+ *
+ * After close() senders fail and receivers drain the buffer, then get
+ * std::nullopt.
+ */
+template <class T>
+class Channel {
+  struct Receiver : Detail::Waiter {
+    std::optional<T> value;
+  };
+  struct Sender : Detail::Waiter {
+    explicit Sender(T&& v) : value(std::move(v)) {}
+    T value;
+    bool delivered = false;
+  };
+
+ public:
+  explicit Channel(std::size_t capacity)
+      : m_capacity(std::max<std::size_t>(capacity, 1)) {}
+
+  Channel(const Channel&) = delete;
+  Channel& operator=(const Channel&) = delete;
+
+  class SendAwaitable {
+   public:
+    SendAwaitable(Channel& channel, T value)
+        : m_channel(channel), m_value(std::move(value)) {}
+
+    bool await_ready() {
+      std::shared_ptr<Receiver> receiver;
+      {
+        std::lock_guard _(m_channel.m_mutex);
+        if (!m_channel.readyToSend())
+          return false;
+        m_result = m_channel.pushLocked(std::move(*m_value), receiver);
+      }
+      if (receiver)
+        Detail::grant(receiver);
+      return true;
+    }
+
+    bool await_suspend(Coroutine::handle_type handle) {
+      m_handle = handle;
+      auto session = m_handle.promise().session();
+      std::shared_ptr<Receiver> receiver;
+      {
+        std::lock_guard _(m_channel.m_mutex);
+        if (m_channel.readyToSend()) {
+          m_result = m_channel.pushLocked(std::move(*m_value), receiver);
+        } else {
+          m_sender = std::make_shared<Sender>(std::move(*m_value));
+          m_sender->session = session->weak_from_this();
+          m_channel.m_senders.push_back(m_sender);
+        }
+      }
+      if (!m_sender) {
+        if (receiver)
+          Detail::grant(receiver);
+        return false;
+      }
+      m_handle.promise().m_awaiting = "send";
+      m_handle.promise().pause(
+          [sender = m_sender]() { return sender->granted.load(); });
+      return true;
+    }
+
+    //false if the channel was closed before the value was taken
+    bool await_resume() {
+      if (!m_sender)
+        return m_result;
+      if (m_handle.promise().isCancelled()) {
+        m_channel.abandon(m_sender);
+        m_handle.promise().throwIfCancelled();
+      }
+      return m_sender->delivered;
+    }
+
+   private:
+    Channel& m_channel;
+    std::optional<T> m_value;
+    bool m_result = false;
+    Coroutine::handle_type m_handle;
+    std::shared_ptr<Sender> m_sender;
+  };
+
+  class ReceiveAwaitable {
+   public:
+    explicit ReceiveAwaitable(Channel& channel) : m_channel(channel) {}
+
+    bool await_ready() { return tryTake(); }
+
+    bool await_suspend(Coroutine::handle_type handle) {
+      m_handle = handle;
+      auto session = m_handle.promise().session();
+      std::shared_ptr<Sender> sender;
+      {
+        std::lock_guard _(m_channel.m_mutex);
+        if (m_channel.readyToReceive()) {
+          m_value = m_channel.popLocked(sender);
+        } else {
+          m_receiver = std::make_shared<Receiver>();
+          m_receiver->session = session->weak_from_this();
+          m_channel.m_receivers.push_back(m_receiver);
+        }
+      }
+      if (!m_receiver) {
+        if (sender)
+          Detail::grant(sender);
+        return false;
+      }
+      m_handle.promise().m_awaiting = "receive";
+      m_handle.promise().pause(
+          [receiver = m_receiver]() { return receiver->granted.load(); });
+      return true;
+    }
+
+    //std::nullopt once the channel is closed and drained
+    std::optional<T> await_resume() {
+      if (!m_receiver)
+        return std::move(m_value);
+      if (m_handle.promise().isCancelled()) {
+        m_channel.abandon(m_receiver);
+        m_handle.promise().throwIfCancelled();
+      }
+      return std::move(m_receiver->value);
+    }
+
+   private:
+    bool tryTake() {
+      std::shared_ptr<Sender> sender;
+      {
+        std::lock_guard _(m_channel.m_mutex);
+        if (!m_channel.readyToReceive())
+          return false;
+        m_value = m_channel.popLocked(sender);
+      }
+      if (sender)
+        Detail::grant(sender);
+      return true;
+    }
+
+    Channel& m_channel;
+    std::optional<T> m_value;
+    Coroutine::handle_type m_handle;
+    std::shared_ptr<Receiver> m_receiver;
+  };
+
+  //suspends while the channel is full, resumes with false if it is closed
+  SendAwaitable send(T value) {
+    return SendAwaitable(*this, std::move(value));
+  }
+  //suspends while the channel is empty
+  ReceiveAwaitable receive() { return ReceiveAwaitable(*this); }
+
+  //does not move from value when the channel is full or closed
+  bool trySend(T&& value) {
+    std::shared_ptr<Receiver> receiver;
+    {
+      std::lock_guard _(m_mutex);
+      if (m_closed || !readyToSend())
+        return false;
+      pushLocked(std::move(value), receiver);
+    }
+    if (receiver)
+      Detail::grant(receiver);
+    return true;
+  }
+  std::optional<T> tryReceive() {
+    std::shared_ptr<Sender> sender;
+    std::optional<T> value;
+    {
+      std::lock_guard _(m_mutex);
+      if (m_buffer.empty())
+        return std::nullopt;
+      value = popLocked(sender);
+    }
+    if (sender)
+      Detail::grant(sender);
+    return value;
+  }
+
+  //fails waiting senders and wakes every receiver once the buffer is empty
+  void close() {
+    std::deque<std::shared_ptr<Sender>> senders;
+    std::deque<std::shared_ptr<Receiver>> receivers;
+    {
+      std::lock_guard _(m_mutex);
+      m_closed = true;
+      senders.swap(m_senders);
+      receivers.swap(m_receivers);
+    }
+    for (auto& sender : senders)
+      Detail::grant(sender);
+    for (auto& receiver : receivers)
+      Detail::grant(receiver);
+  }
+
+  bool closed() {
+    std::lock_guard _(m_mutex);
+    return m_closed;
+  }
+  //buffered values
+  std::size_t size() {
+    std::lock_guard _(m_mutex);
+    return m_buffer.size();
+  }
+  std::size_t capacity() const { return m_capacity; }
+
+ private:
+  //a value can be pushed or the send fails at once
+  bool readyToSend() const {
+    return m_closed || m_buffer.size() < m_capacity ||
+           std::any_of(m_receivers.begin(), m_receivers.end(),
+                       [](const auto& r) { return !r->session.expired(); });
+  }
+  //a value can be popped or the receive returns std::nullopt at once
+  bool readyToReceive() const { return !m_buffer.empty() || m_closed; }
+
+  //first receiver whose session is alive
+  std::shared_ptr<Receiver> popReceiverLocked() {
+    while (!m_receivers.empty()) {
+      auto receiver = std::move(m_receivers.front());
+      m_receivers.pop_front();
+      if (!receiver->session.expired())
+        return receiver;
+    }
+    return nullptr;
+  }
+
+  //hands the value to the first live receiver or buffers it
+  bool pushLocked(T&& value, std::shared_ptr<Receiver>& receiver) {
+    if (m_closed)
+      return false;
+    receiver = popReceiverLocked();
+    if (receiver)
+      receiver->value = std::move(value);
+    else
+      m_buffer.push_back(std::move(value));
+    return true;
+  }
+
+  //takes the first value and refills the buffer from the first sender
+  std::optional<T> popLocked(std::shared_ptr<Sender>& sender) {
+    if (m_buffer.empty())
+      return std::nullopt;
+    std::optional<T> value = std::move(m_buffer.front());
+    m_buffer.pop_front();
+    if (!m_senders.empty()) {
+      sender = std::move(m_senders.front());
+      m_senders.pop_front();
+      m_buffer.push_back(std::move(sender->value));
+      sender->delivered = true;
+    }
+    return value;
+  }
+
+  //a cancelled sender leaves the queue with its value
+  void abandon(const std::shared_ptr<Sender>& sender) {
+    std::lock_guard _(m_mutex);
+    std::erase(m_senders, sender);
+  }
+  //a cancelled receiver passes a value it was given on
+  void abandon(const std::shared_ptr<Receiver>& receiver) {
+    std::shared_ptr<Receiver> next;
+    {
+      std::lock_guard _(m_mutex);
+      std::erase(m_receivers, receiver);
+      if (!receiver->value)
+        return;
+      if (!m_closed)
+        next = popReceiverLocked();
+      if (next)
+        next->value = std::move(receiver->value);
+      else
+        m_buffer.push_front(std::move(*receiver->value));
+      receiver->value.reset();
+    }
+    if (next)
+      Detail::grant(next);
+  }
+
+  const std::size_t m_capacity;
+  std::mutex m_mutex;
+  std::deque<T> m_buffer;
+  std::deque<std::shared_ptr<Receiver>> m_receivers;
+  std::deque<std::shared_ptr<Sender>> m_senders;
+  bool m_closed = false;
+};
+
+}  // namespace ATgBot::Awaitables
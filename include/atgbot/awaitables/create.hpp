@@ -11,7 +11,7 @@ class createCoro {
   bool await_ready() const noexcept { return false; }
 
   void await_suspend(Coroutine::handle_type handle) noexcept {
-    handle.promise().m_session->pushCoro(std::move(m_coro));
+    handle.promise().session()->pushCoro(std::move(m_coro));
   }
 
   void await_resume() noexcept {}
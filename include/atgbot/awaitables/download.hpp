@@ -0,0 +1,146 @@
+#pragma once
+
+#include <atomic>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+#include "atgbot/coroutine.hpp"
+#include "atgbot/tools/downloader.hpp"
+
+namespace ATgBot::Awaitables {
+
+/**
+ * @brief Streams a Telegram file to a sink without holding it in memory.
+ *
+ * The download runs on a Downloader pool; the coroutine is suspended
+ * meanwhile and resumes with the number of written bytes. Errors of the
+ * download are rethrown from co_await. If the session is destroyed while
+ * the file is in flight, the download stops at the next chunk.
+ */
+class DownloadAwaitable {
+  struct State {
+    std::atomic<bool> finished{false};
+    std::shared_ptr<std::atomic<bool>> abort =
+        std::make_shared<std::atomic<bool>>(false);
+    std::exception_ptr error;
+    std::size_t bytes = 0;
+  };
+
+ public:
+  DownloadAwaitable(const TgBot::Bot& bot, std::string file_id,
+                    Tools::Downloader::ChunkSink sink,
+                    Tools::Downloader& downloader,
+                    std::optional<std::filesystem::path> path = std::nullopt,
+                    std::function<void()> finish = nullptr)
+      : m_bot(bot),
+        m_file_id(std::move(file_id)),
+        m_sink(std::move(sink)),
+        m_downloader(downloader),
+        m_path(std::move(path)),
+        m_finish(std::move(finish)) {}
+
+  ~DownloadAwaitable() { *m_state->abort = true; }
+
+  bool await_ready() const noexcept { return false; }
+
+  void await_suspend(Coroutine::handle_type handle) noexcept {
+    m_handle = handle;
+    m_handle.promise().m_awaiting = "downloadTo";
+    auto state = m_state;
+    m_handle.promise().pause([state]() { return state->finished.load(); });
+
+    std::weak_ptr<Tools::Session> session =
+        m_handle.promise().session()->weak_from_this();
+    m_downloader.submit(
+        {.bot = &m_bot,
+         .file_id = m_file_id,
+         .sink =
+             [state, sink = m_sink](std::string_view chunk) {
+               sink(chunk);
+               state->bytes += chunk.size();
+             },
+         .abort = state->abort,
+         .finish = m_finish,
+         .done = [state, session](std::exception_ptr error) {
+           state->error = error;
+           state->finished = true;
+           if (auto alive = session.lock())
+             alive->execute();
+         }});
+  }
+
+  /**
+   * @return Number of bytes written to the sink.
+   * @throws CancelledError if the session was cancelled meanwhile.
+   */
+  std::size_t await_resume() {
+    try {
+      m_handle.promise().throwIfCancelled();
+    } catch (...) {
+      *m_state->abort = true;
+      removePartialFile();
+      throw;
+    }
+    if (m_state->error) {
+      removePartialFile();
+      std::rethrow_exception(m_state->error);
+    }
+    return m_state->bytes;
+  }
+
+ private:
+  //the downloader may still hold the file open, so errors are ignored
+  void removePartialFile() {
+    std::error_code error;
+    if (m_path)
+      std::filesystem::remove(*m_path, error);
+  }
+
+  Coroutine::handle_type m_handle;
+  const TgBot::Bot& m_bot;
+  std::string m_file_id;
+  Tools::Downloader::ChunkSink m_sink;
+  Tools::Downloader& m_downloader;
+  std::optional<std::filesystem::path> m_path;
+  std::function<void()> m_finish;
+  std::shared_ptr<State> m_state = std::make_shared<State>();
+};
+
+//streams the file to a chunk callback, called on a downloader thread
+inline DownloadAwaitable downloadTo(
+    const TgBot::Bot& bot, const std::string& file_id,
+    Tools::Downloader::ChunkSink sink,
+    Tools::Downloader& downloader = Tools::Downloader::shared()) {
+  return DownloadAwaitable(bot, file_id, std::move(sink), downloader);
+}
+
+//streams the file to disk, a partial file is removed on error or
+//cancellation; the file is closed before the coroutine resumes
+inline DownloadAwaitable downloadTo(
+    const TgBot::Bot& bot, const std::string& file_id,
+    const std::filesystem::path& path,
+    Tools::Downloader& downloader = Tools::Downloader::shared()) {
+  auto file = std::make_shared<std::ofstream>(path, std::ios::binary);
+  if (!*file)
+    throw std::runtime_error("cannot open " + path.string());
+  auto sink = [file](std::string_view chunk) {
+    if (!file->write(chunk.data(), chunk.size()))
+      throw std::runtime_error("cannot write the downloaded file");
+  };
+  auto finish = [file]() {
+    file->close();
+    if (!*file)
+      throw std::runtime_error("cannot write the downloaded file");
+  };
+  return DownloadAwaitable(bot, file_id, std::move(sink), downloader, path,
+                           std::move(finish));
+}
+
+}  // namespace ATgBot::Awaitables
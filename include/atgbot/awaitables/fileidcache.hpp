@@ -0,0 +1,68 @@
+#pragma once
+
+#include <filesystem>
+#include <optional>
+#include <string>
+
+#include "atgbot/awaitables/sharedresult.hpp"
+#include "atgbot/coroutine.hpp"
+#include "atgbot/tools/fileidcache.hpp"
+
+namespace ATgBot::Awaitables {
+
+/**
+ * @brief Sends a local file through a FileIdCache.
+ *
+ * While another caller uploads the same content, the coroutine is
+ * suspended instead of blocking its worker; it then sends by the new
+ * file_id, or uploads itself if that upload failed.
+ */
+class SendCachedAwaitable {
+  using Wait = SharedResultAwaitable<std::optional<std::string>>;
+
+ public:
+  SendCachedAwaitable(Tools::FileIdCache& cache, std::filesystem::path path,
+                      std::string mime_type, Tools::FileIdCache::Send send)
+      : m_cache(cache),
+        m_path(std::move(path)),
+        m_mime_type(std::move(mime_type)),
+        m_send(std::move(send)) {}
+
+  bool await_ready() {
+    auto upload = m_cache.pendingUpload(m_path);
+    if (!upload || upload->ready())
+      return true;
+    m_wait.emplace(std::move(upload));
+    return false;
+  }
+
+  bool await_suspend(Coroutine::handle_type handle) {
+    return m_wait->await_suspend(handle);
+  }
+
+  /**
+   * @return The message returned by the send callback.
+   * @throws CancelledError if the session was cancelled meanwhile.
+   */
+  TgBot::Message::Ptr await_resume() {
+    if (m_wait)
+      m_wait->await_resume();
+    return m_cache.send(m_path, m_mime_type, m_send);
+  }
+
+ private:
+  Tools::FileIdCache& m_cache;
+  std::filesystem::path m_path;
+  std::string m_mime_type;
+  Tools::FileIdCache::Send m_send;
+  std::optional<Wait> m_wait;
+};
+
+inline SendCachedAwaitable sendCached(Tools::FileIdCache& cache,
+                                      const std::filesystem::path& path,
+                                      const std::string& mime_type,
+                                      Tools::FileIdCache::Send send) {
+  return SendCachedAwaitable(cache, path, mime_type, std::move(send));
+}
+
+}  // namespace ATgBot::Awaitables
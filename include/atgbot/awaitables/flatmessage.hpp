@@ -0,0 +1,62 @@
+#pragma once
+
+#include "atgbot/coroutine.hpp"
+#include "atgbot/tools/filters.hpp"
+#include "atgbot/tools/flatmessage.hpp"
+
+namespace ATgBot::Awaitables {
+
+/**
+ * @brief Waits for a message like MessageAwaitable, but the session only
+ * holds a FlatMessage while it is queued. Call toMessage() on the result
+ * when a full TgBot::Message is needed.
+ */
+class FlatMessageAwaitable {
+ public:
+  FlatMessageAwaitable(Tools::EventFilter<Tools::FlatMessage> filter)
+      : m_filter(std::move(filter)) {}
+
+  constexpr bool await_ready() const noexcept { return false; }
+
+  void await_suspend(Coroutine::handle_type handle) noexcept {
+    this->m_handle = handle;
+    auto session = m_handle.promise().session();
+
+    session->flat_message_queue.setFilter(m_filter);
+
+    m_handle.promise().m_awaiting = "getFlatMessage";
+    m_handle.promise().pause(
+        [session]() { return !session->flat_message_queue.empty(); });
+  }
+
+  Tools::FlatMessage await_resume() {
+    m_handle.promise().throwIfCancelled();
+    auto session = m_handle.promise().session();
+    auto e = session->flat_message_queue.pop();
+
+    session->flat_message_queue.setFilter(
+        Tools::EventFilter<Tools::FlatMessage>{});
+
+    return std::move(e.value());
+  }
+
+ private:
+  Coroutine::handle_type m_handle;
+  Tools::EventFilter<Tools::FlatMessage> m_filter;
+};
+
+//waits for a message matching a predicate built with ATgBot::Filters
+template <Filters::Term P>
+FlatMessageAwaitable getFlatMessage(P predicate) {
+  return FlatMessageAwaitable(
+      Tools::makeFilter<Tools::FlatMessage>(std::move(predicate)));
+}
+
+inline FlatMessageAwaitable getFlatMessageU(int64_t user_id) {
+  return getFlatMessage(Filters::from(user_id));
+}
+inline FlatMessageAwaitable getFlatMessageG(int64_t group_id) {
+  return getFlatMessage(Filters::chat(group_id));
+}
+
+}  // namespace ATgBot::Awaitables
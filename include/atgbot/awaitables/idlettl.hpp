@@ -0,0 +1,34 @@
+#pragma once
+
+#include <chrono>
+
+#include "atgbot/coroutine.hpp"
+
+namespace ATgBot::Awaitables {
+
+/**
+ * @brief Overrides the idle time to live of the current session.
+ *
+ * Does not suspend. A zero duration restores the scheduler default.
+ */
+class setIdleTtl {
+ public:
+  template <class T, class U>
+  explicit setIdleTtl(std::chrono::duration<T, U> ttl)
+      : m_ttl(std::chrono::duration_cast<Tools::DefaultTimer::duration>(ttl)) {
+  }
+
+  bool await_ready() const noexcept { return false; }
+
+  bool await_suspend(Coroutine::handle_type handle) noexcept {
+    handle.promise().session()->setIdleTtl(m_ttl);
+    return false;
+  }
+
+  void await_resume() noexcept {}
+
+ private:
+  Tools::DefaultTimer::duration m_ttl;
+};
+
+}  // namespace ATgBot::Awaitables
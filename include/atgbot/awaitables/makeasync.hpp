@@ -51,10 +51,10 @@ struct makeAsync<T, Args...> {
       std::invoke_result_t<T,
                            Args...>;  ///< Result type of the invoked callable.
 
-  template <typename T, typename Tuple, std::size_t... Indices>
-  static auto invoke_with_indices(T&& m_object, Tuple&& m_args,
+  template <typename F, typename Tuple, std::size_t... Indices>
+  static auto invoke_with_indices(F&& m_object, Tuple&& m_args,
                                   std::index_sequence<Indices...>) {
-    return std::invoke(std::forward<T>(m_object),
+    return std::invoke(std::forward<F>(m_object),
                        std::forward<decltype(std::get<Indices>(m_args))>(
                            std::get<Indices>(m_args))...);
   }
@@ -89,6 +89,7 @@ struct makeAsync<T, Args...> {
    */
   void await_suspend(Coroutine::handle_type handle) noexcept {
     this->m_handle = handle;
+    m_handle.promise().m_awaiting = "makeAsync";
 
     // Create a new thread to execute the callable.
     m_thread = std::make_unique<std::thread>([this]() {
@@ -100,7 +101,7 @@ struct makeAsync<T, Args...> {
       std::lock_guard _(m_mutex);
       m_result =
           std::move(result);  // Move the result to avoid unnecessary copies.
-      m_handle.promise().m_session->execute();
+      m_handle.promise().session()->execute();
     });
 
     m_handle.promise().pause([this]() {
@@ -116,9 +117,11 @@ struct makeAsync<T, Args...> {
    * and returns it.
    *
    * @return The result of the callable execution.
+   * @throws CancelledError if the session was cancelled meanwhile.
    */
-  R await_resume() noexcept {
+  R await_resume() {
     m_thread->join();         ///< Wait for the thread to finish execution.
+    m_handle.promise().throwIfCancelled();
     return m_result.value();  ///< Return the result of the execution.
   }
 
@@ -145,10 +148,10 @@ template <typename T, typename... Args>
            std::is_same_v<void, std::invoke_result_t<T, Args...>>
 struct makeAsync<T, Args...> {
 
-  template <typename T, typename Tuple, std::size_t... Indices>
-  static auto invoke_with_indices(T&& m_object, Tuple&& m_args,
+  template <typename F, typename Tuple, std::size_t... Indices>
+  static auto invoke_with_indices(F&& m_object, Tuple&& m_args,
                                   std::index_sequence<Indices...>) {
-    return std::invoke(std::forward<T>(m_object),
+    return std::invoke(std::forward<F>(m_object),
                        std::forward<decltype(std::get<Indices>(m_args))>(
                            std::get<Indices>(m_args))...);
   }
@@ -183,6 +186,7 @@ struct makeAsync<T, Args...> {
    */
   void await_suspend(Coroutine::handle_type handle) noexcept {
     this->m_handle = handle;
+    m_handle.promise().m_awaiting = "makeAsync";
 
     // Create a new thread to execute the callable.
     m_thread = std::make_unique<std::thread>([this]() {
@@ -191,7 +195,7 @@ struct makeAsync<T, Args...> {
                                      std::index_sequence_for<Args...>{});
 
       m_ready = true;
-      m_handle.promise().m_session->execute();
+      m_handle.promise().session()->execute();
     });
 
     // Define the condition for resuming the coroutine.
@@ -204,9 +208,12 @@ struct makeAsync<T, Args...> {
    * @brief Resume the coroutine once the async task is complete.
    *
    * This method is invoked when the coroutine is resumed. It waits for the callable execution to finish.
+   *
+   * @throws CancelledError if the session was cancelled meanwhile.
    */
-  void await_resume() noexcept {
+  void await_resume() {
     m_thread->join();  ///< Wait for the thread to finish execution.
+    m_handle.promise().throwIfCancelled();
   }
 
  private:
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "atgbot/coroutine.hpp"
+#include "atgbot/tools/filters.hpp"
 
 namespace ATgBot::Awaitables {
 
@@ -13,19 +14,21 @@ class MessageAwaitable {
 
   void await_suspend(Coroutine::handle_type handle) noexcept {
     this->m_handle = handle;
-    auto session = m_handle.promise().m_session;
+    auto session = m_handle.promise().session();
 
     session->message_queue.setFilter(m_filter);
 
+    m_handle.promise().m_awaiting = "getMessage";
     m_handle.promise().pause(
         [session]() { return !session->message_queue.empty(); });
   }
 
-  TgBot::Message::Ptr await_resume() noexcept {
-    auto e = m_handle.promise().m_session->message_queue.pop();
+  TgBot::Message::Ptr await_resume() {
+    m_handle.promise().throwIfCancelled();
+    auto e = m_handle.promise().session()->message_queue.pop();
 
-    m_handle.promise().m_session->callback_queue.setFilter(
-        Tools::EventFilter<TgBot::CallbackQuery::Ptr>{});
+    m_handle.promise().session()->message_queue.setFilter(
+        Tools::EventFilter<TgBot::Message::Ptr>{});
 
     return e.value();
   }
@@ -35,28 +38,20 @@ class MessageAwaitable {
   ATgBot::Tools::EventFilter<TgBot::Message::Ptr> m_filter;
 };
 
+//waits for a message matching a predicate built with ATgBot::Filters
+template <Filters::Term P>
+MessageAwaitable getMessage(P predicate) {
+  return MessageAwaitable(
+      Tools::makeFilter<TgBot::Message::Ptr>(std::move(predicate)));
+}
+
 inline MessageAwaitable getMessageU(int64_t user_id) {
-  ATgBot::Tools::EventFilter<TgBot::Message::Ptr> filter;
-  filter.setEnabled(true);
-  filter.setAdditionalFilter([user_id](TgBot::Message::Ptr message) {
-    return message->from->id == user_id;
-  });
-  return MessageAwaitable(filter);
+  return getMessage(Filters::from(user_id));
 }
 inline MessageAwaitable getMessageG(int64_t group_id) {
-  ATgBot::Tools::EventFilter<TgBot::Message::Ptr> filter;
-  filter.setEnabled(true);
-  filter.setAdditionalFilter([group_id](TgBot::Message::Ptr message) {
-    return message->chat->id == group_id;
-  });
-  return MessageAwaitable(filter);
+  return getMessage(Filters::chat(group_id));
 }
 inline MessageAwaitable getMessageUG(int64_t user_id, int64_t group_id) {
-  ATgBot::Tools::EventFilter<TgBot::Message::Ptr> filter;
-  filter.setEnabled(true);
-  filter.setAdditionalFilter([user_id, group_id](TgBot::Message::Ptr message) {
-    return message->from->id == user_id && message->chat->id == group_id;
-  });
-  return MessageAwaitable(filter);
+  return getMessage(Filters::from(user_id) && Filters::chat(group_id));
 }
 }  // namespace ATgBot::Awaitables
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "atgbot/coroutine.hpp"
+#include "atgbot/tools/priority.hpp"
+
+namespace ATgBot::Awaitables {
+
+/**
+ * @brief Changes the priority class of the current session.
+ *
+ * Does not suspend. Overrides the priority assigned by the update type.
+ */
+class setPriority {
+ public:
+  explicit setPriority(Tools::Priority priority) : m_priority(priority) {}
+
+  bool await_ready() const noexcept { return false; }
+
+  bool await_suspend(Coroutine::handle_type handle) noexcept {
+    handle.promise().session()->setPriority(m_priority);
+    return false;
+  }
+
+  void await_resume() noexcept {}
+
+ private:
+  Tools::Priority m_priority;
+};
+
+}  // namespace ATgBot::Awaitables
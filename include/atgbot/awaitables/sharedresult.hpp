@@ -0,0 +1,63 @@
+#pragma once
+
+#include <memory>
+#include <utility>
+
+#include "atgbot/coroutine.hpp"
+#include "atgbot/tools/sharedresult.hpp"
+
+namespace ATgBot::Awaitables {
+
+/**
+ * @brief Suspends the coroutine until a shared result is set.
+ *
+ * A ready result does not suspend. The producer wakes the session, so the
+ * worker is free meanwhile. Errors of the producer are rethrown from
+ * co_await.
+ */
+template <class T>
+class SharedResultAwaitable {
+ public:
+  explicit SharedResultAwaitable(
+      std::shared_ptr<Tools::SharedResult<T>> result)
+      : m_result(std::move(result)) {}
+
+  bool await_ready() const noexcept { return m_result->ready(); }
+
+  bool await_suspend(Coroutine::handle_type handle) {
+    m_handle = handle;
+    m_handle.promise().m_awaiting = "sharedResult";
+    auto result = m_result;
+    m_handle.promise().pause([result]() { return result->ready(); });
+
+    std::weak_ptr<Tools::Session> session =
+        m_handle.promise().session()->weak_from_this();
+    m_suspended = m_result->onReady([session]() {
+      if (auto alive = session.lock())
+        alive->execute();
+    });
+    return m_suspended;
+  }
+
+  /**
+   * @throws CancelledError if the session was cancelled meanwhile.
+   */
+  T await_resume() {
+    if (m_suspended)
+      m_handle.promise().throwIfCancelled();
+    return m_result->get();
+  }
+
+ private:
+  Coroutine::handle_type m_handle;
+  std::shared_ptr<Tools::SharedResult<T>> m_result;
+  bool m_suspended = false;
+};
+
+template <class T>
+SharedResultAwaitable<T> awaitResult(
+    std::shared_ptr<Tools::SharedResult<T>> result) {
+  return SharedResultAwaitable<T>(std::move(result));
+}
+
+}  // namespace ATgBot::Awaitables
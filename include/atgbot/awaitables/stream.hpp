@@ -0,0 +1,153 @@
+#pragma once
+
+#include <utility>
+
+#include "atgbot/coroutine.hpp"
+#include "atgbot/tools/filters.hpp"
+#include "atgbot/tools/flatmessage.hpp"
+#include "atgbot/tools/loadlimits.hpp"
+
+namespace ATgBot::Awaitables {
+
+/**
+ * @brief Subscription of a coroutine to one kind of events.
+ *
+ * The filter is installed on the first next() and stays until the stream
+ * is destroyed, so events arriving while the coroutine is busy between two
+ * next() calls are buffered up to the limit instead of being dropped.
+ *
+ *   auto stream = messages(Filters::chat(chat_id));
+ *   while (true) {
+ *     auto message = co_await stream.next();
+ *     ...
+ *   }
+ *
+ * A stream owns the queue of its event type in the session: a getMessage()
+ * in the same coroutine replaces the filter, and the next next()
+ * subscribes again.
+ */
+template <class T>
+class EventStream {
+ public:
+  using Queue = Tools::EventQueue<T> Tools::Session::*;
+
+  EventStream(Queue queue, const char* kind, Tools::EventFilter<T> filter,
+              Tools::QueueLimit limit)
+      : m_queue(queue),
+        m_kind(kind),
+        m_filter(std::move(filter)),
+        m_limit(limit) {}
+
+  EventStream(EventStream&& other) noexcept
+      : m_queue(other.m_queue),
+        m_kind(other.m_kind),
+        m_filter(std::move(other.m_filter)),
+        m_limit(other.m_limit),
+        m_session(std::exchange(other.m_session, nullptr)),
+        m_generation(other.m_generation),
+        m_previous_limit(other.m_previous_limit) {}
+  EventStream(const EventStream&) = delete;
+  EventStream& operator=(const EventStream&) = delete;
+
+  ~EventStream() { unsubscribe(); }
+
+  class NextAwaitable {
+   public:
+    explicit NextAwaitable(EventStream& stream) : m_stream(stream) {}
+
+    constexpr bool await_ready() const noexcept { return false; }
+
+    //does not suspend when an event is already buffered
+    bool await_suspend(Coroutine::handle_type handle) {
+      m_handle = handle;
+      auto session = m_handle.promise().session();
+      auto& queue = m_stream.subscribe(session);
+      if (!queue.empty())
+        return false;
+
+      m_handle.promise().m_awaiting = m_stream.m_kind;
+      m_handle.promise().pause([&queue]() { return !queue.empty(); });
+      return true;
+    }
+
+    T await_resume() {
+      m_handle.promise().throwIfCancelled();
+      auto session = m_handle.promise().session();
+      return std::move((session->*m_stream.m_queue).pop().value());
+    }
+
+   private:
+    EventStream& m_stream;
+    Coroutine::handle_type m_handle;
+  };
+
+  //waits for the next event of the subscription
+  NextAwaitable next() { return NextAwaitable(*this); }
+
+ private:
+  Tools::EventQueue<T>& subscribe(Tools::Session* session) {
+    auto& queue = session->*m_queue;
+    if (m_session == session && queue.generation() == m_generation)
+      return queue;
+    if (m_session != session) {
+      m_session = session;
+      m_previous_limit = queue.limit();
+    }
+    queue.setLimit(m_limit);
+    queue.setFilter(m_filter);
+    m_generation = queue.generation();
+    return queue;
+  }
+
+  void unsubscribe() {
+    if (!m_session)
+      return;
+    auto& queue = m_session->*m_queue;
+    if (queue.generation() == m_generation)
+      queue.setFilter(Tools::EventFilter<T>{});
+    queue.setLimit(m_previous_limit);
+    m_session = nullptr;
+  }
+
+  Queue m_queue;
+  const char* m_kind;
+  Tools::EventFilter<T> m_filter;
+  Tools::QueueLimit m_limit;
+  Tools::Session* m_session = nullptr;
+  std::uint64_t m_generation = 0;
+  Tools::QueueLimit m_previous_limit;
+};
+
+inline constexpr Tools::QueueLimit kDefaultStreamLimit{
+    .max_events = 64, .policy = Tools::OverflowPolicy::kDropOldest};
+
+//subscribes to messages matching a predicate built with ATgBot::Filters
+template <Filters::Term P>
+EventStream<TgBot::Message::Ptr> messages(
+    P predicate, Tools::QueueLimit limit = kDefaultStreamLimit) {
+  return {&Tools::Session::message_queue, "getMessage",
+          Tools::makeFilter<TgBot::Message::Ptr>(std::move(predicate)),
+          limit};
+}
+
+inline EventStream<TgBot::Message::Ptr> messages(
+    int64_t chat_id, Tools::QueueLimit limit = kDefaultStreamLimit) {
+  return messages(Filters::chat(chat_id), limit);
+}
+
+template <Filters::Term P>
+EventStream<Tools::FlatMessage> flatMessages(
+    P predicate, Tools::QueueLimit limit = kDefaultStreamLimit) {
+  return {&Tools::Session::flat_message_queue, "getFlatMessage",
+          Tools::makeFilter<Tools::FlatMessage>(std::move(predicate)), limit};
+}
+
+template <Filters::Term P>
+EventStream<TgBot::CallbackQuery::Ptr> callbackQueries(
+    P predicate, Tools::QueueLimit limit = kDefaultStreamLimit) {
+  return {&Tools::Session::callback_queue, "getCBQuery",
+          Tools::makeFilter<TgBot::CallbackQuery::Ptr>(std::move(predicate)),
+          limit};
+}
+
+}  // namespace ATgBot::Awaitables
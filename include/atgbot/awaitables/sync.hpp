@@ -0,0 +1,273 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "atgbot/coroutine.hpp"
+#include "atgbot/tools/session.hpp"
+
+namespace ATgBot::Awaitables {
+
+namespace Detail {
+
+//a suspended coroutine waiting for a primitive
+struct Waiter {
+  std::atomic<bool> granted{false};
+  std::weak_ptr<Tools::Session> session;
+};
+
+//sets the grant and queues the session, false if the session is gone
+inline bool grant(const std::shared_ptr<Waiter>& waiter) {
+  waiter->granted = true;
+  auto session = waiter->session.lock();
+  if (session)
+    session->execute();
+  return session != nullptr;
+}
+
+}  // namespace Detail
+
+/**
+ * @brief Counting semaphore for coroutines.
+ *
+ * acquire() suspends the session instead of blocking the worker. Permits
+ * are handed to waiters in FIFO order: release() gives the permit to the
+ * first waiter and queues its session, so a later acquire() cannot barge
+ * in. A waiter that is cancelled leaves the queue, or passes a permit it
+ * was already given on.
+ */
+class AsyncSemaphore {
+ public:
+  explicit AsyncSemaphore(std::size_t count) : m_count(count) {}
+
+  AsyncSemaphore(const AsyncSemaphore&) = delete;
+  AsyncSemaphore& operator=(const AsyncSemaphore&) = delete;
+
+  //returns a permit when it goes out of scope
+  class [[nodiscard]] Guard {
+   public:
+    explicit Guard(AsyncSemaphore* semaphore) : m_semaphore(semaphore) {}
+    Guard(Guard&& other) noexcept
+        : m_semaphore(std::exchange(other.m_semaphore, nullptr)) {}
+    Guard& operator=(Guard&& other) noexcept {
+      if (this != &other) {
+        release();
+        m_semaphore = std::exchange(other.m_semaphore, nullptr);
+      }
+      return *this;
+    }
+    ~Guard() { release(); }
+
+    void release() {
+      if (m_semaphore)
+        std::exchange(m_semaphore, nullptr)->release();
+    }
+
+   private:
+    AsyncSemaphore* m_semaphore;
+  };
+
+  class AcquireAwaitable {
+   public:
+    explicit AcquireAwaitable(AsyncSemaphore& semaphore)
+        : m_semaphore(semaphore) {}
+
+    bool await_ready() { return m_semaphore.tryAcquire(); }
+
+    bool await_suspend(Coroutine::handle_type handle) {
+      m_handle = handle;
+      auto session = m_handle.promise().session();
+      std::lock_guard _(m_semaphore.m_mutex);
+      if (m_semaphore.m_count != 0 && m_semaphore.m_waiters.empty()) {
+        --m_semaphore.m_count;
+        return false;
+      }
+      m_waiter = std::make_shared<Detail::Waiter>();
+      m_waiter->session = session->weak_from_this();
+      m_semaphore.m_waiters.push_back(m_waiter);
+
+      m_handle.promise().m_awaiting = "acquire";
+      m_handle.promise().pause(
+          [waiter = m_waiter]() { return waiter->granted.load(); });
+      return true;
+    }
+
+    void await_resume() {
+      if (m_waiter && m_handle.promise().isCancelled())
+        m_semaphore.abandon(m_waiter);
+      if (m_waiter)
+        m_handle.promise().throwIfCancelled();
+    }
+
+   protected:
+    AsyncSemaphore& m_semaphore;
+    Coroutine::handle_type m_handle;
+    std::shared_ptr<Detail::Waiter> m_waiter;
+  };
+
+  class ScopedAwaitable : public AcquireAwaitable {
+   public:
+    using AcquireAwaitable::AcquireAwaitable;
+
+    Guard await_resume() {
+      AcquireAwaitable::await_resume();
+      return Guard(&m_semaphore);
+    }
+  };
+
+  //waits for a permit, give it back with release()
+  AcquireAwaitable acquire() { return AcquireAwaitable(*this); }
+  //waits for a permit that is given back by the returned guard
+  ScopedAwaitable scoped() { return ScopedAwaitable(*this); }
+
+  bool tryAcquire() {
+    std::lock_guard _(m_mutex);
+    if (m_count == 0 || !m_waiters.empty())
+      return false;
+    --m_count;
+    return true;
+  }
+
+  void release() {
+    while (true) {
+      std::shared_ptr<Detail::Waiter> waiter;
+      {
+        std::lock_guard _(m_mutex);
+        if (m_waiters.empty()) {
+          ++m_count;
+          return;
+        }
+        waiter = std::move(m_waiters.front());
+        m_waiters.pop_front();
+      }
+      //the session is queued outside the lock
+      if (Detail::grant(waiter))
+        return;
+    }
+  }
+
+  std::size_t available() {
+    std::lock_guard _(m_mutex);
+    return m_count;
+  }
+
+  std::size_t waiting() {
+    std::lock_guard _(m_mutex);
+    return m_waiters.size();
+  }
+
+ private:
+  //a cancelled waiter leaves the queue or passes its permit on
+  void abandon(const std::shared_ptr<Detail::Waiter>& waiter) {
+    {
+      std::lock_guard _(m_mutex);
+      auto it = std::find(m_waiters.begin(), m_waiters.end(), waiter);
+      if (it != m_waiters.end()) {
+        m_waiters.erase(it);
+        return;
+      }
+    }
+    release();
+  }
+
+  std::mutex m_mutex;
+  std::size_t m_count;
+  std::deque<std::shared_ptr<Detail::Waiter>> m_waiters;
+};
+
+/**
+ * @brief Mutex for coroutines, may be held across co_await.
+ *
+ *   auto guard = co_await mutex.scopedLock();
+ */
+class AsyncMutex {
+ public:
+  AsyncSemaphore::AcquireAwaitable lock() { return m_semaphore.acquire(); }
+  AsyncSemaphore::ScopedAwaitable scopedLock() { return m_semaphore.scoped(); }
+  bool tryLock() { return m_semaphore.tryAcquire(); }
+  void unlock() { m_semaphore.release(); }
+  bool locked() { return m_semaphore.available() == 0; }
+
+ private:
+  AsyncSemaphore m_semaphore{1};
+};
+
+/**
+ * @brief Single-use countdown: wait() suspends until countDown() was
+ * called count times, then every waiter is queued at once.
+ */
+class AsyncLatch {
+ public:
+  explicit AsyncLatch(std::size_t count) : m_count(count) {}
+
+  AsyncLatch(const AsyncLatch&) = delete;
+  AsyncLatch& operator=(const AsyncLatch&) = delete;
+
+  class WaitAwaitable {
+   public:
+    explicit WaitAwaitable(AsyncLatch& latch) : m_latch(latch) {}
+
+    bool await_ready() { return m_latch.ready(); }
+
+    bool await_suspend(Coroutine::handle_type handle) {
+      m_handle = handle;
+      auto session = m_handle.promise().session();
+      std::lock_guard _(m_latch.m_mutex);
+      if (m_latch.m_count == 0)
+        return false;
+      auto waiter = std::make_shared<Detail::Waiter>();
+      waiter->session = session->weak_from_this();
+      m_latch.m_waiters.push_back(waiter);
+
+      m_handle.promise().m_awaiting = "latch";
+      m_handle.promise().pause([waiter]() { return waiter->granted.load(); });
+      m_suspended = true;
+      return true;
+    }
+
+    void await_resume() {
+      if (m_suspended)
+        m_handle.promise().throwIfCancelled();
+    }
+
+   private:
+    AsyncLatch& m_latch;
+    Coroutine::handle_type m_handle;
+    bool m_suspended = false;
+  };
+
+  WaitAwaitable wait() { return WaitAwaitable(*this); }
+
+  void countDown(std::size_t n = 1) {
+    std::vector<std::shared_ptr<Detail::Waiter>> waiters;
+    {
+      std::lock_guard _(m_mutex);
+      if (m_count == 0)
+        return;
+      m_count -= std::min(n, m_count);
+      if (m_count != 0)
+        return;
+      waiters.swap(m_waiters);
+    }
+    for (auto& waiter : waiters)
+      Detail::grant(waiter);
+  }
+
+  bool ready() {
+    std::lock_guard _(m_mutex);
+    return m_count == 0;
+  }
+
+ private:
+  std::mutex m_mutex;
+  std::size_t m_count;
+  std::vector<std::shared_ptr<Detail::Waiter>> m_waiters;
+};
+
+}  // namespace ATgBot::Awaitables
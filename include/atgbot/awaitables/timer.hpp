@@ -4,53 +4,79 @@
 #include "atgbot/tools/timerevent.hpp"
 
 #include <chrono>
+#include <optional>
+#include <type_traits>
 
 namespace ATgBot::Awaitables {
 
+/**
+ * @brief Suspends the coroutine until a time point of the clock of its
+ * scheduler, which is virtual for simulated schedulers. A relative wait
+ * starts when the coroutine suspends.
+ */
 class TimerAwaitable {
  public:
   using Clock = ATgBot::Tools::DefaultTimer;
   using Duration = Clock::duration;
   using TimePoint = Clock::time_point;
 
-  TimerAwaitable(TimePoint until)
-      : m_filter{.m_enabled = true, .m_time_point = until} {}
+  TimerAwaitable(TimePoint until) : m_until(until) {}
+  explicit TimerAwaitable(Duration duration) : m_duration(duration) {}
 
-  bool await_ready() const noexcept {
-    return m_filter.check(ATgBot::Tools::TimerEvent());
-  }
+  bool await_ready() const noexcept { return false; }
 
-  void await_suspend(Coroutine::handle_type handle) noexcept {
+  //only the session knows its clock, a due timer does not suspend
+  bool await_suspend(Coroutine::handle_type handle) noexcept {
     this->m_handle = handle;
-    auto session = m_handle.promise().m_session;
+    auto session = m_handle.promise().session();
+    auto now = session->now();
+    auto until = m_until.value_or(now + m_duration);
+    if (now >= until)
+      return false;
 
-    session->timer_queue.setFilter(m_filter);
+    session->timer_queue.setFilter(
+        {.m_enabled = true, .m_time_point = until});
+    m_suspended = true;
 
+    m_handle.promise().m_awaiting = "timer";
     m_handle.promise().pause(
         [session]() { return !session->timer_queue.empty(); });
+    return true;
   }
 
-  void await_resume() noexcept {
-    auto e = m_handle.promise().m_session->timer_queue.pop();
+  void await_resume() {
+    m_handle.promise().throwIfCancelled();
+    if (!m_suspended)
+      return;
+    auto e = m_handle.promise().session()->timer_queue.pop();
 
-    m_handle.promise().m_session->timer_queue.setFilter(
+    m_handle.promise().session()->timer_queue.setFilter(
         Tools::EventFilter<Tools::TimerEvent>{});
   }
 
  private:
   Coroutine::handle_type m_handle;
-  ATgBot::Tools::EventFilter<ATgBot::Tools::TimerEvent> m_filter;
+  std::optional<TimePoint> m_until;
+  Duration m_duration{};
+  bool m_suspended = false;
 };
 
 template <class T, class U>
 TimerAwaitable waitFor(std::chrono::duration<T,U> duration) {
-  auto time_point = ATgBot::Tools::DefaultTimer::now() + std::chrono::duration_cast<ATgBot::Tools::DefaultTimer::duration>(duration); 
-  return TimerAwaitable(time_point);
+  return TimerAwaitable(
+      std::chrono::duration_cast<ATgBot::Tools::DefaultTimer::duration>(
+          duration));
 }
 
-template <class T, class U>
-TimerAwaitable waitUntil(std::chrono::time_point<T,U> time_point) {
-  return TimerAwaitable(std::chrono::time_point_cast<ATgBot::Tools::DefaultTimer::time_point>(time_point));
+//time points of other clocks are converted through their distance from now
+template <class C, class D>
+TimerAwaitable waitUntil(std::chrono::time_point<C, D> time_point) {
+  using ATgBot::Tools::DefaultTimer;
+  if constexpr (std::is_same_v<C, DefaultTimer>)
+    return TimerAwaitable(
+        std::chrono::time_point_cast<DefaultTimer::duration>(time_point));
+  else
+    return waitFor(time_point - C::now());
 }
 
 }  // namespace ATgBot::Awaitables
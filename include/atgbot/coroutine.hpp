@@ -2,7 +2,10 @@
 
 #include <atomic>
 #include <coroutine>
+#include <cstddef>
 #include <functional>
+#include <stdexcept>
+#include <thread>
 
 namespace ATgBot::Tools {
 class Session;
@@ -10,6 +13,15 @@ class Session;
 
 namespace ATgBot {
 
+/**
+ * @brief Thrown from a suspension point of a coroutine whose session was
+ * cancelled by the scheduler (for example evicted as idle).
+ */
+class CancelledError : public std::runtime_error {
+ public:
+  CancelledError() : std::runtime_error("coroutine session was cancelled") {}
+};
+
 class Coroutine {
  public:
   struct promise_type;
@@ -38,6 +50,15 @@ class Coroutine {
   explicit Coroutine(handle_type h) : coro(h) {}
 
   struct promise_type {
+    promise_type() : m_frame_size(t_frame_size) {}
+
+    //records the frame size so the scheduler can account for it
+    static void* operator new(std::size_t size) {
+      t_frame_size = size;
+      return ::operator new(size);
+    }
+    static void operator delete(void* ptr) { ::operator delete(ptr); }
+
     Coroutine get_return_object() {
       return Coroutine{handle_type::from_promise(*this)};
     }
@@ -80,7 +101,36 @@ class Coroutine {
       m_state = State::kWait;
     }
 
+    //wakes the coroutine up, the next awaitable resume throws CancelledError
+    void cancel() { m_cancelled = true; }
+    bool isCancelled() const { return m_cancelled; }
+    void throwIfCancelled() const {
+      if (m_cancelled)
+        throw CancelledError();
+    }
+
+    //session of the coroutine; one started by Session::runInline gets its
+    //session the first time the inline thread asks for it, or when the
+    //first resume returns. Other threads wait for that promotion.
+    ATgBot::Tools::Session* session() {
+      auto session = m_session.load(std::memory_order_acquire);
+      if (session || !m_inline.load(std::memory_order_acquire))
+        return session;
+      if (std::this_thread::get_id() == m_inline_thread) {
+        session = m_promote(m_promote_context);
+        m_session.store(session, std::memory_order_release);
+        m_session.notify_all();
+        return session;
+      }
+      m_session.wait(nullptr, std::memory_order_acquire);
+      return m_session.load(std::memory_order_acquire);
+    }
+
     void updateState() {
+      if (m_state == State::kWait && m_cancelled) {
+        m_state = State::kReady;
+        return;
+      }
       if (m_state == State::kWait) {
         //shouldnt happens
         if (!m_condition)
@@ -98,10 +148,24 @@ class Coroutine {
     //state and exception processing
     std::exception_ptr m_exception;
     //current session
-    ATgBot::Tools::Session* m_session = nullptr;
+    std::atomic<ATgBot::Tools::Session*> m_session{nullptr};
+    //creates the session of a coroutine running inline, only called on
+    //m_inline_thread while m_inline is set
+    ATgBot::Tools::Session* (*m_promote)(void*) = nullptr;
+    void* m_promote_context = nullptr;
+    std::atomic<bool> m_inline{false};
+    std::thread::id m_inline_thread;
+    //kind of the awaitable the coroutine waits on, for tracing and
+    //introspection
+    std::atomic<const char*> m_awaiting{nullptr};
+    //size of the coroutine frame in bytes
+    const std::size_t m_frame_size;
 
    private:
     State m_state;
+    std::atomic<bool> m_cancelled{false};
+
+    static inline thread_local std::size_t t_frame_size = 0;
   };
   friend class ATgBot::Tools::Session;
 
@@ -113,6 +177,17 @@ class Coroutine {
     return coro.promise().getState();
   }
 
+  void cancel() {
+    if (coro)
+      coro.promise().cancel();
+  }
+
+  std::size_t frameSize() const {
+    if (!coro)
+      return 0;
+    return coro.promise().m_frame_size;
+  }
+
   bool tryResume() {
     bool ret_value = true;
 
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <tgbot/tgbot.h>
+
+#include "atgbot/tools/sharedresult.hpp"
+#include "atgbot/tools/timerevent.hpp"
+
+namespace ATgBot::Tools {
+
+/**
+ * @brief Read-through cache with a TTL where concurrent misses of a key
+ * share one load.
+ *
+ * The first caller of a missing key runs the loader; callers arriving
+ * meanwhile get the pending result, which coroutines suspend on with
+ * Awaitables::awaitResult(). A failed load is not cached, its exception is
+ * rethrown to every waiter. At most max_entries keys are kept, expired ones
+ * go first, then the least recently used.
+ */
+template <typename Key, typename Value>
+class SingleflightCache {
+ public:
+  using Loader = std::function<Value()>;
+  using Result = std::shared_ptr<SharedResult<Value>>;
+
+  explicit SingleflightCache(std::size_t max_entries = 10000)
+      : m_max_entries(std::max<std::size_t>(max_entries, 1)) {}
+
+  //cached or pending result of the key, the caller that misses runs the
+  //load before it returns
+  Result fetch(const Key& key, DefaultTimer::duration ttl,
+               const Loader& load) {
+    Result result;
+    {
+      std::lock_guard _(m_mutex);
+      auto now = DefaultTimer::now();
+      auto it = m_entries.find(key);
+      if (it != m_entries.end() && it->second.expires <= now) {
+        remove(it);
+        it = m_entries.end();
+      }
+      if (it != m_entries.end()) {
+        m_recent.splice(m_recent.begin(), m_recent, it->second.recent);
+        ++m_hits;
+        return it->second.result;
+      }
+      if (m_entries.size() >= m_max_entries)
+        evict(now);
+      result = std::make_shared<SharedResult<Value>>();
+      m_recent.push_front(key);
+      m_entries.emplace(key, Entry{result, DefaultTimer::time_point::max(),
+                                   m_recent.begin()});
+      ++m_misses;
+    }
+    complete(key, ttl, load, result);
+    return result;
+  }
+
+  //blocks while another thread loads the key
+  Value get(const Key& key, DefaultTimer::duration ttl, const Loader& load) {
+    return fetch(key, ttl, load)->wait();
+  }
+
+  void erase(const Key& key) {
+    std::lock_guard _(m_mutex);
+    if (auto it = m_entries.find(key); it != m_entries.end())
+      remove(it);
+  }
+
+  //erases the keys in [from, to]
+  void eraseRange(const Key& from, const Key& to) {
+    std::lock_guard _(m_mutex);
+    auto end = m_entries.upper_bound(to);
+    for (auto it = m_entries.lower_bound(from); it != end;)
+      it = remove(it);
+  }
+
+  std::size_t size() const {
+    std::lock_guard _(m_mutex);
+    return m_entries.size();
+  }
+
+  std::size_t hitCount() const { return m_hits; }
+  std::size_t missCount() const { return m_misses; }
+
+ private:
+  struct Entry {
+    //also tells a load apart from a newer one after the key was erased
+    Result result;
+    DefaultTimer::time_point expires;
+    typename std::list<Key>::iterator recent;
+  };
+  using Iterator = typename std::map<Key, Entry>::iterator;
+
+  void complete(const Key& key, DefaultTimer::duration ttl,
+                const Loader& load, const Result& result) {
+    try {
+      result->setValue(load());
+    } catch (...) {
+      {
+        std::lock_guard _(m_mutex);
+        auto it = m_entries.find(key);
+        if (it != m_entries.end() && it->second.result == result)
+          remove(it);
+      }
+      result->setException(std::current_exception());
+      return;
+    }
+    // an invalidation during the load already dropped the entry
+    std::lock_guard _(m_mutex);
+    auto it = m_entries.find(key);
+    if (it != m_entries.end() && it->second.result == result)
+      it->second.expires = DefaultTimer::now() + ttl;
+  }
+
+  Iterator remove(Iterator it) {
+    m_recent.erase(it->second.recent);
+    return m_entries.erase(it);
+  }
+
+  //drops expired entries, else the least recently used one; a pending
+  //load still reaches its waiters but is not cached
+  void evict(DefaultTimer::time_point now) {
+    for (auto it = m_entries.begin(); it != m_entries.end();)
+      it = it->second.expires <= now ? remove(it) : std::next(it);
+    if (m_entries.size() >= m_max_entries)
+      remove(m_entries.find(m_recent.back()));
+  }
+
+  const std::size_t m_max_entries;
+  mutable std::mutex m_mutex;
+  std::map<Key, Entry> m_entries;
+  //most recently used first
+  std::list<Key> m_recent;
+  std::atomic<std::size_t> m_hits = 0;
+  std::atomic<std::size_t> m_misses = 0;
+};
+
+/**
+ * @brief Cached chat lookups of the Bot API.
+ *
+ * getChat, getChatMember and getChatAdministrators go through a
+ * SingleflightCache with a TTL per method. Chat member updates and join
+ * requests drop the entries they make stale.
+ *
+ * The get methods block while another thread loads the key; handlers
+ * co_await Awaitables::awaitResult() on the fetch methods instead.
+ */
+class ApiCache {
+ public:
+  struct Ttls {
+    DefaultTimer::duration chat = std::chrono::minutes(5);
+    DefaultTimer::duration member = std::chrono::seconds(60);
+    DefaultTimer::duration administrators = std::chrono::minutes(5);
+  };
+
+  explicit ApiCache(const TgBot::Api& api) : ApiCache(api, Ttls()) {}
+  ApiCache(const TgBot::Api& api, Ttls ttls) : m_api(api), m_ttls(ttls) {}
+
+  using ChatResult = std::shared_ptr<SharedResult<TgBot::Chat::Ptr>>;
+  using MemberResult = std::shared_ptr<SharedResult<TgBot::ChatMember::Ptr>>;
+  using AdministratorsResult =
+      std::shared_ptr<SharedResult<std::vector<TgBot::ChatMember::Ptr>>>;
+
+  TgBot::Chat::Ptr getChat(std::int64_t chat_id);
+  TgBot::ChatMember::Ptr getChatMember(std::int64_t chat_id,
+                                       std::int64_t user_id);
+  std::vector<TgBot::ChatMember::Ptr> getChatAdministrators(
+      std::int64_t chat_id);
+
+  ChatResult fetchChat(std::int64_t chat_id);
+  MemberResult fetchChatMember(std::int64_t chat_id, std::int64_t user_id);
+  AdministratorsResult fetchChatAdministrators(std::int64_t chat_id);
+
+  void invalidate(const TgBot::ChatMemberUpdated::Ptr& update);
+  void invalidate(const TgBot::ChatJoinRequest::Ptr& request);
+  //drops every entry of the chat
+  void invalidateChat(std::int64_t chat_id);
+
+  std::size_t hitCount() const;
+  std::size_t missCount() const;
+
+ private:
+  using MemberKey = std::pair<std::int64_t, std::int64_t>;
+
+  const TgBot::Api& m_api;
+  const Ttls m_ttls;
+  SingleflightCache<std::int64_t, TgBot::Chat::Ptr> m_chats;
+  SingleflightCache<MemberKey, TgBot::ChatMember::Ptr> m_members;
+  SingleflightCache<std::int64_t, std::vector<TgBot::ChatMember::Ptr>>
+      m_administrators;
+};
+
+}  // namespace ATgBot::Tools
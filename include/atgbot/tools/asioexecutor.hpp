@@ -0,0 +1,166 @@
+#pragma once
+
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+
+#include "scheduler.hpp"
+#include "timerevent.hpp"
+
+namespace ATgBot::Tools {
+
+/**
+ * @brief Sessions resume as handlers posted to a Boost.Asio executor, so a
+ * bot shares the event loop and the threads of the services it talks to.
+ * Timers of sessions are steady_timers on the same executor; the scheduler
+ * starts no threads of its own.
+ *
+ *   boost::asio::io_context io;
+ *   AsioScheduler scheduler(io.get_executor());
+ *   ...
+ *   io.run();
+ *
+ * The scheduler must be destroyed outside the handlers of its executor.
+ */
+struct AsioExecutor {
+  using Mutex = std::recursive_mutex;
+  using Executor = boost::asio::any_io_executor;
+  static constexpr bool kThreaded = true;
+  static constexpr bool kSimulated = false;
+
+  class Backend;
+};
+
+class AsioExecutor::Backend {
+  //shared with the handlers, which may outlive the backend
+  struct State {
+    explicit State(Executor e) : executor(std::move(e)) {}
+
+    //false once the backend is stopping, the handler must not run
+    bool enter() {
+      ++active;
+      if (stopped) {
+        leave();
+        return false;
+      }
+      return true;
+    }
+    void leave() {
+      if (--active == 0 && stopped) {
+        std::lock_guard _(idle_mutex);
+        idle.notify_all();
+      }
+    }
+
+    Executor executor;
+    std::function<void()> run_one;
+    std::function<void()> tick;
+    std::chrono::steady_clock::duration tick_interval;
+    std::atomic<bool> stopped{false};
+    std::atomic<int> active{0};
+    // the destructor waits here until no handler is active
+    std::mutex idle_mutex;
+    std::condition_variable idle;
+
+    // timer calls are serialized by the mutex
+    std::mutex mutex;
+    std::unique_ptr<boost::asio::steady_timer> ticker;
+    std::unordered_set<std::shared_ptr<boost::asio::steady_timer>> timers;
+  };
+
+ public:
+  Backend(Executor executor, std::function<void()> run_one,
+          std::function<void()> tick,
+          std::chrono::steady_clock::duration tick_interval)
+      : m_state(std::make_shared<State>(std::move(executor))) {
+    m_state->run_one = std::move(run_one);
+    m_state->tick = std::move(tick);
+    m_state->tick_interval = tick_interval;
+    m_state->ticker =
+        std::make_unique<boost::asio::steady_timer>(m_state->executor);
+    std::lock_guard _(m_state->mutex);
+    scheduleTick(m_state);
+  }
+
+  //cancels the timers and waits for the handlers that already entered
+  ~Backend() {
+    {
+      std::lock_guard _(m_state->mutex);
+      m_state->stopped = true;
+      m_state->ticker->cancel();
+      for (auto& timer : m_state->timers)
+        timer->cancel();
+      m_state->timers.clear();
+    }
+    std::unique_lock lock(m_state->idle_mutex);
+    m_state->idle.wait(lock, [this]() { return m_state->active == 0; });
+  }
+
+  Backend(const Backend&) = delete;
+  Backend& operator=(const Backend&) = delete;
+
+  //posts one resume of the best queued session
+  void post() {
+    boost::asio::post(m_state->executor, [state = m_state]() {
+      if (!state->enter())
+        return;
+      state->run_one();
+      state->leave();
+    });
+  }
+
+  //calls fire on the executor at the time point
+  void arm(DefaultTimer::time_point at, std::function<void()> fire) {
+    auto timer =
+        std::make_shared<boost::asio::steady_timer>(m_state->executor);
+    std::lock_guard _(m_state->mutex);
+    if (m_state->stopped)
+      return;
+    timer->expires_after(at - DefaultTimer::now());
+    timer->async_wait([state = m_state, timer, fire = std::move(fire)](
+                          const boost::system::error_code& error) {
+      {
+        std::lock_guard _(state->mutex);
+        state->timers.erase(timer);
+      }
+      if (error || !state->enter())
+        return;
+      fire();
+      state->leave();
+    });
+    m_state->timers.insert(std::move(timer));
+  }
+
+  const Executor& executor() const { return m_state->executor; }
+
+ private:
+  //called under the state mutex
+  static void scheduleTick(const std::shared_ptr<State>& state) {
+    state->ticker->expires_after(state->tick_interval);
+    state->ticker->async_wait(
+        [state](const boost::system::error_code& error) {
+          if (error || !state->enter())
+            return;
+          state->tick();
+          {
+            std::lock_guard _(state->mutex);
+            if (!state->stopped)
+              scheduleTick(state);
+          }
+          state->leave();
+        });
+  }
+
+  std::shared_ptr<State> m_state;
+};
+
+using AsioScheduler = BasicScheduler<AsioExecutor>;
+
+}  // namespace ATgBot::Tools
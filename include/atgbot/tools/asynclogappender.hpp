@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+#include <plog/Appenders/IAppender.h>
+
+namespace ATgBot::Tools {
+
+class ShmRing;
+
+/**
+ * @brief plog appender that never blocks the logging thread.
+ *
+ * write() copies the record into a binary ring of the calling thread; the
+ * message is truncated to kMaxMessage bytes. A background thread formats
+ * the records like plog::TxtFormatter and writes them to the stream. When
+ * a ring is full the record is dropped and counted, the count is logged
+ * by the background thread. The ring of a thread is released once the
+ * thread exited and its records are written.
+ *
+ * Usage:
+ * @code
+ * static ATgBot::Tools::AsyncLogAppender appender(std::clog);
+ * plog::init(plog::debug, &appender);
+ * @endcode
+ */
+class AsyncLogAppender : public plog::IAppender {
+ public:
+  static constexpr std::size_t kMaxMessage = 256;
+  static constexpr std::size_t kDefaultRingBytes = 256 * 1024;
+
+  explicit AsyncLogAppender(std::ostream& stream,
+                            std::size_t ring_bytes = kDefaultRingBytes);
+  //writes the remaining records
+  ~AsyncLogAppender() override;
+
+  AsyncLogAppender(const AsyncLogAppender&) = delete;
+  AsyncLogAppender& operator=(const AsyncLogAppender&) = delete;
+
+  void write(const plog::Record& record) override;
+
+  //formats and writes everything queued so far
+  void flush();
+
+  std::uint64_t droppedCount() const { return m_dropped; }
+  //rings not released yet
+  std::size_t ringCount();
+
+ private:
+  struct ThreadRing;
+
+  ThreadRing& threadRing();
+  //takes all queued records, returns false if there were none
+  bool drain();
+  void thread();
+
+  std::ostream& m_stream;
+  const std::size_t m_ring_bytes;
+  const std::uint64_t m_id;
+
+  std::mutex m_rings_mutex;
+  std::vector<std::shared_ptr<ThreadRing>> m_rings;
+  std::mutex m_drain_mutex;
+
+  std::atomic<std::uint64_t> m_dropped{0};
+  std::uint64_t m_reported_dropped = 0;
+  std::atomic<bool> m_running{true};
+  std::thread m_thread;
+};
+
+}  // namespace ATgBot::Tools
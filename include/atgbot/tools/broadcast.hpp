@@ -0,0 +1,130 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <tgbot/tgbot.h>
+
+namespace ATgBot::Tools {
+
+/**
+ * @brief Sends one message to a long list of chats.
+ *
+ * A bounded pool of threads keeps at most `in_flight` requests running,
+ * paced by a token bucket below the global limit of the Bot API, so
+ * normal traffic of the bot keeps its share. Scheduler workers are never
+ * used. Chats that blocked the bot are counted and skipped, a 429 pauses
+ * every sender for its retry_after, other errors are retried.
+ *
+ * With a checkpoint file the number of finished recipients is kept in a
+ * memory mapping; a new broadcast with the same file and recipients skips
+ * them. Up to `in_flight` recipients after the checkpoint may receive the
+ * message twice after a crash.
+ */
+class Broadcast {
+ public:
+  //yields recipients in a stable order, std::nullopt after the last one
+  using Recipients = std::function<std::optional<std::int64_t>()>;
+  //sends the message to one chat, throws TgBot::TgException on API errors
+  using Send = std::function<void(std::int64_t chat_id)>;
+
+  struct Options {
+    std::size_t in_flight = 8;
+    double rate = 25;  ///< messages per second
+    std::size_t max_retries = 3;
+    std::string checkpoint;  ///< progress file, empty disables resuming
+  };
+
+  struct Stats {
+    std::uint64_t sent = 0;
+    std::uint64_t blocked = 0;  ///< 403, the chat blocked the bot
+    std::uint64_t failed = 0;   ///< gave up after the retries
+    std::uint64_t retried = 0;
+    std::uint64_t rate_limited = 0;  ///< 429 answers
+    std::uint64_t position = 0;      ///< finished recipients in order
+    double per_second = 0;           ///< sent since start()
+  };
+
+  Broadcast(Recipients recipients, Send send);
+  Broadcast(Recipients recipients, Send send, Options options);
+  //stops and waits for the requests in flight
+  ~Broadcast();
+
+  Broadcast(const Broadcast&) = delete;
+  Broadcast& operator=(const Broadcast&) = delete;
+
+  //starts the senders, resuming from the checkpoint
+  void start();
+  //no new requests are started, the progress is kept
+  void stop();
+  //blocks until every recipient is done or the broadcast is stopped
+  void wait();
+  bool done() const { return m_done; }
+  Stats stats() const;
+
+  template <class It>
+  static Recipients fromRange(It begin, It end) {
+    return [begin, end]() mutable -> std::optional<std::int64_t> {
+      if (begin == end)
+        return std::nullopt;
+      return static_cast<std::int64_t>(*begin++);
+    };
+  }
+  //memory-mapped file of native 64-bit chat ids
+  static Recipients fromIdFile(const std::string& path);
+  //sendMessage with plain text
+  static Send textMessage(const TgBot::Api& api, std::string text);
+
+  //seconds of a "retry after N" error, std::nullopt for other errors
+  static std::optional<std::chrono::seconds> retryAfter(
+      const TgBot::TgException& e);
+
+ private:
+  struct Checkpoint;
+
+  void worker();
+  std::optional<std::pair<std::uint64_t, std::int64_t>> claim();
+  //false if the broadcast stopped before the recipient was settled
+  bool deliver(std::int64_t chat_id);
+  bool acquireToken();
+  void finish(std::uint64_t index);
+
+  Recipients m_recipients;
+  Send m_send;
+  Options m_options;
+  std::unique_ptr<Checkpoint> m_checkpoint;
+
+  std::vector<std::thread> m_threads;
+  std::atomic<bool> m_stopped{false};
+  std::atomic<bool> m_done{false};
+  std::atomic<int> m_active{0};
+
+  // guarded by m_mutex
+  mutable std::mutex m_mutex;
+  std::uint64_t m_next = 0;
+  std::uint64_t m_position = 0;
+  bool m_exhausted = false;
+  std::set<std::uint64_t> m_finished;  ///< finished after m_position
+  double m_tokens = 1;
+  std::chrono::steady_clock::time_point m_refill;
+  std::chrono::steady_clock::time_point m_paused_until;
+  std::chrono::steady_clock::time_point m_started;
+
+  std::atomic<std::uint64_t> m_sent{0};
+  std::atomic<std::uint64_t> m_blocked{0};
+  std::atomic<std::uint64_t> m_failed{0};
+  std::atomic<std::uint64_t> m_retried{0};
+  std::atomic<std::uint64_t> m_rate_limited{0};
+};
+
+}  // namespace ATgBot::Tools
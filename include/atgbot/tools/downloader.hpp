@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <tgbot/tgbot.h>
+
+namespace ATgBot::Tools {
+
+/**
+ * @brief Bounded pool that streams Telegram files in chunks.
+ *
+ * At most `concurrency` files are in flight; further jobs wait in a queue.
+ * The body is read into one fixed buffer per thread and handed to the sink
+ * chunk by chunk, so memory does not grow with the file size. Scheduler
+ * workers are never blocked, completion is reported through a callback.
+ */
+class Downloader {
+ public:
+  using ChunkSink = std::function<void(std::string_view chunk)>;
+  //fetches https://host/target and feeds the body to the sink, stops early
+  //when abort is set
+  using Fetch = std::function<void(const std::string& host,
+                                   const std::string& target,
+                                   const ChunkSink& sink,
+                                   const std::atomic<bool>& abort)>;
+  //path of the file on the download server, getFile of the Bot API
+  using FilePath = std::function<std::string(const TgBot::Bot& bot,
+                                             const std::string& file_id)>;
+
+  struct Job {
+    const TgBot::Bot* bot = nullptr;
+    std::string file_id;
+    ChunkSink sink;
+    std::shared_ptr<std::atomic<bool>> abort;
+    //flushes the sink after the last chunk, also when the download failed
+    std::function<void()> finish;
+    //receives the error of the download, nullptr on success
+    std::function<void(std::exception_ptr)> done;
+  };
+
+  static constexpr std::size_t kDefaultConcurrency = 4;
+  static constexpr std::size_t kChunkSize = 64 * 1024;
+  static constexpr const char* kHost = "api.telegram.org";
+
+  explicit Downloader(std::size_t concurrency = kDefaultConcurrency,
+                      Fetch fetch = httpsFetch,
+                      FilePath file_path = apiFilePath);
+  ~Downloader();
+
+  Downloader(const Downloader&) = delete;
+  Downloader& operator=(const Downloader&) = delete;
+
+  void submit(Job job);
+
+  //pool used by downloadTo() unless another one is given
+  static Downloader& shared();
+
+  //streaming HTTPS GET over Boost.Beast
+  static void httpsFetch(const std::string& host, const std::string& target,
+                         const ChunkSink& sink, const std::atomic<bool>& abort);
+
+  static std::string apiFilePath(const TgBot::Bot& bot,
+                                 const std::string& file_id);
+
+ private:
+  void thread();
+  void process(Job& job);
+
+  Fetch m_fetch;
+  FilePath m_file_path;
+  std::queue<Job> m_jobs;
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+  bool m_running = true;
+  std::vector<std::thread> m_threads;
+};
+
+}  // namespace ATgBot::Tools
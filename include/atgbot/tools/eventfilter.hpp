@@ -1,9 +1,99 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <new>
+#include <optional>
+#include <string>
+#include <utility>
 
 namespace ATgBot::Tools {
 
+/**
+ * @brief Key terms of a filter that a router can index on.
+ *
+ * An unset key means the filter accepts any value of it.
+ */
+struct FilterKeys {
+  std::optional<std::int64_t> user;
+  std::optional<std::int64_t> chat;
+  std::optional<std::int64_t> message_id;
+  std::optional<std::string> prefix;
+};
+
+/**
+ * @brief Extracts the key fields of an event, specialized per event type.
+ */
+template <typename T>
+struct EventFields;
+
+/**
+ * @brief Predicate of ATgBot::Filters stored in place.
+ *
+ * The composed predicate keeps its static type inside, so it is one call
+ * through a function pointer and never allocates; only textPrefix copies
+ * its prefix.
+ */
+template <typename T>
+class InlinePredicate {
+ public:
+  static constexpr std::size_t kCapacity = 96;
+
+  InlinePredicate() = default;
+  template <typename P>
+  explicit InlinePredicate(P predicate) {
+    static_assert(sizeof(P) <= kCapacity &&
+                      alignof(P) <= alignof(std::max_align_t),
+                  "predicate too large, use setAdditionalFilter()");
+    new (m_storage) P(std::move(predicate));
+    m_ops = &kOps<P>;
+  }
+  InlinePredicate(const InlinePredicate& other) { copyFrom(other); }
+  InlinePredicate& operator=(const InlinePredicate& other) {
+    if (this != &other) {
+      reset();
+      copyFrom(other);
+    }
+    return *this;
+  }
+  ~InlinePredicate() { reset(); }
+
+  explicit operator bool() const { return m_ops != nullptr; }
+  bool operator()(const T& elem) const { return m_ops->call(m_storage, elem); }
+
+  void reset() {
+    if (m_ops)
+      m_ops->destroy(m_storage);
+    m_ops = nullptr;
+  }
+
+ private:
+  struct Ops {
+    bool (*call)(const void*, const T&);
+    void (*copy)(const void*, void*);
+    void (*destroy)(void*);
+  };
+  template <typename P>
+  static constexpr Ops kOps{
+      [](const void* p, const T& elem) -> bool {
+        return (*static_cast<const P*>(p))(elem);
+      },
+      [](const void* from, void* to) {
+        new (to) P(*static_cast<const P*>(from));
+      },
+      [](void* p) { static_cast<P*>(p)->~P(); }};
+
+  void copyFrom(const InlinePredicate& other) {
+    if (other.m_ops)
+      other.m_ops->copy(other.m_storage, m_storage);
+    m_ops = other.m_ops;
+  }
+
+  alignas(std::max_align_t) unsigned char m_storage[kCapacity];
+  const Ops* m_ops = nullptr;
+};
+
 template <typename T>
 class EventFilter {
   using Predicate = std::function<bool(T)>;
@@ -12,16 +102,32 @@ class EventFilter {
   bool check(const T& elem) const {
     if (!m_enabled)
       return false;
+    if (m_predicate)
+      return m_predicate(elem);
     if (m_additional_filter)
       return m_additional_filter(elem);
     return true;
   }
-  void setAdditionalFilter(const Predicate& p) { m_additional_filter = p; }
+  void setAdditionalFilter(const Predicate& p) {
+    m_additional_filter = p;
+    m_predicate.reset();
+    m_keys = {};
+  }
+  //sets a predicate built with ATgBot::Filters and keeps its key terms
+  template <typename P>
+    requires requires(const P& p) { p.keys(); }
+  void setPredicate(P p) {
+    m_keys = p.keys();
+    m_predicate = InlinePredicate<T>(std::move(p));
+    m_additional_filter = nullptr;
+  }
   void setEnabled(bool v) { m_enabled = v; }
+  const FilterKeys& keys() const { return m_keys; }
 
   bool m_enabled = false;
   Predicate m_additional_filter;
+  InlinePredicate<T> m_predicate;
+  FilterKeys m_keys;
 };
 
-
 }  // namespace ATgBot
@@ -1,64 +1,302 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
 #include <functional>
-#include <queue>
-#include <optional>
+#include <memory>
 #include <mutex>
+#include <new>
+#include <optional>
+#include <utility>
 
 #include "eventfilter.hpp"
+#include "loadlimits.hpp"
 
 namespace ATgBot::Tools {
 
-template <typename T>
+/**
+ * @brief Multi-producer, single-consumer queue of filtered events.
+ *
+ * Events live in an inline ring of N slots; only when the ring is full they
+ * spill into a locked overflow list. The filter is swapped by an atomic
+ * pointer exchange. Every event is tagged with the generation of the filter
+ * it passed, so events that raced with setFilter() or clear() are dropped
+ * by the consumer; setFilter() and clear() never drop an event of the new
+ * generation.
+ *
+ * A bounded queue (setLimit()) keeps every event in the locked list, where
+ * producers can apply the overflow policy.
+ *
+ * push() and queued() may be called from any thread, the other members
+ * only from the thread that owns the session.
+ *
+ * @tparam T The type of events.
+ * @tparam N Inline capacity, a power of two.
+ */
+template <typename T, std::size_t N = 4>
 class EventQueue {
+  static_assert(N > 0 && (N & (N - 1)) == 0, "N must be a power of two");
+
+  struct FilterState {
+    EventFilter<T> filter;
+    std::uint64_t generation;
+  };
+
+  struct Slot {
+    std::atomic<std::size_t> sequence;
+    std::uint64_t generation;
+    alignas(T) unsigned char storage[sizeof(T)];
+
+    T* get() { return std::launder(reinterpret_cast<T*>(storage)); }
+    const T* get() const {
+      return std::launder(reinterpret_cast<const T*>(storage));
+    }
+  };
+
+  using Overflow = std::deque<std::pair<T, std::uint64_t>>;
+
  public:
+  EventQueue() : m_filter(std::make_shared<const FilterState>()) {
+    for (std::size_t i = 0; i < N; ++i)
+      m_slots[i].sequence.store(i, std::memory_order_relaxed);
+  }
+  ~EventQueue() { drop(); }
+
+  EventQueue(const EventQueue&) = delete;
+  EventQueue& operator=(const EventQueue&) = delete;
+
   void setFilter(const EventFilter<T>& filter) {
-    std::lock_guard _(m_mutex);
+    auto generation = m_filter.load()->generation + 1;
+    m_filter.store(
+        std::make_shared<const FilterState>(FilterState{filter, generation}));
     m_has_changes = true;
-    clear();
-    m_filter = filter;
-  }
-  EventFilter<T> getFilter() const {
-    std::lock_guard _(m_mutex);
-    return m_filter;
+    dropStale(generation);
   }
+  EventFilter<T> getFilter() const { return m_filter.load()->filter; }
   void clear() {
-    std::lock_guard _(m_mutex);
-    while (!m_queue.empty())
-      m_queue.pop();
+    auto state = m_filter.load();
+    m_filter.store(std::make_shared<const FilterState>(
+        FilterState{state->filter, state->generation + 1}));
+    dropStale(state->generation + 1);
   }
   bool empty() const {
-    std::lock_guard _(m_mutex);
-    return m_queue.empty();
+    auto generation = m_filter.load()->generation;
+    std::size_t pos = m_dequeue.load(std::memory_order_relaxed);
+    for (;; ++pos) {
+      const Slot& slot = m_slots[pos & kMask];
+      if (slot.sequence.load(std::memory_order_acquire) != pos + 1)
+        break;
+      if (slot.generation == generation)
+        return false;
+    }
+    if (m_overflow_size.load(std::memory_order_acquire) == 0)
+      return true;
+    std::lock_guard _(m_overflow_mutex);
+    for (auto& [element, element_generation] : *m_overflow)
+      if (element_generation == generation)
+        return false;
+    return true;
+  }
+
+  //number of queued events that passed the current filter, consumer only
+  std::size_t size() const {
+    auto generation = m_filter.load()->generation;
+    std::size_t count = 0;
+    std::size_t pos = m_dequeue.load(std::memory_order_relaxed);
+    for (;; ++pos) {
+      const Slot& slot = m_slots[pos & kMask];
+      if (slot.sequence.load(std::memory_order_acquire) != pos + 1)
+        break;
+      if (slot.generation == generation)
+        ++count;
+    }
+    if (m_overflow_size.load(std::memory_order_acquire) == 0)
+      return count;
+    std::lock_guard _(m_overflow_mutex);
+    for (auto& [element, element_generation] : *m_overflow)
+      if (element_generation == generation)
+        ++count;
+    return count;
+  }
+  //number of queued events for any thread, also counts events of a
+  //replaced filter that the consumer did not skip yet
+  std::size_t queued() const {
+    return m_queued.load(std::memory_order_relaxed);
   }
 
-  void push(const T& element) {
-    std::lock_guard _(m_mutex);
-    if (m_filter.check(element))
-      m_queue.emplace(element);
+  //false if the filter rejected the event
+  bool push(const T& element) {
+    auto state = m_filter.load();
+    if (!state->filter.check(element))
+      return false;
+    if (m_max_events.load(std::memory_order_acquire) != 0) {
+      pushBounded(element, state->generation);
+      return true;
+    }
+    if (m_overflow_size.load(std::memory_order_acquire) == 0 &&
+        tryPushInline(element, state->generation))
+      return true;
+    std::lock_guard _(m_overflow_mutex);
+    if (!m_overflow)
+      m_overflow = std::make_unique<Overflow>();
+    m_overflow->emplace_back(element, state->generation);
+    m_queued.fetch_add(1, std::memory_order_relaxed);
+    m_overflow_size.fetch_add(1, std::memory_order_release);
+    return true;
   }
   std::optional<T> pop() {
-    std::lock_guard _(m_mutex);
-    if (m_queue.empty())
-      return std::nullopt;
-    auto elem = m_queue.front();
-    m_queue.pop();
-    return elem;
+    auto generation = m_filter.load()->generation;
+    while (true) {
+      auto element = popAny();
+      if (!element)
+        return std::nullopt;
+      if (element->second == generation)
+        return std::move(element->first);
+    }
   }
-  void resetChanges() {
-    std::lock_guard _(m_mutex);
-    m_has_changes = false;
+  //bounds the queue; events already in the inline ring stay there
+  void setLimit(const QueueLimit& limit) {
+    std::lock_guard _(m_overflow_mutex);
+    m_policy = limit.policy;
+    m_max_events.store(limit.max_events, std::memory_order_release);
   }
-  bool hasChanges() const {
-    std::lock_guard _(m_mutex);
-    return m_has_changes;
+  QueueLimit limit() const {
+    std::lock_guard _(m_overflow_mutex);
+    return {m_max_events.load(std::memory_order_relaxed), m_policy};
   }
+  //changes on every setFilter() and clear()
+  std::uint64_t generation() const { return m_filter.load()->generation; }
+  std::uint64_t droppedCount() const { return m_dropped; }
+
+  void resetChanges() { m_has_changes = false; }
+  bool hasChanges() const { return m_has_changes; }
 
  private:
-  EventFilter<T> m_filter;
-  mutable bool m_has_changes = true;
-  std::queue<T> m_queue;
-  mutable std::recursive_mutex m_mutex;
+  static constexpr std::size_t kMask = N - 1;
+
+  bool tryPushInline(const T& element, std::uint64_t generation) {
+    std::size_t pos = m_enqueue.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (true) {
+      slot = &m_slots[pos & kMask];
+      std::size_t sequence = slot->sequence.load(std::memory_order_acquire);
+      auto diff = static_cast<std::ptrdiff_t>(sequence) -
+                  static_cast<std::ptrdiff_t>(pos);
+      if (diff == 0) {
+        if (m_enqueue.compare_exchange_weak(pos, pos + 1,
+                                            std::memory_order_relaxed))
+          break;
+      } else if (diff < 0) {
+        return false;  // full
+      } else {
+        pos = m_enqueue.load(std::memory_order_relaxed);
+      }
+    }
+    new (slot->storage) T(element);
+    slot->generation = generation;
+    //counted before the consumer can see it, so the counter never wraps
+    m_queued.fetch_add(1, std::memory_order_relaxed);
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  void pushBounded(const T& element, std::uint64_t generation) {
+    std::lock_guard _(m_overflow_mutex);
+    if (!m_overflow)
+      m_overflow = std::make_unique<Overflow>();
+    auto max_events = m_max_events.load(std::memory_order_relaxed);
+    if (max_events != 0 && m_overflow->size() >= max_events)
+      eraseStale(m_filter.load()->generation);
+    if (max_events != 0 && m_overflow->size() >= max_events) {
+      std::size_t dropped = 0;
+      switch (m_policy) {
+        case OverflowPolicy::kDropNew:
+          ++m_dropped;
+          return;
+        case OverflowPolicy::kDropOldest:
+          dropped = m_overflow->size() - max_events + 1;
+          m_overflow->erase(m_overflow->begin(),
+                            m_overflow->begin() + dropped);
+          break;
+        case OverflowPolicy::kCoalesce:
+          dropped = m_overflow->size();
+          m_overflow->clear();
+          break;
+      }
+      m_dropped += dropped;
+      m_queued.fetch_sub(dropped, std::memory_order_relaxed);
+      m_overflow_size.fetch_sub(dropped, std::memory_order_release);
+    }
+    m_overflow->emplace_back(element, generation);
+    m_queued.fetch_add(1, std::memory_order_relaxed);
+    m_overflow_size.fetch_add(1, std::memory_order_release);
+  }
+
+  std::optional<std::pair<T, std::uint64_t>> popAny() {
+    std::size_t pos = m_dequeue.load(std::memory_order_relaxed);
+    Slot& slot = m_slots[pos & kMask];
+    if (slot.sequence.load(std::memory_order_acquire) == pos + 1) {
+      std::pair<T, std::uint64_t> element{std::move(*slot.get()),
+                                          slot.generation};
+      slot.get()->~T();
+      m_queued.fetch_sub(1, std::memory_order_relaxed);
+      m_dequeue.store(pos + 1, std::memory_order_relaxed);
+      slot.sequence.store(pos + N, std::memory_order_release);
+      return element;
+    }
+    if (m_overflow_size.load(std::memory_order_acquire) == 0)
+      return std::nullopt;
+    std::lock_guard _(m_overflow_mutex);
+    auto element = std::move(m_overflow->front());
+    m_overflow->pop_front();
+    m_queued.fetch_sub(1, std::memory_order_relaxed);
+    m_overflow_size.fetch_sub(1, std::memory_order_release);
+    return element;
+  }
+
+  void drop() {
+    while (popAny()) {}
+  }
+
+  //an event pushed for the new filter between the generation swap and the
+  //cleanup must survive, so only stale events are dropped here; stale
+  //events left in the ring are skipped by pop()
+  void dropStale(std::uint64_t generation) {
+    std::lock_guard _(m_overflow_mutex);
+    eraseStale(generation);
+  }
+
+  //called under m_overflow_mutex
+  void eraseStale(std::uint64_t generation) {
+    if (!m_overflow)
+      return;
+    auto removed = std::erase_if(*m_overflow, [generation](const auto& e) {
+      return e.second != generation;
+    });
+    m_queued.fetch_sub(removed, std::memory_order_relaxed);
+    m_overflow_size.fetch_sub(removed, std::memory_order_release);
+  }
+
+  std::array<Slot, N> m_slots;
+  std::atomic<std::size_t> m_enqueue{0};
+  std::atomic<std::size_t> m_dequeue{0};
+
+  std::atomic<std::size_t> m_overflow_size{0};
+  //events in the ring and the overflow list, of any generation
+  std::atomic<std::size_t> m_queued{0};
+  std::unique_ptr<Overflow> m_overflow;
+  mutable std::mutex m_overflow_mutex;
+
+  std::atomic<std::shared_ptr<const FilterState>> m_filter;
+  std::atomic<bool> m_has_changes{true};
+
+  // the policy is guarded by m_overflow_mutex
+  std::atomic<std::size_t> m_max_events{0};
+  OverflowPolicy m_policy = OverflowPolicy::kDropOldest;
+  std::atomic<std::uint64_t> m_dropped{0};
 };
 
-}  // namespace ATgBot
+}  // namespace ATgBot::Tools
@@ -1,16 +1,27 @@
 #pragma once
 
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
 #include "eventqueue.hpp"
+#include "filters.hpp"
 #include "session.hpp"
+#include "trace.hpp"
 
 namespace ATgBot::Tools {
 
 /**
  * @brief EventRouter is a template class that routes events to registered sessions.
+ *
+ * Sessions whose filter has a chat or user key are indexed by it, so an
+ * event is only offered to the sessions that can match it and to the
+ * sessions without keys.
  * 
  * @tparam T The type of events to be routed.
+ * @tparam Mutex Lock of the session lists, a no-op one for SingleThreaded.
  */
-template <typename T>
+template <typename T, typename Mutex = std::recursive_mutex>
 class EventRouter {
  public:
   EventRouter() = delete;
@@ -28,8 +39,15 @@ class EventRouter {
    */
   void remove(std::shared_ptr<Session> session) {
     std::lock_guard _(m_mutex);
-    m_sessions.erase(std::remove(m_sessions.begin(), m_sessions.end(), session),
-                     m_sessions.end());
+    auto location = m_locations.find(session.get());
+    if (location == m_locations.end())
+      return;
+    auto& sessions = bucket(location->second.first, location->second.second);
+    sessions.erase(std::remove(sessions.begin(), sessions.end(), session),
+                   sessions.end());
+    if (sessions.empty() && location->second.first != Index::kNone)
+      index(location->second.first).erase(location->second.second);
+    m_locations.erase(location);
   }
 
   /**
@@ -47,30 +65,97 @@ class EventRouter {
     remove(session);
 
     EventFilter<T> filter = queue.getFilter();
-    if (filter.m_enabled) {
-      m_sessions.push_back(session);
+    if (!filter.m_enabled)
+      return;
+
+    std::pair<Index, std::int64_t> location{Index::kNone, 0};
+    if constexpr (HasEventFields<T>) {
+      const FilterKeys& keys = filter.keys();
+      if (keys.chat)
+        location = {Index::kChat, *keys.chat};
+      else if (keys.user)
+        location = {Index::kUser, *keys.user};
     }
+    bucket(location.first, location.second).push_back(session);
+    m_locations[session.get()] = location;
+  }
+
+  //true if no session waits for an event of this type
+  bool empty() {
+    std::lock_guard _(m_mutex);
+    return m_locations.empty();
   }
 
   /**
-   * @brief Routes a message to all registered sessions.
+   * @brief Routes a message to all registered sessions of every bot.
    * 
    * @param message The message to route.
    */
-  void route(const T& message) {
+  void route(const T& message) { routeKeyed(message, std::nullopt); }
+
+  /**
+   * @brief Routes a message of one bot to the sessions of that bot.
+   *
+   * @param message The message to route.
+   * @param bot The bot that received the message.
+   */
+  void route(const T& message, BotId bot) { routeKeyed(message, bot); }
+
+ private:
+  void routeKeyed(const T& message, std::optional<BotId> bot) {
     std::lock_guard _(m_mutex);
-    for (auto& session : m_sessions) {
-      ((*session.get()).*m_pointer).push(message);
+    if constexpr (HasEventFields<T>) {
+      if (auto chat = EventFields<T>::chat(message))
+        routeTo(m_by_chat, *chat, message, bot);
+      if (auto user = EventFields<T>::user(message))
+        routeTo(m_by_user, *user, message, bot);
+    }
+    routeTo(m_sessions, message, bot);
+  }
+
+  enum class Index { kNone, kChat, kUser };
+  using Sessions = std::vector<std::shared_ptr<Session>>;
+  using SessionIndex = std::unordered_map<std::int64_t, Sessions>;
+
+  SessionIndex& index(Index kind) {
+    return kind == Index::kChat ? m_by_chat : m_by_user;
+  }
+  Sessions& bucket(Index kind, std::int64_t key) {
+    if (kind == Index::kNone)
+      return m_sessions;
+    return index(kind)[key];
+  }
+
+  void routeTo(SessionIndex& index, std::int64_t key, const T& message,
+               std::optional<BotId> bot) {
+    auto it = index.find(key);
+    if (it != index.end())
+      routeTo(it->second, message, bot);
+  }
+  void routeTo(Sessions& sessions, const T& message,
+               std::optional<BotId> bot) {
+    for (auto& session : sessions) {
+      if (bot && session->bot() != *bot)
+        continue;
+      bool accepted = ((*session.get()).*m_pointer).push(message);
+      if (accepted) {
+        //an event the filter rejected does not keep the session alive
+        session->touch();
+        if (auto update = Trace::currentUpdate(); update != 0)
+          session->setUpdateId(update);
+      }
       session->execute();
     }
   }
 
- private:
-  std::vector<std::shared_ptr<Session>>
-      m_sessions;  ///< List of managed sessions.
+  Sessions m_sessions;  ///< Sessions without an index key.
+  SessionIndex m_by_chat;  ///< Sessions indexed by the chat key.
+  SessionIndex m_by_user;  ///< Sessions indexed by the user key.
+  std::unordered_map<Session*, std::pair<Index, std::int64_t>>
+      m_locations;  ///< Where every registered session is stored.
   EventQueue<T> Session::*
       m_pointer;  ///< Pointer to the EventQueue member in Session.
-  std::recursive_mutex m_mutex;
+  Mutex m_mutex;
 };
 
 }  // namespace ATgBot::Tools
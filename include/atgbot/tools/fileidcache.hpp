@@ -0,0 +1,101 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+
+#include <boost/variant.hpp>
+#include <tgbot/tgbot.h>
+
+#include "atgbot/tools/sharedresult.hpp"
+
+namespace ATgBot::Tools {
+
+/**
+ * @brief Maps local media to the file_id Telegram returned for it, so the
+ * same bytes are uploaded only once.
+ *
+ * Entries are keyed by the SHA-256 of the file content and kept in a
+ * memory-mapped table, so they survive restarts. Concurrent first sends of
+ * the same content wait for one upload and then reuse its file_id;
+ * handlers co_await Awaitables::sendCached() to suspend meanwhile. A
+ * file_id that Telegram no longer accepts is replaced by a new upload.
+ *
+ * The table is shared by threads of one process; processes should use
+ * separate files.
+ */
+class FileIdCache {
+ public:
+  using Digest = std::array<unsigned char, 32>;
+  using Media = boost::variant<TgBot::InputFile::Ptr, std::string>;
+  //performs the api call, e.g. sendPhoto(chat, media)
+  using Send = std::function<TgBot::Message::Ptr(const Media& media)>;
+  //file_id of an upload in flight, empty when the upload failed
+  using Upload = std::shared_ptr<SharedResult<std::optional<std::string>>>;
+
+  static constexpr std::size_t kDefaultCapacity = 4096;
+  static constexpr std::size_t kMaxFileId = 223;
+
+  //opens the table in the file or creates it, an existing table keeps its
+  //capacity
+  explicit FileIdCache(const std::filesystem::path& file,
+                       std::size_t capacity = kDefaultCapacity);
+  ~FileIdCache();
+
+  FileIdCache(const FileIdCache&) = delete;
+  FileIdCache& operator=(const FileIdCache&) = delete;
+
+  /**
+   * @brief Sends the local file, by file_id if its content was sent before.
+   * Blocks while another thread uploads the same content.
+   *
+   * @return The message returned by the send callback.
+   */
+  TgBot::Message::Ptr send(const std::filesystem::path& path,
+                           const std::string& mime_type, const Send& send);
+  //upload of the content of the file in flight, nullptr if there is none
+  Upload pendingUpload(const std::filesystem::path& path);
+
+  std::optional<std::string> find(const Digest& digest) const;
+  //false if the table is full or the file_id too long to persist
+  bool store(const Digest& digest, const std::string& file_id);
+
+  std::size_t size() const;
+  std::size_t capacity() const;
+  std::size_t uploadCount() const { return m_uploads; }
+  std::size_t reuseCount() const { return m_reuses; }
+
+  static Digest hashFile(const std::filesystem::path& path);
+  //file_id of the media attached to a sent message, empty if none
+  static std::string fileIdOf(const TgBot::Message::Ptr& message);
+
+ private:
+  struct Table;
+  struct Stamp {
+    std::uintmax_t size;
+    std::filesystem::file_time_type modified;
+    Digest digest;
+  };
+  Digest digestOf(const std::filesystem::path& path);
+  TgBot::Message::Ptr upload(const Digest& digest,
+                             const std::filesystem::path& path,
+                             const std::string& mime_type, const Send& send,
+                             const Upload& done);
+
+  std::unique_ptr<Table> m_table;
+  mutable std::mutex m_mutex;
+  std::map<Digest, Upload> m_uploading;
+  std::map<std::filesystem::path, Stamp> m_stamps;
+  std::atomic<std::size_t> m_uploads = 0;
+  std::atomic<std::size_t> m_reuses = 0;
+};
+
+}  // namespace ATgBot::Tools
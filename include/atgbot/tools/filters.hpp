@@ -0,0 +1,232 @@
+/**
+ * @file filters.hpp
+ * @brief Composable event predicates.
+ *
+ * Terms are small value types combined with &&, || and !, for example
+ * `from(user) && chat(group) && textPrefix("/x")`. Composition is resolved
+ * at compile time, so a whole predicate is one inlined call. Every
+ * predicate reports its key terms, which routers use to index sessions.
+ */
+
+#pragma once
+
+#include <concepts>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <tgbot/tgbot.h>
+
+#include "eventfilter.hpp"
+
+namespace ATgBot::Tools {
+
+template <>
+struct EventFields<TgBot::Message::Ptr> {
+  static std::optional<std::int64_t> user(const TgBot::Message::Ptr& e) {
+    if (e && e->from)
+      return e->from->id;
+    return std::nullopt;
+  }
+  static std::optional<std::int64_t> chat(const TgBot::Message::Ptr& e) {
+    if (e && e->chat)
+      return e->chat->id;
+    return std::nullopt;
+  }
+  static std::optional<std::int64_t> messageId(const TgBot::Message::Ptr& e) {
+    if (e)
+      return e->messageId;
+    return std::nullopt;
+  }
+  static std::string_view text(const TgBot::Message::Ptr& e) {
+    if (e)
+      return e->text;
+    return {};
+  }
+};
+
+template <>
+struct EventFields<TgBot::CallbackQuery::Ptr> {
+  static std::optional<std::int64_t> user(const TgBot::CallbackQuery::Ptr& e) {
+    if (e && e->from)
+      return e->from->id;
+    return std::nullopt;
+  }
+  static std::optional<std::int64_t> chat(const TgBot::CallbackQuery::Ptr& e) {
+    if (e && e->message && e->message->chat)
+      return e->message->chat->id;
+    return std::nullopt;
+  }
+  static std::optional<std::int64_t> messageId(
+      const TgBot::CallbackQuery::Ptr& e) {
+    if (e && e->message)
+      return e->message->messageId;
+    return std::nullopt;
+  }
+  static std::string_view text(const TgBot::CallbackQuery::Ptr& e) {
+    if (e)
+      return e->data;
+    return {};
+  }
+};
+
+template <typename T>
+concept HasEventFields = requires(const T& e) { EventFields<T>::user(e); };
+
+}  // namespace ATgBot::Tools
+
+namespace ATgBot::Filters {
+
+using Tools::EventFields;
+using Tools::FilterKeys;
+
+template <typename P>
+concept Term = requires { typename P::is_filter_term; };
+
+struct From {
+  using is_filter_term = void;
+  std::int64_t id;
+
+  template <typename T>
+  constexpr bool operator()(const T& e) const {
+    return EventFields<T>::user(e) == id;
+  }
+  FilterKeys keys() const { return {.user = id}; }
+};
+
+struct InChat {
+  using is_filter_term = void;
+  std::int64_t id;
+
+  template <typename T>
+  constexpr bool operator()(const T& e) const {
+    return EventFields<T>::chat(e) == id;
+  }
+  FilterKeys keys() const { return {.chat = id}; }
+};
+
+struct MessageId {
+  using is_filter_term = void;
+  std::int64_t id;
+
+  template <typename T>
+  constexpr bool operator()(const T& e) const {
+    return EventFields<T>::messageId(e) == id;
+  }
+  FilterKeys keys() const { return {.message_id = id}; }
+};
+
+/**
+ * @brief Text (or callback data) prefix. Keeps a view for string literals
+ * and an owned copy otherwise.
+ */
+template <typename S>
+struct TextPrefix {
+  using is_filter_term = void;
+  S prefix;
+
+  template <typename T>
+  constexpr bool operator()(const T& e) const {
+    return EventFields<T>::text(e).starts_with(prefix);
+  }
+  FilterKeys keys() const { return {.prefix = std::string(prefix)}; }
+};
+
+template <Term L, Term R>
+struct And {
+  using is_filter_term = void;
+  L left;
+  R right;
+
+  template <typename T>
+  constexpr bool operator()(const T& e) const {
+    return left(e) && right(e);
+  }
+  FilterKeys keys() const {
+    FilterKeys l = left.keys(), r = right.keys();
+    return {.user = l.user ? l.user : r.user,
+            .chat = l.chat ? l.chat : r.chat,
+            .message_id = l.message_id ? l.message_id : r.message_id,
+            .prefix = l.prefix ? l.prefix : r.prefix};
+  }
+};
+
+template <Term L, Term R>
+struct Or {
+  using is_filter_term = void;
+  L left;
+  R right;
+
+  template <typename T>
+  constexpr bool operator()(const T& e) const {
+    return left(e) || right(e);
+  }
+  //only keys shared by both sides restrict the match
+  FilterKeys keys() const {
+    FilterKeys l = left.keys(), r = right.keys();
+    FilterKeys keys;
+    if (l.user == r.user)
+      keys.user = l.user;
+    if (l.chat == r.chat)
+      keys.chat = l.chat;
+    if (l.message_id == r.message_id)
+      keys.message_id = l.message_id;
+    return keys;
+  }
+};
+
+template <Term P>
+struct Not {
+  using is_filter_term = void;
+  P term;
+
+  template <typename T>
+  constexpr bool operator()(const T& e) const {
+    return !term(e);
+  }
+  FilterKeys keys() const { return {}; }
+};
+
+constexpr From from(std::int64_t user_id) {
+  return {user_id};
+}
+constexpr InChat chat(std::int64_t chat_id) {
+  return {chat_id};
+}
+constexpr MessageId messageId(std::int64_t message_id) {
+  return {message_id};
+}
+//owns a copy, so a prefix from a char buffer or a temporary stays valid
+inline TextPrefix<std::string> textPrefix(std::string prefix) {
+  return {std::move(prefix)};
+}
+
+template <Term L, Term R>
+constexpr And<L, R> operator&&(L left, R right) {
+  return {std::move(left), std::move(right)};
+}
+template <Term L, Term R>
+constexpr Or<L, R> operator||(L left, R right) {
+  return {std::move(left), std::move(right)};
+}
+template <Term P>
+constexpr Not<P> operator!(P term) {
+  return {std::move(term)};
+}
+
+}  // namespace ATgBot::Filters
+
+namespace ATgBot::Tools {
+
+//enabled filter for events of type T from a predicate of ATgBot::Filters
+template <typename T, Filters::Term P>
+EventFilter<T> makeFilter(P predicate) {
+  EventFilter<T> filter;
+  filter.setEnabled(true);
+  filter.setPredicate(std::move(predicate));
+  return filter;
+}
+
+}  // namespace ATgBot::Tools
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+
+#include <tgbot/tgbot.h>
+
+#include "eventfilter.hpp"
+
+namespace ATgBot::Tools {
+
+/**
+ * @brief Immutable, flat copy of the routing-relevant part of a message.
+ *
+ * The scalars, the entities and the strings of one message live in a
+ * single allocation with an intrusive reference count, so queueing it is
+ * one atomic increment instead of a graph of shared pointers. Strings are
+ * exposed as views into the allocation.
+ *
+ * The view keeps the sender, the chat, the text with its entities, the
+ * caption, the reply target and the kind and file_id of an attached media;
+ * toMessage() rebuilds a TgBot::Message from them when a handler needs
+ * one.
+ */
+class FlatMessage {
+ public:
+  struct Entity {
+    TgBot::MessageEntity::Type type;
+    std::int32_t offset;
+    std::int32_t length;
+  };
+
+  //field of TgBot::Message the media came from
+  enum class MediaKind : std::uint8_t {
+    kNone,
+    kPhoto,
+    kDocument,
+    kSticker,
+    kVideo,
+    kAnimation,
+    kAudio,
+    kVoice,
+    kVideoNote
+  };
+
+  FlatMessage() = default;
+  explicit FlatMessage(const TgBot::Message& message);
+  FlatMessage(const FlatMessage& other) noexcept;
+  FlatMessage(FlatMessage&& other) noexcept;
+  FlatMessage& operator=(FlatMessage other) noexcept;
+  ~FlatMessage();
+
+  explicit operator bool() const { return m_data != nullptr; }
+
+  std::int32_t messageId() const;
+  std::int32_t messageThreadId() const;
+  std::uint32_t date() const;
+  std::optional<std::int64_t> chatId() const;
+  TgBot::Chat::Type chatType() const;
+  std::string_view chatTitle() const;
+  std::string_view chatUsername() const;
+  std::optional<std::int64_t> fromId() const;
+  bool fromIsBot() const;
+  std::string_view fromUsername() const;
+  std::string_view fromFirstName() const;
+  std::string_view fromLastName() const;
+  //zero if the message is not a reply
+  std::int32_t replyToMessageId() const;
+  std::string_view text() const;
+  std::string_view caption() const;
+  std::span<const Entity> entities() const;
+  //file_id of the photo (largest size), document or other media, if any
+  std::string_view fileId() const;
+  MediaKind mediaKind() const;
+
+  //rebuilds a message with the fields of the view; the media gets only its
+  //file_id, a photo only its largest size
+  TgBot::Message::Ptr toMessage() const;
+  //bytes of the single allocation
+  std::size_t allocationSize() const;
+
+ private:
+  struct Header;
+  enum Field : unsigned {
+    kText,
+    kCaption,
+    kChatTitle,
+    kChatUsername,
+    kFromUsername,
+    kFromFirstName,
+    kFromLastName,
+    kFileId,
+    kFieldCount
+  };
+
+  std::string_view field(Field field) const;
+
+  Header* m_data = nullptr;
+};
+
+template <>
+struct EventFields<FlatMessage> {
+  static std::optional<std::int64_t> user(const FlatMessage& e) {
+    return e ? e.fromId() : std::nullopt;
+  }
+  static std::optional<std::int64_t> chat(const FlatMessage& e) {
+    return e ? e.chatId() : std::nullopt;
+  }
+  static std::optional<std::int64_t> messageId(const FlatMessage& e) {
+    if (e)
+      return e.messageId();
+    return std::nullopt;
+  }
+  static std::string_view text(const FlatMessage& e) { return e.text(); }
+};
+
+}  // namespace ATgBot::Tools
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <tgbot/tgbot.h>
+
+#include "atgbot/tools/session.hpp"
+#include "atgbot/tools/timerevent.hpp"
+
+namespace ATgBot::Tools {
+
+//lowercases ASCII letters, trims and collapses whitespace
+std::string normalizeInlineQuery(std::string_view text);
+
+/**
+ * @brief Keeps one live handler per user for inline queries.
+ *
+ * Telegram sends a query for almost every keystroke, and every earlier
+ * query of the user is obsolete once a new one arrives.
+ */
+class InlineDebouncer {
+ public:
+  using Task = std::shared_ptr<Session>;
+
+  //update ids of inline queries a later query of the same user in the
+  //batch replaces; they need no handler at all
+  static std::unordered_set<std::int32_t> supersededInBatch(
+      const std::vector<TgBot::Update::Ptr>& updates);
+
+  //makes the session the latest of the user, returns the live session it
+  //supersedes or nullptr
+  Task replace(std::int64_t user_id, const Task& session);
+
+  std::size_t supersededCount() const { return m_superseded; }
+
+ private:
+  static constexpr std::size_t kPruneThreshold = 4096;
+
+  std::mutex m_mutex;
+  std::unordered_map<std::int64_t, std::weak_ptr<Session>> m_latest;
+  std::size_t m_prune_at = kPruneThreshold;
+  std::atomic<std::size_t> m_superseded = 0;
+};
+
+/**
+ * @brief LRU cache of inline query answers keyed by the normalized query
+ * text and the offset.
+ *
+ * An entry lives for the cache_time of its answer. The cache is bounded by
+ * the number of entries and the total number of results it holds.
+ */
+class InlineResultCache {
+ public:
+  struct Answer {
+    std::vector<TgBot::InlineQueryResult::Ptr> results;
+    std::string next_offset;
+    std::int32_t cache_time = 300;
+  };
+
+  static constexpr std::size_t kDefaultMaxEntries = 1024;
+  static constexpr std::size_t kDefaultMaxResults = 50000;
+
+  explicit InlineResultCache(std::size_t max_entries = kDefaultMaxEntries,
+                             std::size_t max_results = kDefaultMaxResults)
+      : m_max_entries(max_entries), m_max_results(max_results) {}
+
+  std::optional<Answer> find(std::string_view query,
+                             const std::string& offset);
+  void store(std::string_view query, const std::string& offset,
+             Answer answer);
+
+  std::size_t size() const;
+  std::size_t hitCount() const { return m_hits; }
+  std::size_t missCount() const { return m_misses; }
+
+ private:
+  struct Entry {
+    std::string key;
+    Answer answer;
+    DefaultTimer::time_point expires;
+  };
+  using List = std::list<Entry>;
+
+  static std::string key(std::string_view query, const std::string& offset);
+  void erase(List::iterator entry);
+
+  const std::size_t m_max_entries;
+  const std::size_t m_max_results;
+  mutable std::mutex m_mutex;
+  List m_entries;  // most recently used first
+  std::unordered_map<std::string, List::iterator> m_index;
+  std::size_t m_results = 0;
+  std::atomic<std::size_t> m_hits = 0;
+  std::atomic<std::size_t> m_misses = 0;
+};
+
+}  // namespace ATgBot::Tools
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "eventfilter.hpp"
+#include "priority.hpp"
+#include "spawnoptions.hpp"
+#include "timerevent.hpp"
+
+namespace ATgBot::Tools {
+
+/**
+ * @brief State of one live session at the time of the snapshot.
+ */
+struct SessionInfo {
+  std::uint64_t id = 0;
+  BotId bot = 0;
+  Priority priority = Priority::kNormal;
+  std::string awaiting;  ///< awaitable kind, empty before the first resume
+  FilterKeys keys;       ///< filter keys of the awaitable
+  DefaultTimer::duration suspended{};  ///< time since the last resume
+  std::size_t queued_events = 0;
+  std::size_t frame_size = 0;
+  std::string origin;  ///< handler or command that spawned the session
+};
+
+/**
+ * @brief Snapshot of the live sessions of a scheduler with aggregates that
+ * make leaks (old suspended sessions of one origin) and hot conversations
+ * (chats with many sessions or queued events) visible.
+ */
+struct SessionReport {
+  struct Group {
+    std::size_t sessions = 0;
+    std::size_t frame_bytes = 0;
+    std::size_t queued_events = 0;
+  };
+
+  //upper bounds of the suspended time histogram, the last bucket is open
+  static constexpr std::array<std::int64_t, 5> kSuspendedBuckets = {
+      1, 10, 60, 600, 3600};  // seconds
+  static constexpr std::size_t kHotChats = 10;
+
+  SessionReport() = default;
+  explicit SessionReport(std::vector<SessionInfo> sessions);
+
+  std::vector<SessionInfo> sessions;
+  Group total;
+  std::map<std::string, Group> by_origin;
+  std::map<std::string, Group> by_awaiting;
+  std::array<std::size_t, kSuspendedBuckets.size() + 1> suspended_histogram{};
+  //chats with the most sessions, most first
+  std::vector<std::pair<std::int64_t, Group>> hot_chats;
+};
+
+std::ostream& operator<<(std::ostream& stream, const SessionReport& report);
+
+/**
+ * @brief Makes every scheduler log a SessionReport on its next timer tick
+ * after the process receives the signal.
+ */
+void dumpSessionsOnSignal(int signum);
+//number of dump signals received so far
+std::uint64_t sessionDumpRequests();
+
+}  // namespace ATgBot::Tools
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "priority.hpp"
+#include "timerevent.hpp"
+
+namespace ATgBot::Tools {
+
+/**
+ * @brief What a bounded event queue does with an event when it is full.
+ */
+enum class OverflowPolicy {
+  kDropOldest,  ///< drop the oldest queued event
+  kDropNew,     ///< drop the incoming event
+  kCoalesce     ///< drop every queued event, only the newest one is kept
+};
+
+struct QueueLimit {
+  std::size_t max_events = 0;  ///< zero means unbounded
+  OverflowPolicy policy = OverflowPolicy::kDropOldest;
+};
+
+/**
+ * @brief Backpressure applied by the scheduler when it falls behind.
+ *
+ * Zero values disable the corresponding limit. Unlike SessionLimits, which
+ * evicts running sessions, these limits refuse new work: spawns over a cap
+ * are rejected, and while the scheduler lags spawns below shed_below are
+ * shed. Queue limits apply to sessions spawned after they are set.
+ */
+struct LoadLimits {
+  QueueLimit messages;          ///< per-session message queues
+  QueueLimit callback_queries;  ///< per-session callback query queues
+  std::size_t max_sessions = 0;       ///< live sessions
+  std::size_t max_pending_tasks = 0;  ///< sessions waiting for a worker
+  //time the last resumed session waited in the queue
+  DefaultTimer::duration max_lag = DefaultTimer::duration::zero();
+  Priority shed_below = Priority::kNormal;
+};
+
+struct LoadStats {
+  std::uint64_t dropped_events = 0;     ///< dropped by queue limits
+  std::uint64_t rejected_sessions = 0;  ///< spawns over a cap
+  std::uint64_t shed_sessions = 0;      ///< spawns shed while lagging
+  std::size_t pending_tasks = 0;
+  DefaultTimer::duration lag = DefaultTimer::duration::zero();
+};
+
+}  // namespace ATgBot::Tools
@@ -0,0 +1,39 @@
+/**
+ * @file log.hpp
+ * @brief Logging macros of the library.
+ *
+ * ATGBOT_LOGD and ATGBOT_LOGV behave like PLOGD and PLOGV, but compile to
+ * nothing when their severity is above ATGBOT_LOG_MAX_SEVERITY, so the
+ * message is not even built. By default debug and verbose calls are kept
+ * only in builds without NDEBUG.
+ */
+
+#pragma once
+
+#include <plog/Log.h>
+
+#ifndef ATGBOT_LOG_MAX_SEVERITY
+#ifdef NDEBUG
+#define ATGBOT_LOG_MAX_SEVERITY 4  // plog::info
+#else
+#define ATGBOT_LOG_MAX_SEVERITY 6  // plog::verbose
+#endif
+#endif
+
+#if ATGBOT_LOG_MAX_SEVERITY >= 5
+#define ATGBOT_LOGD PLOGD
+#else
+#define ATGBOT_LOGD \
+  if (true) {       \
+  } else            \
+    PLOGD
+#endif
+
+#if ATGBOT_LOG_MAX_SEVERITY >= 6
+#define ATGBOT_LOGV PLOGV
+#else
+#define ATGBOT_LOGV \
+  if (true) {       \
+  } else            \
+    PLOGV
+#endif
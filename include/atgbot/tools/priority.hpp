@@ -0,0 +1,16 @@
+#pragma once
+
+namespace ATgBot::Tools {
+
+/**
+ * @brief Priority class of a session. Workers always pick a queued session
+ * of the highest class, earliest deadline first inside a class.
+ */
+enum class Priority : int {
+  kBackground = 0,  ///< broadcasts and bulk work
+  kNormal = 1,      ///< regular message handlers
+  kHigh = 2,        ///< callback and inline queries
+  kCritical = 3     ///< payments and other hard deadlines
+};
+
+}  // namespace ATgBot::Tools
@@ -4,35 +4,80 @@
 #include <condition_variable>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <queue>
+#include <set>
+#include <sstream>
 #include <thread>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "eventrouter.hpp"
+#include "introspection.hpp"
+#include "loadlimits.hpp"
+#include "log.hpp"
 #include "session.hpp"
+#include "sessionlimits.hpp"
+#include "threadingpolicy.hpp"
 #include "timerevent.hpp"
+#include "trace.hpp"
 
 #include <tgbot/tgbot.h>
 
 namespace ATgBot::Tools {
 
-class Scheduler {
+/**
+ * @brief Runs sessions and routes events to them.
+ *
+ * @tparam Policy MultiThreaded runs a worker pool, SingleThreaded runs
+ * everything on the thread that calls runPending(), an ExecutorPolicy
+ * posts every resume to an external executor.
+ */
+template <class Policy>
+class BasicScheduler {
+  using Mutex = typename Policy::Mutex;
+
  public:
   using Task = std::shared_ptr<Session>;
 
-  Scheduler(int thread_count = 4)
+  BasicScheduler(int thread_count = 4)
+    requires(!ExecutorPolicy<Policy>)
       : m_running(true),
-        m_generator([this]() { handleTimerEvent(TimerEvent()); }) {
-    m_generator.start();
-    for (int i = 0; i < thread_count; ++i) {
-      m_threads.emplace_back(&Scheduler::thread, this);
+        m_owner(std::this_thread::get_id()),
+        m_generator([this]() { handleTimerEvent(TimerEvent(now())); }) {
+    if constexpr (Policy::kSimulated)
+      m_clock = std::make_unique<VirtualClock>();
+    if constexpr (Policy::kThreaded) {
+      m_generator.start();
+      for (int i = 0; i < thread_count; ++i) {
+        m_threads.emplace_back(&BasicScheduler::thread, this);
+      }
     }
   }
 
-  ~Scheduler() {
+  //resumes sessions and fires timers on the executor, owns no threads
+  template <class Executor>
+    requires ExecutorPolicy<Policy>
+  explicit BasicScheduler(Executor executor)
+      : m_running(true),
+        m_owner(std::this_thread::get_id()),
+        m_generator([this]() { handleTimerEvent(TimerEvent(now())); }) {
+    m_backend = std::make_unique<Backend>(
+        std::move(executor), [this]() { runOne(); },
+        [this]() { handleTimerEvent(TimerEvent(now())); }, kTickInterval);
+  }
+
+  BasicScheduler(const BasicScheduler&) = delete;
+  BasicScheduler& operator=(const BasicScheduler&) = delete;
+
+  ~BasicScheduler() {
     m_running = false;
-    m_condition.notify_all();
+    //waits for the handlers that are running on the executor
+    m_backend.reset();
+    if constexpr (kWorkerPool)
+      m_condition.notify_all();
     for (auto& thread : m_threads) {
       if (thread.joinable()) {
         thread.join();
@@ -40,131 +85,809 @@ class Scheduler {
     }
   }
 
-  void pushCoro(Coroutine&& coro) {
-    std::lock_guard<std::recursive_mutex> lock(m_sessions_mutex);
-    m_sessions.push_back(Session::create(
-        std::move(coro),
-        std::bind(&Scheduler::addTaskToQueue, this, std::placeholders::_1),
-        std::bind(&Scheduler::pushCoro, this, std::placeholders::_1)));
-    addTaskToQueue(m_sessions.back());
+  /**
+   * @brief Schedules a new coroutine.
+   *
+   * @return false if the bot is over its session quota or the spawn is
+   * refused by LoadLimits; the coroutine is destroyed without running.
+   */
+  bool pushCoro(Coroutine&& coro, const SpawnOptions& options = {}) {
+    return spawn(std::move(coro), options) != nullptr;
+  }
+
+  //same as pushCoro(), returns the new session or nullptr if rejected
+  Task spawn(Coroutine&& coro, const SpawnOptions& options = {}) {
+    std::lock_guard<Mutex> lock(m_sessions_mutex);
+    if (!accept(options))
+      return nullptr;
+    auto session = makeSession(std::move(coro), options);
+    addTaskToQueue(session);
+    enforceBudget();
+    return session;
+  }
+
+  /**
+   * @brief Runs a new coroutine on the calling thread until it first
+   * suspends on an awaitable; only then a session is created and scheduled.
+   * A handler that finishes without awaiting costs no session and no hop
+   * to a worker, but it blocks the calling thread while it runs.
+   *
+   * @return false if the coroutine is rejected, see pushCoro().
+   */
+  bool runInline(Coroutine&& coro, const SpawnOptions& options = {}) {
+    if constexpr (!Policy::kThreaded) {
+      if (std::this_thread::get_id() != m_owner)
+        return pushCoro(std::move(coro), options);
+    }
+    {
+      std::lock_guard<Mutex> lock(m_sessions_mutex);
+      if (!accept(options))
+        return false;
+    }
+    auto session =
+        Session::runInline(std::move(coro), [&](Coroutine&& coro) {
+          std::lock_guard<Mutex> lock(m_sessions_mutex);
+          auto session = makeSession(std::move(coro), options);
+          enforceBudget();
+          return session;
+        });
+    if (session)
+      processTask(session);
+    return true;
+  }
+
+  //cancels a session whose work is obsolete; unlike an eviction, a session
+  //that has not started yet is dropped without running
+  void discard(const Task& session) {
+    session->discard_unstarted = true;
+    cancelSession(session);
+  }
+
+  /**
+   * @brief Runs every queued session on the calling thread and fires the
+   * timer tick when it is due. SingleThreaded policy only.
+   *
+   * @return Number of processed tasks.
+   */
+  std::size_t runPending()
+    requires(!Policy::kThreaded)
+  {
+    takeRemoteTasks();
+    if (now() >= m_next_tick) {
+      m_next_tick = now() + kTickInterval;
+      handleTimerEvent(TimerEvent(now()));
+    }
+    std::size_t processed = 0;
+    while (!m_tasks_queue.empty()) {
+      auto next = nextTask();
+      Task task = *next;
+      m_tasks_queue.erase(next);
+      m_lag = now() - task->queued_at;
+      ++m_bot_resumed[task->bot()];
+      processTask(task);
+      ++processed;
+      takeRemoteTasks();
+    }
+    return processed;
+  }
+
+  /**
+   * @brief Runs the queued sessions and moves the virtual clock to until,
+   * stopping at every timer, deadline and tick on the way. Simulated
+   * policy only.
+   *
+   * @return Number of processed tasks.
+   */
+  std::size_t advanceTo(DefaultTimer::time_point until)
+    requires(Policy::kSimulated)
+  {
+    std::size_t processed = runPending();
+    for (auto next = nextWakeup(); next <= until; next = nextWakeup()) {
+      m_clock->advanceTo(next);
+      m_next_tick = next + kTickInterval;
+      handleTimerEvent(TimerEvent(now()));
+      processed += runPending();
+    }
+    m_clock->advanceTo(until);
+    return processed + runPending();
   }
 
-  void handleMessage(TgBot::Message::Ptr message) {
-    std::lock_guard<std::recursive_mutex> lock(m_sessions_mutex);
-    m_message_router.route(message);
+  std::size_t advance(DefaultTimer::duration duration)
+    requires(Policy::kSimulated)
+  {
+    return advanceTo(now() + duration);
   }
 
-  void handleCallbackQuery(TgBot::CallbackQuery::Ptr query) {
-    std::lock_guard<std::recursive_mutex> lock(m_sessions_mutex);
-    m_callback_router.route(query);
+  VirtualClock& clock()
+    requires(Policy::kSimulated)
+  {
+    return *m_clock;
   }
 
-  void handleEditedMessage(TgBot::Message::Ptr message) {
-    std::lock_guard<std::recursive_mutex> lock(m_sessions_mutex);
+  //time of the sessions of this scheduler, virtual for Simulated
+  DefaultTimer::time_point now() const {
+    if constexpr (Policy::kSimulated)
+      return m_clock->now();
+    else
+      return DefaultTimer::now();
+  }
+
+  /**
+   * @brief Collects the wakeups made by the calling thread while it lives,
+   * then queues every woken session once and notifies the workers once.
+   *
+   * Used to route a whole getUpdates batch before any session runs. Nested
+   * batches of the same scheduler join the outer one.
+   */
+  class [[nodiscard]] Batch {
+   public:
+    explicit Batch(BasicScheduler& scheduler)
+        : m_scheduler(scheduler), m_previous(t_batch) {
+      if (m_previous && &m_previous->m_scheduler == &scheduler)
+        m_nested = true;
+      else
+        t_batch = this;
+    }
+    ~Batch() {
+      if (m_nested)
+        return;
+      t_batch = m_previous;
+      m_scheduler.flushBatch(m_tasks);
+    }
+
+    Batch(const Batch&) = delete;
+    Batch& operator=(const Batch&) = delete;
+
+    //update whose dispatch wakes the following sessions, zero for none;
+    //see unfinishedUpdates()
+    void setUpdate(std::int64_t update) {
+      (m_nested ? *t_batch : *this).m_update = update;
+    }
+
+   private:
+    friend class BasicScheduler;
+
+    BasicScheduler& m_scheduler;
+    Batch* m_previous;
+    bool m_nested = false;
+    std::int64_t m_update = 0;
+    std::vector<Task> m_tasks;
+    std::unordered_set<Session*> m_woken;
+  };
+
+  Batch batch() { return Batch(*this); }
+
+  /**
+   * @brief Registers a bot that shares this scheduler.
+   *
+   * @return Id to tag the sessions and updates of the bot.
+   */
+  BotId addBot() { return ++m_last_bot; }
+
+  //limits live sessions of one bot, zero removes the limit
+  void setBotQuota(BotId bot, std::size_t max_sessions) {
+    std::lock_guard<Mutex> lock(m_sessions_mutex);
+    m_bot_quotas[bot] = max_sessions;
+  }
+
+  struct BotStats {
+    std::size_t sessions = 0;  ///< live sessions
+    std::uint64_t spawned = 0;   ///< accepted coroutines
+    std::uint64_t rejected = 0;  ///< coroutines rejected by the quota
+    std::uint64_t resumed = 0;   ///< tasks processed by the workers
+  };
+
+  BotStats botStats(BotId bot) {
+    BotStats stats;
+    {
+      std::lock_guard<Mutex> lock(m_sessions_mutex);
+      stats.sessions = botSessionCount(bot);
+      auto counters = m_bot_counters.find(bot);
+      if (counters != m_bot_counters.end()) {
+        stats.spawned = counters->second.spawned;
+        stats.rejected = counters->second.rejected;
+      }
+    }
+    std::lock_guard<Mutex> lock(m_tasks_queue_mutex);
+    auto resumed = m_bot_resumed.find(bot);
+    if (resumed != m_bot_resumed.end())
+      stats.resumed = resumed->second;
+    return stats;
+  }
+
+  void setSessionLimits(const SessionLimits& limits) {
+    std::lock_guard<Mutex> lock(m_sessions_mutex);
+    m_limits = limits;
+  }
+
+  SessionLimits getSessionLimits() {
+    std::lock_guard<Mutex> lock(m_sessions_mutex);
+    return m_limits;
+  }
+
+  void setLoadLimits(const LoadLimits& limits) {
+    std::lock_guard<Mutex> lock(m_sessions_mutex);
+    m_load_limits = limits;
+  }
+
+  LoadLimits getLoadLimits() {
+    std::lock_guard<Mutex> lock(m_sessions_mutex);
+    return m_load_limits;
+  }
+
+  LoadStats loadStats() {
+    LoadStats stats;
+    stats.rejected_sessions = m_rejected_sessions;
+    stats.shed_sessions = m_shed_sessions;
+    {
+      std::lock_guard<Mutex> lock(m_sessions_mutex);
+      stats.dropped_events = m_dropped_events;
+      for (auto& session : m_sessions)
+        stats.dropped_events += droppedEvents(*session);
+    }
+    std::lock_guard<Mutex> lock(m_tasks_queue_mutex);
+    stats.pending_tasks = m_tasks_queue.size();
+    stats.lag = currentLag();
+    return stats;
+  }
+
+  std::size_t sessionCount() {
+    std::lock_guard<Mutex> lock(m_sessions_mutex);
+    return m_sessions.size();
+  }
+
+  std::size_t evictedCount() const { return m_evicted; }
+
+  /**
+   * @brief Updates of the bot that woke or spawned a session which was not
+   * resumed for them yet, lowest first.
+   *
+   * An update counts for the sessions a Batch wakes while it is set with
+   * Batch::setUpdate(); it is finished once the resume that took it
+   * returns or the session is removed.
+   */
+  std::vector<std::int64_t> unfinishedUpdates(BotId bot = 0) {
+    std::lock_guard _(m_unfinished_mutex);
+    auto it = m_unfinished.find(bot);
+    if (it == m_unfinished.end())
+      return {};
+    return {it->second.begin(), it->second.end()};
+  }
+
+  //snapshot of the live sessions
+  SessionReport sessionReport() {
+    std::vector<SessionInfo> infos;
+    auto now = this->now();
+    std::lock_guard<Mutex> lock(m_sessions_mutex);
+    infos.reserve(m_sessions.size());
+    for (auto& session : m_sessions) {
+      const char* awaiting = session->awaiting();
+      infos.push_back({
+          .id = session->id(),
+          .bot = session->bot(),
+          .priority = session->priority(),
+          .awaiting = awaiting ? awaiting : "",
+          .keys = session->waitKeys(),
+          .suspended = awaiting ? now - session->suspendedSince()
+                                : DefaultTimer::duration::zero(),
+          .queued_events = session->queuedEvents(),
+          .frame_size = session->frameSize(),
+          .origin = session->origin(),
+      });
+    }
+    return SessionReport(std::move(infos));
+  }
+
+  /**
+   * @brief Cancels sessions that are idle longer than their ttl and evicts
+   * sessions until the budget in SessionLimits is met.
+   *
+   * Called on every timer tick.
+   */
+  void enforceLimits() {
+    std::lock_guard<Mutex> lock(m_sessions_mutex);
+    auto now = this->now();
+    for (auto& session : m_sessions) {
+      auto ttl = session->idleTtl();
+      if (ttl == DefaultTimer::duration::zero())
+        ttl = m_limits.idle_ttl;
+      if (ttl == DefaultTimer::duration::zero() || session->isCancelled())
+        continue;
+      if (now - session->lastActivity() > ttl) {
+        ATGBOT_LOGD << "Session evicted by idle ttl";
+        evict(session);
+      }
+    }
+    enforceBudget();
+  }
+
+  /**
+   * @brief Waits until no session is queued or running, then cancels the
+   * remaining (suspended) sessions.
+   *
+   * @param timeout Deadline for the in-flight sessions to finish.
+   * @param bot Drains only the sessions of this bot if set.
+   * @return true if the scheduler became idle before the deadline.
+   */
+  bool drain(DefaultTimer::duration timeout,
+             std::optional<BotId> bot = std::nullopt) {
+    auto deadline = now() + timeout;
+    bool idle = waitIdle(deadline, bot);
+    {
+      std::lock_guard<Mutex> lock(m_sessions_mutex);
+      for (auto& session : m_sessions)
+        if (!session->isCancelled() && (!bot || session->bot() == *bot))
+          cancelSession(session);
+    }
+    return waitIdle(deadline, bot) && idle;
+  }
+
+  void handleMessage(TgBot::Message::Ptr message, BotId bot = 0) {
+    Trace::Scope trace("route");
+    std::lock_guard<Mutex> lock(m_sessions_mutex);
+    m_message_router.route(message, bot);
+    // the flat copy is only made while some session waits for one
+    if (message && !m_flat_message_router.empty())
+      m_flat_message_router.route(FlatMessage(*message), bot);
+  }
+
+  void handleCallbackQuery(TgBot::CallbackQuery::Ptr query, BotId bot = 0) {
+    Trace::Scope trace("route");
+    std::lock_guard<Mutex> lock(m_sessions_mutex);
+    m_callback_router.route(query, bot);
+  }
+
+  void handleEditedMessage(TgBot::Message::Ptr message, BotId bot = 0) {
+    std::lock_guard<Mutex> lock(m_sessions_mutex);
     for (auto& session : m_sessions) {
       //session->pushEditedMessage(message);
-      addTaskToQueue(session);
+      if (session->bot() == bot)
+        addTaskToQueue(session);
     }
   }
 
-  void handleInlineQuery(TgBot::InlineQuery::Ptr query) {
-    std::lock_guard<std::recursive_mutex> lock(m_sessions_mutex);
+  void handleInlineQuery(TgBot::InlineQuery::Ptr query, BotId bot = 0) {
+    std::lock_guard<Mutex> lock(m_sessions_mutex);
     for (auto& session : m_sessions) {
       //session->pushInlineQuery(query);
-      addTaskToQueue(session);
+      if (session->bot() == bot)
+        addTaskToQueue(session);
     }
   }
 
-  void handleChosenInlineResult(TgBot::ChosenInlineResult::Ptr result) {
-    std::lock_guard<std::recursive_mutex> lock(m_sessions_mutex);
+  void handleChosenInlineResult(TgBot::ChosenInlineResult::Ptr result,
+                                BotId bot = 0) {
+    std::lock_guard<Mutex> lock(m_sessions_mutex);
     for (auto& session : m_sessions) {
       //session->pushChosenInlineResult(result);
-      addTaskToQueue(session);
+      if (session->bot() == bot)
+        addTaskToQueue(session);
     }
   }
 
-  void handleShippingQuery(TgBot::ShippingQuery::Ptr query) {
-    std::lock_guard<std::recursive_mutex> lock(m_sessions_mutex);
+  void handleShippingQuery(TgBot::ShippingQuery::Ptr query, BotId bot = 0) {
+    std::lock_guard<Mutex> lock(m_sessions_mutex);
     for (auto& session : m_sessions) {
       //session->pushShippingQuery(query);
-      addTaskToQueue(session);
+      if (session->bot() == bot)
+        addTaskToQueue(session);
     }
   }
 
-  void handlePreCheckoutQuery(TgBot::PreCheckoutQuery::Ptr query) {
-    std::lock_guard<std::recursive_mutex> lock(m_sessions_mutex);
+  void handlePreCheckoutQuery(TgBot::PreCheckoutQuery::Ptr query,
+                              BotId bot = 0) {
+    std::lock_guard<Mutex> lock(m_sessions_mutex);
     for (auto& session : m_sessions) {
       //session->pushPreCheckoutQuery(query);
-      addTaskToQueue(session);
+      if (session->bot() == bot)
+        addTaskToQueue(session);
     }
   }
 
-  void handlePoll(TgBot::Poll::Ptr poll) {
-    std::lock_guard<std::recursive_mutex> lock(m_sessions_mutex);
+  void handlePoll(TgBot::Poll::Ptr poll, BotId bot = 0) {
+    std::lock_guard<Mutex> lock(m_sessions_mutex);
     for (auto& session : m_sessions) {
       //session->pushPoll(poll);
-      addTaskToQueue(session);
+      if (session->bot() == bot)
+        addTaskToQueue(session);
     }
   }
 
-  void handlePollAnswer(TgBot::PollAnswer::Ptr answer) {
-    std::lock_guard<std::recursive_mutex> lock(m_sessions_mutex);
+  void handlePollAnswer(TgBot::PollAnswer::Ptr answer, BotId bot = 0) {
+    std::lock_guard<Mutex> lock(m_sessions_mutex);
     for (auto& session : m_sessions) {
       //session->pushPollAnswer(answer);
-      addTaskToQueue(session);
+      if (session->bot() == bot)
+        addTaskToQueue(session);
     }
   }
 
-  void handleMyChatMember(TgBot::ChatMemberUpdated::Ptr update) {
-    std::lock_guard<std::recursive_mutex> lock(m_sessions_mutex);
+  void handleMyChatMember(TgBot::ChatMemberUpdated::Ptr update, BotId bot = 0) {
+    std::lock_guard<Mutex> lock(m_sessions_mutex);
     for (auto& session : m_sessions) {
       //session->pushMyChatMember(update);
-      addTaskToQueue(session);
+      if (session->bot() == bot)
+        addTaskToQueue(session);
     }
   }
 
-  void handleChatMember(TgBot::ChatMemberUpdated::Ptr update) {
-    std::lock_guard<std::recursive_mutex> lock(m_sessions_mutex);
+  void handleChatMember(TgBot::ChatMemberUpdated::Ptr update, BotId bot = 0) {
+    std::lock_guard<Mutex> lock(m_sessions_mutex);
     for (auto& session : m_sessions) {
       //session->pushChatMember(update);
-      addTaskToQueue(session);
+      if (session->bot() == bot)
+        addTaskToQueue(session);
     }
   }
 
-  void handleChatJoinRequest(TgBot::ChatJoinRequest::Ptr request) {
-    std::lock_guard<std::recursive_mutex> lock(m_sessions_mutex);
+  void handleChatJoinRequest(TgBot::ChatJoinRequest::Ptr request,
+                             BotId bot = 0) {
+    std::lock_guard<Mutex> lock(m_sessions_mutex);
     for (auto& session : m_sessions) {
       //session->pushChatJoinRequest(request);
-      addTaskToQueue(session);
+      if (session->bot() == bot)
+        addTaskToQueue(session);
     }
   }
 
   void handleTimerEvent(TimerEvent event) {
-    std::lock_guard<std::recursive_mutex> lock(m_sessions_mutex);
-    m_timer_router.route(event);
+    {
+      Trace::Scope trace("route");
+      std::lock_guard<Mutex> lock(m_sessions_mutex);
+      m_timer_router.route(event);
+    }
+    checkDeadlines(event.time_point);
+    enforceLimits();
+    if (auto requests = sessionDumpRequests(); requests != m_dump_requests) {
+      m_dump_requests = requests;
+      std::ostringstream report;
+      report << sessionReport();
+      PLOGI << "Session dump\n" << report.str();
+    }
   }
 
+  /**
+   * @brief Runs the deadline callbacks of sessions that are still alive
+   * kDeadlineMargin before their deadline and have not answered their
+   * update. Every callback runs once.
+   */
+  void checkDeadlines(DefaultTimer::time_point now) {
+    std::vector<std::function<void()>> callbacks;
+    {
+      std::lock_guard<Mutex> lock(m_sessions_mutex);
+      for (auto& session : m_sessions) {
+        auto deadline = session->deadline();
+        if (deadline.time_since_epoch().count() == 0 ||
+            now + kDeadlineMargin < deadline)
+          continue;
+        session->setDeadline({});
+        if (session->deadline_callback && !session->answered())
+          callbacks.push_back(std::move(session->deadline_callback));
+        session->deadline_callback = nullptr;
+      }
+    }
+    // callbacks may call the bot api, so they run without the lock
+    for (auto& callback : callbacks) {
+      ATGBOT_LOGD << "Session is about to miss its deadline";
+      callback();
+    }
+  }
+
+  static constexpr auto kDeadlineMargin = std::chrono::seconds(2);
+
  private:
+  void enforceBudget() {
+    std::lock_guard<Mutex> lock(m_sessions_mutex);
+    if (m_limits.max_sessions == 0 && m_limits.max_frame_bytes == 0)
+      return;
+
+    std::vector<Task> alive;
+    std::size_t frame_bytes = 0;
+    for (auto& session : m_sessions) {
+      if (session->isCancelled())
+        continue;
+      alive.push_back(session);
+      frame_bytes += session->frameSize();
+    }
+
+    auto over_budget = [&]() {
+      return (m_limits.max_sessions != 0 &&
+              alive.size() > m_limits.max_sessions) ||
+             (m_limits.max_frame_bytes != 0 &&
+              frame_bytes > m_limits.max_frame_bytes);
+    };
+
+    while (!alive.empty() && over_budget()) {
+      Task victim = nullptr;
+      if (m_limits.policy == EvictionPolicy::kCallback) {
+        if (m_limits.on_evict)
+          victim = m_limits.on_evict(alive);
+      } else {
+        victim = *std::min_element(
+            alive.begin(), alive.end(), [](const Task& a, const Task& b) {
+              return a->lastActivity() < b->lastActivity();
+            });
+      }
+      auto it = std::find(alive.begin(), alive.end(), victim);
+      if (it == alive.end())
+        break;
+      ATGBOT_LOGD << "Session evicted by budget";
+      frame_bytes -= victim->frameSize();
+      alive.erase(it);
+      evict(victim);
+    }
+  }
+
+  void evict(Task session) {
+    ++m_evicted;
+    cancelSession(session);
+  }
+
+  void cancelSession(Task session) {
+    session->cancel();
+    addTaskToQueue(session);
+  }
+
+  bool waitIdle(DefaultTimer::time_point deadline, std::optional<BotId> bot) {
+    auto busy = [bot](const Task& task) {
+      return !bot || task->bot() == *bot;
+    };
+    while (now() < deadline) {
+      if constexpr (!Policy::kThreaded)
+        runPending();
+      {
+        std::lock_guard<Mutex> lock(m_tasks_queue_mutex);
+        if (std::none_of(m_tasks_queue.begin(), m_tasks_queue.end(), busy) &&
+            std::none_of(m_running_tasks.begin(), m_running_tasks.end(), busy))
+          return true;
+      }
+      if constexpr (Policy::kSimulated)
+        advanceTo(std::min(deadline, nextWakeup()));
+      else
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return false;
+  }
+
+  std::size_t botSessionCount(BotId bot) {
+    return std::count_if(
+        m_sessions.begin(), m_sessions.end(),
+        [bot](const Task& task) { return task->bot() == bot; });
+  }
+
+  //quota and load limits of a new session, called under m_sessions_mutex
+  bool accept(const SpawnOptions& options) {
+    auto quota = m_bot_quotas.find(options.bot);
+    if (quota != m_bot_quotas.end() && quota->second != 0 &&
+        botSessionCount(options.bot) >= quota->second) {
+      PLOGW << "Bot " << options.bot << " is over its session quota";
+      ++m_bot_counters[options.bot].rejected;
+      return false;
+    }
+    if (!admit(options))
+      return false;
+    ++m_bot_counters[options.bot].spawned;
+    return true;
+  }
+
+  //creates and registers a session, called under m_sessions_mutex
+  Task makeSession(Coroutine&& coro, const SpawnOptions& options) {
+    auto session = Session::create(
+        std::move(coro),
+        std::bind(&BasicScheduler::addTaskToQueue, this,
+                  std::placeholders::_1),
+        [this, bot = options.bot, origin = options.origin](
+            Coroutine&& child) {
+          pushCoro(std::move(child), {.bot = bot, .origin = origin});
+        },
+        Policy::kThreaded);
+    session->setClock(m_clock.get());
+    session->touch();
+    session->setPriority(options.priority);
+    session->setDeadline(options.deadline);
+    session->deadline_callback = options.on_deadline;
+    session->setBot(options.bot);
+    session->setOrigin(options.origin);
+    session->message_queue.setLimit(m_load_limits.messages);
+    session->flat_message_queue.setLimit(m_load_limits.messages);
+    session->callback_queue.setLimit(m_load_limits.callback_queries);
+    session->setUpdateId(Trace::currentUpdate());
+    Trace::instant("spawn", session->id());
+    m_sessions.push_back(session);
+    return session;
+  }
+
+  //earliest timer or deadline of a session, at most the next tick
+  DefaultTimer::time_point nextWakeup() {
+    auto now = this->now();
+    auto next = m_next_tick;
+    auto consider = [&](DefaultTimer::time_point at) {
+      if (at > now && at < next)
+        next = at;
+    };
+    std::lock_guard<Mutex> lock(m_sessions_mutex);
+    for (auto& session : m_sessions) {
+      auto filter = session->timer_queue.getFilter();
+      if (filter.m_enabled && filter.m_time_point.time_since_epoch().count())
+        consider(filter.m_time_point);
+      auto deadline = session->deadline();
+      if (deadline.time_since_epoch().count() != 0)
+        consider(deadline - kDeadlineMargin);
+    }
+    return next;
+  }
+
+  //refuses a spawn over the load limits, called under m_sessions_mutex
+  bool admit(const SpawnOptions& options) {
+    auto& limits = m_load_limits;
+    if (limits.max_sessions != 0 && m_sessions.size() >= limits.max_sessions) {
+      ATGBOT_LOGD << "Session rejected, too many sessions";
+      ++m_rejected_sessions;
+      return false;
+    }
+    std::size_t pending;
+    DefaultTimer::duration lag;
+    {
+      std::lock_guard<Mutex> lock(m_tasks_queue_mutex);
+      pending = m_tasks_queue.size();
+      lag = currentLag();
+    }
+    if (limits.max_pending_tasks != 0 && pending >= limits.max_pending_tasks) {
+      ATGBOT_LOGD << "Session rejected, too many pending tasks";
+      ++m_rejected_sessions;
+      return false;
+    }
+    if (limits.max_lag != DefaultTimer::duration::zero() &&
+        options.priority < limits.shed_below && lag > limits.max_lag) {
+      ATGBOT_LOGD << "Session shed, scheduler lags by " << lag.count();
+      ++m_shed_sessions;
+      return false;
+    }
+    return true;
+  }
+
+  //an empty queue does not lag, called under m_tasks_queue_mutex
+  DefaultTimer::duration currentLag() const {
+    return m_tasks_queue.empty() ? DefaultTimer::duration::zero()
+                                 : m_lag.load();
+  }
+
+  static std::uint64_t droppedEvents(const Session& session) {
+    return session.message_queue.droppedCount() +
+           session.callback_queue.droppedCount() +
+           session.flat_message_queue.droppedCount();
+  }
+
   void addTaskToQueue(Task task) {
-    std::lock_guard<std::recursive_mutex> lock(m_tasks_queue_mutex);
+    Trace::instant("enqueue", task->id());
+    if (t_batch && &t_batch->m_scheduler == this) {
+      markUnfinished(task, t_batch->m_update);
+      if (t_batch->m_woken.insert(task.get()).second)
+        t_batch->m_tasks.push_back(std::move(task));
+      return;
+    }
+    if constexpr (!Policy::kThreaded) {
+      if (std::this_thread::get_id() != m_owner) {
+        std::lock_guard _(m_remote_mutex);
+        m_remote_tasks.push_back(task);
+        m_has_remote_tasks = true;
+        return;
+      }
+    }
+    std::lock_guard<Mutex> lock(m_tasks_queue_mutex);
     if (std::find(m_tasks_queue.begin(), m_tasks_queue.end(), task) ==
         m_tasks_queue.end()) {
+      task->queued_at = now();
       m_tasks_queue.push_back(task);
+      if constexpr (ExecutorPolicy<Policy>)
+        m_backend->post();
     }
 
-    m_condition.notify_one();
+    if constexpr (kWorkerPool)
+      m_condition.notify_one();
   }
+  //queues the sessions woken during a batch under one lock
+  void flushBatch(std::vector<Task>& tasks) {
+    if (tasks.empty())
+      return;
+    if constexpr (!Policy::kThreaded) {
+      if (std::this_thread::get_id() != m_owner) {
+        std::lock_guard _(m_remote_mutex);
+        m_remote_tasks.insert(m_remote_tasks.end(), tasks.begin(),
+                              tasks.end());
+        m_has_remote_tasks = true;
+        return;
+      }
+    }
+    {
+      std::lock_guard<Mutex> lock(m_tasks_queue_mutex);
+      auto now = this->now();
+      for (auto& task : tasks)
+        if (std::find(m_tasks_queue.begin(), m_tasks_queue.end(), task) ==
+            m_tasks_queue.end()) {
+          task->queued_at = now;
+          m_tasks_queue.push_back(task);
+          if constexpr (ExecutorPolicy<Policy>)
+            m_backend->post();
+        }
+    }
+    if constexpr (kWorkerPool) {
+      if (tasks.size() >= m_threads.size())
+        m_condition.notify_all();
+      else
+        for (std::size_t i = 0; i < tasks.size(); ++i)
+          m_condition.notify_one();
+    }
+  }
+
+  //moves wakeups from foreign threads into the queue
+  void takeRemoteTasks() {
+    if (!m_has_remote_tasks)
+      return;
+    std::vector<Task> tasks;
+    {
+      std::lock_guard _(m_remote_mutex);
+      tasks.swap(m_remote_tasks);
+      m_has_remote_tasks = false;
+    }
+    for (auto& task : tasks)
+      addTaskToQueue(task);
+  }
+
   void updateTask(Task task) {
     m_message_router.update(task);
     m_callback_router.update(task);
     m_timer_router.update(task);
+    m_flat_message_router.update(task);
+    if constexpr (ExecutorPolicy<Policy>)
+      armTimer(task);
+  }
+
+  //an executor timer wakes a session at its time point, the tick is only
+  //a fallback
+  void armTimer(const Task& task) {
+    auto filter = task->timer_queue.getFilter();
+    auto at = filter.m_time_point;
+    //updateTask runs on any executor thread, only one of them arms
+    if (!filter.m_enabled || at.time_since_epoch().count() == 0 ||
+        task->armed_timer.exchange(at) == at)
+      return;
+    m_backend->arm(at, [session = std::weak_ptr<Session>(task)]() {
+      if (auto task = session.lock()) {
+        task->timer_queue.push(TimerEvent(task->now()));
+        task->execute();
+      }
+    });
+  }
+
+  //one posted handler resumes the best queued session
+  void runOne() {
+    Task task;
+    {
+      std::lock_guard<Mutex> lock(m_tasks_queue_mutex);
+      if (!m_running || m_tasks_queue.empty())
+        return;
+      auto next = nextTask();
+      task = *next;
+      m_tasks_queue.erase(next);
+      m_lag = now() - task->queued_at;
+      m_running_tasks.push_back(task);
+      ++m_bot_served[task->bot()];
+      ++m_bot_resumed[task->bot()];
+      if (m_tasks_queue.empty())
+        m_bot_served.clear();
+    }
+    processTask(task);
+    std::lock_guard<Mutex> lock(m_tasks_queue_mutex);
+    m_running_tasks.erase(
+        std::find(m_running_tasks.begin(), m_running_tasks.end(), task));
   }
 
   void thread() {
     while (m_running) {
       Task task_to_process = nullptr;
       {
-        std::unique_lock<std::recursive_mutex> lock(m_tasks_queue_mutex);
+        std::unique_lock<Mutex> lock(m_tasks_queue_mutex);
         m_condition.wait(
             lock, [this]() { return !m_tasks_queue.empty() || !m_running; });
 
@@ -172,25 +895,125 @@ class Scheduler {
           return;
 
         if (!m_tasks_queue.empty()) {
-          task_to_process = m_tasks_queue.front();
-          m_tasks_queue.erase(m_tasks_queue.begin());
+          auto next = nextTask();
+          task_to_process = *next;
+          m_tasks_queue.erase(next);
+          m_lag = now() - task_to_process->queued_at;
+          m_running_tasks.push_back(task_to_process);
+          ++m_bot_served[task_to_process->bot()];
+          ++m_bot_resumed[task_to_process->bot()];
+          if (m_tasks_queue.empty())
+            m_bot_served.clear();
         }
       }
 
       if (task_to_process) {
         processTask(task_to_process);
+        std::lock_guard<Mutex> lock(m_tasks_queue_mutex);
+        m_running_tasks.erase(std::find(m_running_tasks.begin(),
+                                        m_running_tasks.end(),
+                                        task_to_process));
       }
     }
   }
 
+  //highest priority class first, earliest deadline first inside a class,
+  //then the bot served least during the current burst, FIFO otherwise
+  std::vector<Task>::iterator nextTask() {
+    auto served = [this](const Task& task) {
+      auto it = m_bot_served.find(task->bot());
+      return it == m_bot_served.end() ? 0 : it->second;
+    };
+    auto before = [&served](const Task& a, const Task& b) {
+      if (a->priority() != b->priority())
+        return a->priority() > b->priority();
+      auto a_deadline = a->deadline(), b_deadline = b->deadline();
+      bool a_has = a_deadline.time_since_epoch().count() != 0;
+      bool b_has = b_deadline.time_since_epoch().count() != 0;
+      if (a_has != b_has)
+        return a_has;
+      if (a_has && a_deadline != b_deadline)
+        return a_deadline < b_deadline;
+      return served(a) < served(b);
+    };
+    auto best = m_tasks_queue.begin();
+    for (auto it = std::next(best); it != m_tasks_queue.end(); ++it)
+      if (before(*it, *best))
+        best = it;
+    return best;
+  }
+
   void processTask(Task task) {
-    while (task->tryResume()) {}
+    auto update = takeUnfinished(task);
+    resumeTask(task);
+    finishUpdate(task->bot(), update);
+  }
+
+  //the session owes a resume to the update, only its lowest update is kept
+  void markUnfinished(const Task& task, std::int64_t update) {
+    if (update == 0)
+      return;
+    std::lock_guard _(m_unfinished_mutex);
+    auto& pending = task->unfinished_update;
+    if (pending != 0 && pending <= update)
+      return;
+    auto& updates = m_unfinished[task->bot()];
+    if (pending != 0)
+      updates.erase(updates.find(pending));
+    updates.insert(update);
+    pending = update;
+  }
+
+  //events routed from now on wait for the next resume
+  std::int64_t takeUnfinished(const Task& task) {
+    std::lock_guard _(m_unfinished_mutex);
+    return std::exchange(task->unfinished_update, 0);
+  }
+
+  void finishUpdate(BotId bot, std::int64_t update) {
+    if (update == 0)
+      return;
+    std::lock_guard _(m_unfinished_mutex);
+    auto it = m_unfinished.find(bot);
+    it->second.erase(it->second.find(update));
+    if (it->second.empty())
+      m_unfinished.erase(it);
+  }
+
+  void resumeTask(Task task) {
+    //a worker records the update of the session, not of its own thread
+    Trace::UpdateTag update(task->updateId());
+    if (task->discard_unstarted && !task->started()) {
+      Trace::instant("cancelled", task->id());
+      removeSession(task);
+      return;
+    }
+    // a wakeup whose condition does not hold yet is not traced
+    bool traced = Trace::enabled() &&
+                  task->getStatus() == Coroutine::state_type::kReady;
+    if (traced && task->awaiting())
+      Trace::asyncEnd(task->awaiting(), task->id());
+    try {
+      while (true) {
+        Trace::Scope trace("resume", task->id());
+        if (!task->tryResume())
+          break;
+      }
+    } catch (const CancelledError&) {
+      ATGBOT_LOGD << "Session cancelled";
+      Trace::instant("cancelled", task->id());
+      removeSession(task);
+      return;
+    }
+    if (traced && task->getStatus() == Coroutine::state_type::kWait)
+      Trace::asyncBegin(task->awaiting(), task->id());
     if (task->getStatus() == Coroutine::state_type::kNull) {
       removeSession(task);
       return;
     }
     if (task->getStatus() == Coroutine::state_type::kDone ||
         task->getStatus() == Coroutine::state_type::kException) {
+      Trace::instant("done", task->id());
       removeSession(task);
       return;
     }
@@ -198,32 +1021,90 @@ class Scheduler {
   }
 
   void removeSession(Task session) {
+    finishUpdate(session->bot(), takeUnfinished(session));
     m_message_router.remove(session);
     m_callback_router.remove(session);
     m_timer_router.remove(session);
-    std::lock_guard<std::recursive_mutex> lock(m_sessions_mutex);
-    m_sessions.erase(std::remove(m_sessions.begin(), m_sessions.end(), session),
-                     m_sessions.end());
+    m_flat_message_router.remove(session);
+    std::lock_guard<Mutex> lock(m_sessions_mutex);
+    auto it = std::find(m_sessions.begin(), m_sessions.end(), session);
+    if (it == m_sessions.end())
+      return;
+    m_dropped_events += droppedEvents(*session);
+    m_sessions.erase(it);
   }
 
  private:
+  static constexpr auto kTickInterval = std::chrono::seconds(1);
+  //only the workers of MultiThreaded wait on m_condition
+  static constexpr bool kWorkerPool =
+      Policy::kThreaded && !ExecutorPolicy<Policy>;
+
+  static inline thread_local Batch* t_batch = nullptr;
+
   std::vector<Task> m_sessions;
-  std::recursive_mutex m_sessions_mutex;
+  Mutex m_sessions_mutex;
 
   std::vector<Task> m_tasks_queue;
-  std::recursive_mutex m_tasks_queue_mutex;
+  std::vector<Task> m_running_tasks;
+  Mutex m_tasks_queue_mutex;
 
   std::condition_variable_any m_condition;
   std::vector<std::thread> m_threads;
 
   std::atomic<bool> m_running;
 
-  EventRouter<TgBot::Message::Ptr> m_message_router{&Session::message_queue};
-  EventRouter<TgBot::CallbackQuery::Ptr> m_callback_router{
+  // SingleThreaded policy only
+  std::thread::id m_owner;
+  DefaultTimer::time_point m_next_tick{};
+  std::mutex m_remote_mutex;
+  std::vector<Task> m_remote_tasks;
+  std::atomic<bool> m_has_remote_tasks{false};
+
+  // Simulated policy only
+  std::unique_ptr<VirtualClock> m_clock;
+
+  // ExecutorPolicy only
+  using Backend = typename BackendOf<Policy>::type;
+  std::unique_ptr<Backend> m_backend;
+
+  SessionLimits m_limits;
+  std::atomic<std::size_t> m_evicted{0};
+  LoadLimits m_load_limits;
+  std::atomic<std::uint64_t> m_rejected_sessions{0};
+  std::atomic<std::uint64_t> m_shed_sessions{0};
+  // dropped by finished sessions, guarded by m_sessions_mutex
+  std::uint64_t m_dropped_events = 0;
+  // queue wait of the last dequeued task
+  std::atomic<DefaultTimer::duration> m_lag{DefaultTimer::duration::zero()};
+  // see unfinishedUpdates(), also guards Session::unfinished_update
+  std::mutex m_unfinished_mutex;
+  std::unordered_map<BotId, std::multiset<std::int64_t>> m_unfinished;
+  // signal dumps seen by the timer
+  std::uint64_t m_dump_requests = sessionDumpRequests();
+
+  struct BotCounters {
+    std::uint64_t spawned = 0;
+    std::uint64_t rejected = 0;
+  };
+  std::atomic<BotId> m_last_bot{0};
+  std::unordered_map<BotId, std::size_t> m_bot_quotas;
+  std::unordered_map<BotId, BotCounters> m_bot_counters;
+  // guarded by m_tasks_queue_mutex
+  std::unordered_map<BotId, std::uint64_t> m_bot_served;
+  std::unordered_map<BotId, std::uint64_t> m_bot_resumed;
+
+  EventRouter<TgBot::Message::Ptr, Mutex> m_message_router{
+      &Session::message_queue};
+  EventRouter<TgBot::CallbackQuery::Ptr, Mutex> m_callback_router{
       &Session::callback_queue};
-  EventRouter<TimerEvent> m_timer_router{&Session::timer_queue};
+  EventRouter<TimerEvent, Mutex> m_timer_router{&Session::timer_queue};
+  EventRouter<FlatMessage, Mutex> m_flat_message_router{
+      &Session::flat_message_queue};
 
   TimerEventGenerator m_generator;
 };
 
+using Scheduler = BasicScheduler<MultiThreaded>;
+
 }  // namespace ATgBot::Tools
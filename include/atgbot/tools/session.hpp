@@ -7,6 +7,8 @@
 
 #include "atgbot/coroutine.hpp"
 #include "atgbot/tools/eventqueue.hpp"
+#include "atgbot/tools/flatmessage.hpp"
+#include "atgbot/tools/spawnoptions.hpp"
 #include "atgbot/tools/timerevent.hpp"
 
 namespace ATgBot {
@@ -23,13 +25,69 @@ class Session : public std::enable_shared_from_this<Session> {
   using CoroCallback = std::function<void(Coroutine&&)>;
 
   //private constructor
-  Session(Coroutine&& coro) : coro(std::move(coro)) {}
+  Session(Coroutine&& coro)
+      : coro(std::move(coro)),
+        session_id(++s_last_id),
+        last_activity(DefaultTimer::now()) {}
 
  public:
-  //creates shared object
+  //creates shared object, an unsynchronized session is only touched by
+  //one thread
   static std::shared_ptr<Session> create(Coroutine&& coro,
                                          QueueCallback q_callback,
-                                         CoroCallback c_callback);
+                                         CoroCallback c_callback,
+                                         bool synchronized = true);
+
+  /**
+   * @brief Runs a new coroutine on the calling thread until it finishes or
+   * suspends. The session is created by make(std::move(coro)) when an
+   * awaitable on this thread asks for it, or at the latest when the first
+   * resume returns with the coroutine suspended; it stays locked until
+   * then. Other threads asking for it wait for the promotion.
+   *
+   * @return The session, nullptr if the coroutine finished without one.
+   */
+  template <class Make>
+  static std::shared_ptr<Session> runInline(Coroutine&& coro, Make make) {
+    struct Context {
+      Coroutine& coro;
+      Make& make;
+      std::shared_ptr<Session> session;
+    } context{coro, make, nullptr};
+
+    auto handle = coro.coro;
+    if (!handle)
+      return nullptr;
+    auto& promise = handle.promise();
+    promise.m_promote_context = &context;
+    promise.m_promote = [](void* data) -> Session* {
+      auto& context = *static_cast<Context*>(data);
+      context.session = context.make(std::move(context.coro));
+      // nobody else may resume it before the first resume returns
+      if (context.session->synchronized)
+        context.session->mutex.lock();
+      return context.session.get();
+    };
+    promise.m_inline_thread = std::this_thread::get_id();
+    promise.m_inline = true;
+    handle.resume();
+    //a suspended coroutine always gets a session, also when its awaitable
+    //never asked for one
+    if (!context.session && !handle.done())
+      promise.session();
+    promise.m_inline = false;
+
+    auto session = std::move(context.session);
+    if (session) {
+      session->suspended_at = session->now();
+      if (session->synchronized)
+        session->mutex.unlock();
+      return session;
+    }
+    if (promise.getState() == Coroutine::state_type::kException)
+      std::rethrow_exception(promise.m_exception);
+    return nullptr;
+  }
   //returns status
   Coroutine::state_type getStatus() const;
   // trying to resume
@@ -38,21 +96,97 @@ class Session : public std::enable_shared_from_this<Session> {
   void execute();
   void pushCoro(Coroutine&& coro) const;
 
+  // idle tracking and eviction
+  //marks the session as active right now, done for accepted events and
+  //resumes
+  void touch();
+  DefaultTimer::time_point lastActivity() const;
+  //per-session idle ttl, zero means the scheduler default is used
+  void setIdleTtl(DefaultTimer::duration ttl);
+  DefaultTimer::duration idleTtl() const;
+  //the coroutine gets CancelledError on its next resume
+  void cancel();
+  bool isCancelled() const;
+  std::size_t frameSize() const;
+  //unique id of the session in the process
+  std::uint64_t id() const;
+  //kind of the awaitable the coroutine waits on, nullptr before it started
+  const char* awaiting() const;
+  //filter keys of the awaitable the coroutine waits on
+  FilterKeys waitKeys() const;
+  //end of the last resume
+  DefaultTimer::time_point suspendedSince() const;
+  //false until the coroutine was resumed once
+  bool started() const;
+  //events waiting in the queues of the session, safe from any thread
+  std::size_t queuedEvents() const;
+  //handler or command that spawned the session, set before scheduling
+  void setOrigin(std::string origin);
+  const std::string& origin() const;
+
+  // scheduling
+  void setPriority(Priority priority);
+  Priority priority() const;
+  //zero time point removes the deadline
+  void setDeadline(DefaultTimer::time_point deadline);
+  DefaultTimer::time_point deadline() const;
+  //the handler answered its update, the deadline callback is skipped
+  void setAnswered();
+  bool answered() const;
+  //virtual clock of a simulated scheduler, nullptr for the real clock; set
+  //before the session is scheduled
+  void setClock(const VirtualClock* clock);
+  //time of the scheduler that runs the session
+  DefaultTimer::time_point now() const;
+  //bot owning the session, set before the session is scheduled
+  void setBot(BotId bot);
+  BotId bot() const;
+  //update that spawned or last woke the session, for tracing
+  void setUpdateId(std::int64_t update_id);
+  std::int64_t updateId() const;
+
   // messages processing
   //std::Queue<TimerEvent> timer_queue;
   EventQueue<TgBot::Message::Ptr> message_queue;
   EventQueue<TgBot::CallbackQuery::Ptr> callback_queue;
   EventQueue<TimerEvent> timer_queue;
+  EventQueue<FlatMessage> flat_message_queue;
  private:
   // mutex
   mutable std::recursive_mutex mutex;
+  bool synchronized = true;
   // state
   Coroutine coro;
+  const std::uint64_t session_id;
   // scheduler callbacks
   QueueCallback add_to_queue_callback;
   CoroCallback add_new_coro_callback;
+  // idle tracking
+  std::atomic<DefaultTimer::time_point> last_activity;
+  std::atomic<DefaultTimer::duration> idle_ttl{DefaultTimer::duration::zero()};
+  // scheduling
+  std::atomic<Priority> priority_class{Priority::kNormal};
+  std::atomic<DefaultTimer::time_point> deadline_point{};
+  std::function<void()> deadline_callback;
+  std::atomic<bool> update_answered{false};
+  const VirtualClock* clock = nullptr;
+  std::atomic<bool> discard_unstarted{false};
+  BotId bot_id = 0;
+  std::atomic<std::int64_t> update_id{0};
+  // guarded by the task queue mutex of the scheduler
+  DefaultTimer::time_point queued_at{};
+  // lowest update waiting for the next resume, guarded by the scheduler
+  std::int64_t unfinished_update = 0;
+  // time point of the executor timer armed for timer_queue
+  std::atomic<DefaultTimer::time_point> armed_timer{};
+  // introspection
+  std::atomic<DefaultTimer::time_point> suspended_at{};
+  std::string spawn_origin;
+
+  static inline std::atomic<std::uint64_t> s_last_id{0};
 
-  friend class Scheduler;
+  template <class Policy>
+  friend class BasicScheduler;
   friend class SessionPrivate;
 };
 
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "timerevent.hpp"
+
+namespace ATgBot::Tools {
+
+class Session;
+
+/**
+ * @brief Selects which session is evicted when the scheduler is over budget.
+ */
+enum class EvictionPolicy {
+  kLeastRecentlyUsed,  ///< evict the session with the oldest last event
+  kCallback            ///< let SessionLimits::on_evict pick the victim
+};
+
+/**
+ * @brief Limits applied by the scheduler to live sessions.
+ *
+ * Zero values disable the corresponding limit. Evicted sessions are
+ * cancelled: their coroutine gets CancelledError on the next resume.
+ */
+struct SessionLimits {
+  using EvictionCallback = std::function<std::shared_ptr<Session>(
+      const std::vector<std::shared_ptr<Session>>&)>;
+
+  DefaultTimer::duration idle_ttl =
+      DefaultTimer::duration::zero();  ///< default idle time to live
+  std::size_t max_sessions = 0;        ///< budget on live sessions
+  std::size_t max_frame_bytes = 0;     ///< budget on coroutine frame bytes
+  EvictionPolicy policy = EvictionPolicy::kLeastRecentlyUsed;
+  EvictionCallback on_evict;  ///< returns a victim or nullptr to stop
+};
+
+}  // namespace ATgBot::Tools
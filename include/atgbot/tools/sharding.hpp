@@ -0,0 +1,142 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <tgbot/tgbot.h>
+
+#include "updatewindow.hpp"
+
+namespace ATgBot::Tools {
+
+/**
+ * @brief Owns the long poll and partitions updates by chat between worker
+ * processes.
+ *
+ * Creates a named shared memory segment with one inbound ring per worker
+ * and one outbound ring per worker. Updates of one chat always go to the
+ * same worker, so conversations keep their order. Workers send API calls
+ * back through their outbound ring; the ingest runs them at a limited rate.
+ *
+ * A worker that crashes loses no updates: a record leaves the ring only
+ * when the worker acknowledged it, and a restarted worker attaches to the
+ * same ring and continues from the first unacknowledged record. A full
+ * ring holds the long poll back instead of dropping updates.
+ */
+class ShardIngest {
+ public:
+  //runs an API call sent by a worker
+  using CallHandler =
+      std::function<void(const std::string& method, const std::string& args)>;
+
+  ShardIngest(const std::string& name, std::size_t shards,
+              std::size_t ring_bytes = kDefaultRingBytes);
+  ~ShardIngest();
+
+  ShardIngest(const ShardIngest&) = delete;
+  ShardIngest& operator=(const ShardIngest&) = delete;
+
+  //chat (or user) the update belongs to, zero if it has none
+  static std::int64_t partitionKey(const TgBot::Update::Ptr& update);
+  std::size_t shardOf(const TgBot::Update::Ptr& update) const;
+
+  /**
+   * @brief Serializes the update into the ring of its shard.
+   *
+   * @return false if the ring is full; nothing is written and the caller
+   * retries once the worker made room.
+   */
+  bool dispatch(const TgBot::Update::Ptr& update);
+
+  /**
+   * @brief Runs pending calls of all workers, as many as the rate allows.
+   *
+   * @return Number of executed calls.
+   */
+  std::size_t pumpCalls(const CallHandler& handler);
+
+  //token bucket for outbound calls
+  void setCallRate(double per_second, std::size_t burst);
+
+  /**
+   * @brief Long polls the bot and dispatches updates until stop(); a second
+   * thread runs the outbound calls meanwhile.
+   */
+  void run(TgBot::Bot& bot, const CallHandler& handler);
+  void stop();
+
+  std::size_t shards() const;
+  std::uint64_t dispatchedCount() const { return m_dispatched; }
+  //times the long poll waited for a full ring
+  std::uint64_t stalledCount() const { return m_stalled; }
+
+  static constexpr std::size_t kDefaultRingBytes = 1 << 20;
+
+ private:
+  struct Segment;
+  std::unique_ptr<Segment> m_segment;
+
+  std::atomic<bool> m_running{false};
+  std::atomic<std::uint64_t> m_dispatched{0};
+  std::atomic<std::uint64_t> m_stalled{0};
+  UpdateIdWindow m_seen_updates;
+
+  // call rate limit
+  double m_rate = 30;
+  double m_burst = 30;
+  double m_tokens = 30;
+  std::chrono::steady_clock::time_point m_refill =
+      std::chrono::steady_clock::now();
+  std::size_t m_next_shard = 0;
+};
+
+/**
+ * @brief Worker process side of ShardIngest.
+ *
+ * Attaches to the segment created by the ingest and consumes the updates
+ * of one shard. Pass it to AsyncBot::run() to feed the bot.
+ */
+class ShardWorker {
+ public:
+  ShardWorker(const std::string& name, std::size_t shard);
+  ~ShardWorker();
+
+  ShardWorker(const ShardWorker&) = delete;
+  ShardWorker& operator=(const ShardWorker&) = delete;
+
+  /**
+   * @brief Reads up to max updates after the ones already polled, empty if
+   * there are none. They stay in the ring until acknowledge().
+   */
+  std::vector<TgBot::Update::Ptr> poll(std::size_t max);
+
+  //releases the oldest count polled updates, all of them by default
+  void acknowledge(std::size_t count = std::numeric_limits<std::size_t>::max());
+
+  /**
+   * @brief Sends an API call to the ingest.
+   *
+   * @return false if the outbound ring is full.
+   */
+  bool call(const std::string& method, const std::string& args);
+
+  std::size_t shard() const { return m_shard; }
+
+ private:
+  struct Segment;
+  std::unique_ptr<Segment> m_segment;
+  std::size_t m_shard;
+
+  //ring position after the last polled record and after each polled update
+  std::uint64_t m_cursor = 0;
+  std::deque<std::uint64_t> m_polled;
+};
+
+}  // namespace ATgBot::Tools
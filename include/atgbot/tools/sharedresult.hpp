@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace ATgBot::Tools {
+
+/**
+ * @brief Result of one operation shared by every caller that waits for it.
+ *
+ * Threads outside coroutines block in wait(); coroutines suspend on it with
+ * Awaitables::awaitResult() and are woken through their session, so no
+ * worker is held while the producer runs.
+ */
+template <class T>
+class SharedResult {
+ public:
+  void setValue(T value) {
+    finish([this, &value]() { m_value.emplace(std::move(value)); });
+  }
+  void setException(std::exception_ptr error) {
+    finish([this, &error]() { m_error = error; });
+  }
+
+  bool ready() const { return m_ready.load(std::memory_order_acquire); }
+
+  //calls wake once the result is set, false without calling it if the
+  //result is already set
+  bool onReady(std::function<void()> wake) {
+    std::lock_guard _(m_mutex);
+    if (ready())
+      return false;
+    m_wakes.push_back(std::move(wake));
+    return true;
+  }
+
+  //blocks the calling thread until the result is set
+  const T& wait() const {
+    std::unique_lock lock(m_mutex);
+    m_condition.wait(lock, [this]() { return ready(); });
+    return get();
+  }
+
+  //rethrows the error of the producer, only valid once ready
+  const T& get() const {
+    if (m_error)
+      std::rethrow_exception(m_error);
+    return *m_value;
+  }
+
+ private:
+  template <class Set>
+  void finish(Set set) {
+    std::vector<std::function<void()>> wakes;
+    {
+      std::lock_guard _(m_mutex);
+      set();
+      m_ready.store(true, std::memory_order_release);
+      wakes.swap(m_wakes);
+    }
+    m_condition.notify_all();
+    for (auto& wake : wakes)
+      wake();
+  }
+
+  mutable std::mutex m_mutex;
+  mutable std::condition_variable m_condition;
+  std::atomic<bool> m_ready{false};
+  std::optional<T> m_value;
+  std::exception_ptr m_error;
+  std::vector<std::function<void()>> m_wakes;
+};
+
+}  // namespace ATgBot::Tools
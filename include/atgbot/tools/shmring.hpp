@@ -0,0 +1,152 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string>
+#include <string_view>
+
+namespace ATgBot::Tools {
+
+/**
+ * @brief Single-producer, single-consumer ring of byte records placed in
+ * caller-provided memory, usually a shared memory segment.
+ *
+ * Records are stored contiguously with a 4-byte length prefix; a record
+ * that does not fit before the end of the buffer is moved to its start.
+ * The read and write positions only grow, so a consumer that restarts
+ * continues from the last record it released; peek() and release() let it
+ * keep a record in the ring until it is done with it.
+ */
+class ShmRing {
+  static_assert(std::atomic<std::uint64_t>::is_always_lock_free,
+                "ShmRing needs address-free atomics");
+
+  struct Header {
+    alignas(64) std::atomic<std::uint64_t> write{0};
+    alignas(64) std::atomic<std::uint64_t> read{0};
+    std::uint64_t capacity = 0;
+  };
+
+ public:
+  //bytes of memory needed for a ring with the capacity, rings can be placed
+  //back to back
+  static constexpr std::size_t footprint(std::size_t capacity) {
+    return sizeof(Header) + ((align(capacity) + 63) & ~std::size_t(63));
+  }
+
+  //initializes a new ring in the memory
+  static ShmRing create(void* memory, std::size_t capacity) {
+    auto header = new (memory) Header;
+    header->capacity = align(capacity);
+    return ShmRing(memory);
+  }
+
+  //attaches to a ring created by another process
+  explicit ShmRing(void* memory)
+      : m_header(static_cast<Header*>(memory)),
+        m_data(static_cast<unsigned char*>(memory) + sizeof(Header)) {}
+
+  /**
+   * @brief Appends a record. Producer side only.
+   *
+   * @return false if the ring has no room for the record.
+   */
+  bool push(std::string_view record) {
+    const std::uint64_t capacity = m_header->capacity;
+    const std::uint64_t need = align(kPrefix + record.size());
+    std::uint64_t write = m_header->write.load(std::memory_order_relaxed);
+    std::uint64_t read = m_header->read.load(std::memory_order_acquire);
+    std::uint64_t pos = write % capacity;
+    std::uint64_t skip = capacity - pos < need ? capacity - pos : 0;
+    if (need > capacity || skip + need > capacity - (write - read))
+      return false;
+
+    if (skip != 0) {
+      storePrefix(pos, kWrap);
+      pos = 0;
+    }
+    storePrefix(pos, static_cast<std::uint32_t>(record.size()));
+    std::memcpy(m_data + pos + kPrefix, record.data(), record.size());
+    m_header->write.store(write + skip + need, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Takes the oldest record. Consumer side only.
+   *
+   * @return false if the ring is empty.
+   */
+  bool pop(std::string& record) {
+    auto position = readPosition();
+    if (!peek(position, record))
+      return false;
+    release(position);
+    return true;
+  }
+
+  /**
+   * @brief Copies the record at the position and moves the position past
+   * it, the record stays in the ring until it is released. Consumer side
+   * only.
+   *
+   * @return false if there is no record at the position yet.
+   */
+  bool peek(std::uint64_t& position, std::string& record) const {
+    const std::uint64_t capacity = m_header->capacity;
+    if (position == m_header->write.load(std::memory_order_acquire))
+      return false;
+
+    std::uint64_t pos = position % capacity;
+    std::uint32_t size = loadPrefix(pos);
+    if (size == kWrap) {
+      position += capacity - pos;
+      pos = 0;
+      size = loadPrefix(pos);
+    }
+    record.assign(reinterpret_cast<const char*>(m_data + pos + kPrefix), size);
+    position += align(kPrefix + size);
+    return true;
+  }
+
+  //position of the oldest record that is not released
+  std::uint64_t readPosition() const {
+    return m_header->read.load(std::memory_order_acquire);
+  }
+
+  //frees the records before the position for the producer
+  void release(std::uint64_t position) {
+    m_header->read.store(position, std::memory_order_release);
+  }
+
+  bool empty() const {
+    return m_header->read.load(std::memory_order_acquire) ==
+           m_header->write.load(std::memory_order_acquire);
+  }
+
+  std::size_t capacity() const { return m_header->capacity; }
+
+ private:
+  static constexpr std::size_t kPrefix = sizeof(std::uint32_t);
+  static constexpr std::uint32_t kWrap = 0xffffffff;
+
+  static constexpr std::uint64_t align(std::uint64_t size) {
+    return (size + 7) & ~std::uint64_t(7);
+  }
+
+  void storePrefix(std::uint64_t pos, std::uint32_t value) {
+    std::memcpy(m_data + pos, &value, kPrefix);
+  }
+  std::uint32_t loadPrefix(std::uint64_t pos) const {
+    std::uint32_t value;
+    std::memcpy(&value, m_data + pos, kPrefix);
+    return value;
+  }
+
+  Header* m_header;
+  unsigned char* m_data;
+};
+
+}  // namespace ATgBot::Tools
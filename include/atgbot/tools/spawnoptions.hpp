@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "priority.hpp"
+#include "timerevent.hpp"
+
+namespace ATgBot::Tools {
+
+/**
+ * @brief Identifies the bot a session belongs to when several bots share
+ * one scheduler. Sessions only receive updates of their own bot.
+ */
+using BotId = std::uint64_t;
+
+/**
+ * @brief Scheduling options of a new coroutine.
+ */
+struct SpawnOptions {
+  Priority priority = Priority::kNormal;
+  DefaultTimer::time_point deadline{};  ///< zero means no deadline
+  /// called once if the deadline is near and the session did not answer
+  std::function<void()> on_deadline;
+  BotId bot = 0;                        ///< owner of the session
+  std::string origin;  ///< handler or command that spawned the session
+};
+
+}  // namespace ATgBot::Tools
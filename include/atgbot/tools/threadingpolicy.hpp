@@ -0,0 +1,71 @@
+#pragma once
+
+#include <mutex>
+
+namespace ATgBot::Tools {
+
+/**
+ * @brief Mutex that does nothing, for code that runs on one thread.
+ */
+struct NullMutex {
+  void lock() {}
+  bool try_lock() { return true; }
+  void unlock() {}
+};
+
+/**
+ * @brief Sessions run on a pool of worker threads, a separate thread
+ * generates timer events.
+ */
+struct MultiThreaded {
+  using Mutex = std::recursive_mutex;
+  static constexpr bool kThreaded = true;
+  static constexpr bool kSimulated = false;
+};
+
+/**
+ * @brief Sessions run on the thread that calls runPending(); the scheduler
+ * and the routers take no locks and signal no condition variable.
+ *
+ * Wakeups from other threads (makeAsync) go through a small locked inbox.
+ * The event queues of a session still use atomics, Session is shared by
+ * all policies.
+ */
+struct SingleThreaded {
+  using Mutex = NullMutex;
+  static constexpr bool kThreaded = false;
+  static constexpr bool kSimulated = false;
+};
+
+/**
+ * @brief SingleThreaded on a VirtualClock owned by the scheduler: time only
+ * moves in advance() and advanceTo(), which jump straight to the next timer
+ * or tick. Runs are deterministic as long as nothing wakes sessions from
+ * other threads (makeAsync).
+ */
+struct Simulated {
+  using Mutex = NullMutex;
+  static constexpr bool kThreaded = false;
+  static constexpr bool kSimulated = true;
+};
+
+/**
+ * @brief A policy whose sessions resume as handlers of an external
+ * executor; its Backend owns the connection to it (see AsioExecutor).
+ */
+template <class Policy>
+concept ExecutorPolicy = requires { typename Policy::Backend; };
+
+struct NoBackend {};
+
+template <class Policy>
+struct BackendOf {
+  using type = NoBackend;
+};
+
+template <ExecutorPolicy Policy>
+struct BackendOf<Policy> {
+  using type = typename Policy::Backend;
+};
+
+}  // namespace ATgBot::Tools
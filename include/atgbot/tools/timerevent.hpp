@@ -8,11 +8,62 @@
 #include "eventfilter.hpp"
 
 namespace ATgBot::Tools {
-using DefaultTimer = std::chrono::high_resolution_clock;
 
+/**
+ * @brief Clock of timers, deadlines and session bookkeeping.
+ *
+ * Always reads the real clock; a simulated scheduler keeps its own
+ * VirtualClock and hands it to its sessions instead.
+ */
+struct DefaultTimer {
+  using Base = std::chrono::high_resolution_clock;
+  using rep = Base::rep;
+  using period = Base::period;
+  using duration = Base::duration;
+  using time_point = std::chrono::time_point<DefaultTimer>;
+  static constexpr bool is_steady = Base::is_steady;
+
+  static time_point now() noexcept {
+    return time_point(Base::now().time_since_epoch());
+  }
+};
+
+/**
+ * @brief Time that only moves when it is advanced. Every simulated
+ * scheduler owns one, so simulations and real schedulers can run side by
+ * side in one process.
+ */
+class VirtualClock {
+ public:
+  //starts at the real time, the zero time point means "not set" elsewhere
+  VirtualClock() : m_now(DefaultTimer::now().time_since_epoch().count()) {}
+  VirtualClock(const VirtualClock&) = delete;
+  VirtualClock& operator=(const VirtualClock&) = delete;
+
+  DefaultTimer::time_point now() const {
+    return DefaultTimer::time_point(
+        DefaultTimer::duration(m_now.load(std::memory_order_acquire)));
+  }
+
+  //moves the time forward, never backwards
+  void advanceTo(DefaultTimer::time_point time_point) {
+    auto ticks = time_point.time_since_epoch().count();
+    if (ticks > m_now.load(std::memory_order_relaxed))
+      m_now.store(ticks, std::memory_order_release);
+  }
+  void advance(DefaultTimer::duration duration) {
+    advanceTo(now() + duration);
+  }
+
+ private:
+  std::atomic<DefaultTimer::rep> m_now;
+};
+
+//time_point is the time of the clock that raised the event
 class TimerEvent {
  public:
   TimerEvent() : time_point(DefaultTimer::now()) {}
+  explicit TimerEvent(DefaultTimer::time_point t) : time_point(t) {}
   DefaultTimer::time_point time_point;
 };
 
@@ -23,7 +74,7 @@ class EventFilter<TimerEvent> {
     if (!m_enabled)
       return false;
     if (m_time_point.time_since_epoch().count() != 0)
-      return DefaultTimer::now() >= m_time_point;
+      return elem.time_point >= m_time_point;
     return true;
   }
   void setTimePoint(const DefaultTimer::time_point& p) { m_time_point = p; }
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+
+namespace ATgBot::Tools {
+
+/**
+ * @brief Optional tracing of updates and session lifecycles.
+ *
+ * Every thread records into its own buffer without locks; a full buffer
+ * drops further events. While tracing is stopped a trace point costs one
+ * relaxed atomic load. The result is written as Chrome trace-event JSON,
+ * which chrome://tracing and Perfetto load directly.
+ *
+ * Events carry the session id and the id of the update being dispatched
+ * on the recording thread. A session remembers the update that spawned or
+ * last woke it and workers record that id while they resume it, so a
+ * conversation can be followed from the update arrival to its sessions.
+ */
+class Trace {
+ public:
+  static constexpr std::size_t kDefaultCapacity = 1 << 16;
+
+  //drops the previous trace and starts recording
+  static void start(std::size_t events_per_thread = kDefaultCapacity);
+  static void stop();
+  static bool enabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+  //writes the events recorded since start(), call it after stop()
+  static void writeChromeJson(std::ostream& stream);
+  static std::size_t droppedCount();
+  //buffers allocated so far; a thread that exits hands its buffer and the
+  //events in it over to the next thread that records
+  static std::size_t bufferCount();
+
+  static void instant(const char* name, std::uint64_t session = 0);
+  //marks the session as suspended on an awaitable until asyncEnd()
+  static void asyncBegin(const char* name, std::uint64_t session);
+  static void asyncEnd(const char* name, std::uint64_t session);
+
+  //records the scope as one slice
+  class Scope {
+   public:
+    explicit Scope(const char* name, std::uint64_t session = 0)
+        : m_name(enabled() ? name : nullptr), m_session(session) {
+      if (m_name)
+        m_begin = now();
+    }
+    ~Scope() {
+      if (m_name)
+        complete(m_name, m_begin, m_session);
+    }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+   private:
+    const char* m_name;
+    std::uint64_t m_session;
+    std::uint64_t m_begin = 0;
+  };
+
+  //update the events of this thread are tagged with, 0 outside updates
+  static std::int64_t currentUpdate();
+
+  //tags the events of this thread with the update of a session while it
+  //is resumed, records nothing itself
+  class UpdateTag {
+   public:
+    explicit UpdateTag(std::int64_t update_id);
+    ~UpdateTag();
+
+    UpdateTag(const UpdateTag&) = delete;
+    UpdateTag& operator=(const UpdateTag&) = delete;
+
+   private:
+    std::int64_t m_previous;
+  };
+
+  //tags the events of this thread with the update, records the dispatch
+  class UpdateScope {
+   public:
+    explicit UpdateScope(std::int64_t update_id);
+    ~UpdateScope();
+
+    UpdateScope(const UpdateScope&) = delete;
+    UpdateScope& operator=(const UpdateScope&) = delete;
+
+   private:
+    std::int64_t m_previous;
+    bool m_recorded;
+    std::uint64_t m_begin = 0;
+  };
+
+ private:
+  static std::uint64_t now();
+  static void complete(const char* name, std::uint64_t begin,
+                       std::uint64_t session);
+
+  static inline std::atomic<bool> s_enabled{false};
+};
+
+}  // namespace ATgBot::Tools
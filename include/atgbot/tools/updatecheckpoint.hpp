@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "updatewindow.hpp"
+
+namespace ATgBot::Tools {
+
+/**
+ * @brief File with the committed long-poll offset.
+ *
+ * Keeps the offset and the duplicate window across restarts, so a new
+ * process continues where the previous one stopped. A commit writes a
+ * temporary file and renames it over the checkpoint, so a crash leaves
+ * either the old or the new checkpoint, never a torn one.
+ */
+class UpdateCheckpoint {
+ public:
+  explicit UpdateCheckpoint(const std::string& path);
+  ~UpdateCheckpoint();
+
+  UpdateCheckpoint(const UpdateCheckpoint&) = delete;
+  UpdateCheckpoint& operator=(const UpdateCheckpoint&) = delete;
+
+  //next update id to request from the server
+  std::int32_t offset() const;
+  //restores the duplicate window
+  UpdateIdWindow window() const;
+  //stores the offset and the window, an offset below the committed one is
+  //ignored; an unchanged checkpoint is not written again
+  void commit(std::int32_t offset, const UpdateIdWindow& window);
+
+ private:
+  struct Data;
+  std::string m_path;
+  std::unique_ptr<Data> m_data;
+};
+
+}  // namespace ATgBot::Tools
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+namespace ATgBot::Tools {
+
+/**
+ * @brief Compact sliding bitmap of recently seen update ids.
+ *
+ * Keeps one bit per id for the last kSize ids. Ids older than the window
+ * are reported as already seen.
+ */
+class UpdateIdWindow {
+ public:
+  static constexpr std::int64_t kSize = 4096;
+  static constexpr std::size_t kWords = kSize / 64;
+  using Words = std::array<std::uint64_t, kWords>;
+
+  UpdateIdWindow() { m_words.fill(0); }
+  UpdateIdWindow(std::int64_t base, const Words& words)
+      : m_base(base), m_words(words) {}
+
+  /**
+   * @brief Marks the id as seen.
+   *
+   * @return false if the id was already seen (a duplicate).
+   */
+  bool insert(std::int64_t id) {
+    if (id < m_base)
+      return false;
+    if (id >= m_base + kSize)
+      slide(id - kSize + 1);
+    std::uint64_t& word = m_words[(id % kSize) / 64];
+    std::uint64_t bit = std::uint64_t{1} << (id % 64);
+    if (word & bit)
+      return false;
+    word |= bit;
+    return true;
+  }
+
+  //forgets an id inside the window, so it is accepted again
+  void erase(std::int64_t id) {
+    if (id >= m_base && id < m_base + kSize)
+      m_words[(id % kSize) / 64] &= ~(std::uint64_t{1} << (id % 64));
+  }
+
+  bool contains(std::int64_t id) const {
+    if (id < m_base)
+      return true;
+    if (id >= m_base + kSize)
+      return false;
+    return m_words[(id % kSize) / 64] & (std::uint64_t{1} << (id % 64));
+  }
+
+  std::int64_t base() const { return m_base; }
+  const Words& words() const { return m_words; }
+
+ private:
+  void slide(std::int64_t new_base) {
+    if (new_base - m_base >= kSize) {
+      m_words.fill(0);
+    } else {
+      for (std::int64_t id = m_base; id < new_base; ++id)
+        m_words[(id % kSize) / 64] &= ~(std::uint64_t{1} << (id % 64));
+    }
+    m_base = new_base;
+  }
+
+  std::int64_t m_base = 0;
+  Words m_words;
+};
+
+}  // namespace ATgBot::Tools
@@ -0,0 +1,77 @@
+#include "atgbot/tools/apicache.hpp"
+
+#include <limits>
+
+namespace ATgBot::Tools {
+
+TgBot::Chat::Ptr ApiCache::getChat(std::int64_t chat_id) {
+  return fetchChat(chat_id)->wait();
+}
+
+TgBot::ChatMember::Ptr ApiCache::getChatMember(std::int64_t chat_id,
+                                               std::int64_t user_id) {
+  return fetchChatMember(chat_id, user_id)->wait();
+}
+
+std::vector<TgBot::ChatMember::Ptr> ApiCache::getChatAdministrators(
+    std::int64_t chat_id) {
+  return fetchChatAdministrators(chat_id)->wait();
+}
+
+ApiCache::ChatResult ApiCache::fetchChat(std::int64_t chat_id) {
+  return m_chats.fetch(chat_id, m_ttls.chat,
+                       [this, chat_id]() { return m_api.getChat(chat_id); });
+}
+
+ApiCache::MemberResult ApiCache::fetchChatMember(std::int64_t chat_id,
+                                                 std::int64_t user_id) {
+  return m_members.fetch({chat_id, user_id}, m_ttls.member,
+                         [this, chat_id, user_id]() {
+                           return m_api.getChatMember(chat_id, user_id);
+                         });
+}
+
+ApiCache::AdministratorsResult ApiCache::fetchChatAdministrators(
+    std::int64_t chat_id) {
+  return m_administrators.fetch(
+      chat_id, m_ttls.administrators,
+      [this, chat_id]() { return m_api.getChatAdministrators(chat_id); });
+}
+
+void ApiCache::invalidate(const TgBot::ChatMemberUpdated::Ptr& update) {
+  if (!update || !update->chat)
+    return;
+  auto chat_id = update->chat->id;
+  if (update->newChatMember && update->newChatMember->user)
+    m_members.erase({chat_id, update->newChatMember->user->id});
+  else
+    m_members.eraseRange({chat_id, std::numeric_limits<std::int64_t>::min()},
+                         {chat_id, std::numeric_limits<std::int64_t>::max()});
+  // a promotion or demotion changes the administrator list
+  m_administrators.erase(chat_id);
+}
+
+void ApiCache::invalidate(const TgBot::ChatJoinRequest::Ptr& request) {
+  if (!request || !request->chat || !request->from)
+    return;
+  m_members.erase({request->chat->id, request->from->id});
+}
+
+void ApiCache::invalidateChat(std::int64_t chat_id) {
+  m_chats.erase(chat_id);
+  m_members.eraseRange({chat_id, std::numeric_limits<std::int64_t>::min()},
+                       {chat_id, std::numeric_limits<std::int64_t>::max()});
+  m_administrators.erase(chat_id);
+}
+
+std::size_t ApiCache::hitCount() const {
+  return m_chats.hitCount() + m_members.hitCount() +
+         m_administrators.hitCount();
+}
+
+std::size_t ApiCache::missCount() const {
+  return m_chats.missCount() + m_members.missCount() +
+         m_administrators.missCount();
+}
+
+}  // namespace ATgBot::Tools
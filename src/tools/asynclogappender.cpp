@@ -0,0 +1,194 @@
+#include "atgbot/tools/asynclogappender.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+#include "atgbot/tools/shmring.hpp"
+
+namespace ATgBot::Tools {
+
+namespace {
+
+constexpr std::size_t kMaxFunc = 64;
+
+//binary record, followed by the function name and the message
+struct RecordHeader {
+  std::int64_t time;
+  std::uint32_t tid;
+  std::uint32_t line;
+  std::uint16_t millis;
+  std::uint16_t func_length;
+  std::uint16_t message_length;
+  std::uint8_t severity;
+};
+
+std::atomic<std::uint64_t> g_last_appender_id{0};
+
+void format(std::string& out, const RecordHeader& header, std::string_view func,
+            std::string_view message) {
+  std::time_t time = header.time;
+  std::tm tm{};
+#ifdef _WIN32
+  localtime_s(&tm, &time);
+#else
+  localtime_r(&time, &tm);
+#endif
+  char date[32];
+  std::strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", &tm);
+
+  std::ostringstream line;
+  line << date << '.' << std::setfill('0') << std::setw(3) << header.millis
+       << ' ' << std::setfill(' ') << std::setw(5) << std::left
+       << plog::severityToString(static_cast<plog::Severity>(header.severity))
+       << " [" << header.tid << "] [" << func << '@' << header.line << "] "
+       << message << '\n';
+  out += line.str();
+}
+
+}  // namespace
+
+struct AsyncLogAppender::ThreadRing {
+  explicit ThreadRing(std::size_t bytes)
+      : memory(new unsigned char[ShmRing::footprint(bytes)]),
+        ring(ShmRing::create(memory.get(), bytes)) {}
+
+  std::unique_ptr<unsigned char[]> memory;
+  ShmRing ring;
+  //cleared when the thread exits, it pushes no more records then
+  std::atomic<bool> owned{true};
+};
+
+AsyncLogAppender::AsyncLogAppender(std::ostream& stream, std::size_t ring_bytes)
+    : m_stream(stream),
+      m_ring_bytes(ring_bytes),
+      m_id(++g_last_appender_id),
+      m_thread(&AsyncLogAppender::thread, this) {}
+
+AsyncLogAppender::~AsyncLogAppender() {
+  m_running = false;
+  m_thread.join();
+}
+
+AsyncLogAppender::ThreadRing& AsyncLogAppender::threadRing() {
+  // appenders are told apart by id, an address may be reused
+  struct Rings {
+    std::vector<std::pair<std::uint64_t, std::shared_ptr<ThreadRing>>> all;
+
+    ~Rings() {
+      for (auto& [id, ring] : all)
+        ring->owned.store(false, std::memory_order_release);
+    }
+  };
+  thread_local Rings rings;
+  for (auto& [id, ring] : rings.all)
+    if (id == m_id)
+      return *ring;
+
+  auto ring = std::make_shared<ThreadRing>(m_ring_bytes);
+  {
+    std::lock_guard _(m_rings_mutex);
+    m_rings.push_back(ring);
+  }
+  rings.all.emplace_back(m_id, ring);
+  return *ring;
+}
+
+void AsyncLogAppender::write(const plog::Record& record) {
+  std::string_view func = record.getFunc();
+  std::string_view message = record.getMessage();
+  func = func.substr(0, kMaxFunc);
+  message = message.substr(0, kMaxMessage);
+
+  RecordHeader header{
+      .time = static_cast<std::int64_t>(record.getTime().time),
+      .tid = record.getTid(),
+      .line = static_cast<std::uint32_t>(record.getLine()),
+      .millis = record.getTime().millitm,
+      .func_length = static_cast<std::uint16_t>(func.size()),
+      .message_length = static_cast<std::uint16_t>(message.size()),
+      .severity = static_cast<std::uint8_t>(record.getSeverity()),
+  };
+  char buffer[sizeof(RecordHeader) + kMaxFunc + kMaxMessage];
+  std::memcpy(buffer, &header, sizeof(header));
+  std::memcpy(buffer + sizeof(header), func.data(), func.size());
+  std::memcpy(buffer + sizeof(header) + func.size(), message.data(),
+              message.size());
+
+  std::string_view bytes(buffer,
+                         sizeof(header) + func.size() + message.size());
+  if (!threadRing().ring.push(bytes))
+    m_dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+void AsyncLogAppender::flush() {
+  drain();
+  std::lock_guard _(m_drain_mutex);
+  m_stream.flush();
+}
+
+bool AsyncLogAppender::drain() {
+  std::lock_guard _(m_drain_mutex);
+  std::vector<std::shared_ptr<ThreadRing>> rings;
+  {
+    std::lock_guard _(m_rings_mutex);
+    rings = m_rings;
+  }
+
+  std::string out, bytes;
+  std::vector<std::shared_ptr<ThreadRing>> released;
+  for (auto& ring : rings) {
+    // read before the drain, a record pushed before the exit is not lost
+    if (!ring->owned.load(std::memory_order_acquire))
+      released.push_back(ring);
+    while (ring->ring.pop(bytes)) {
+      RecordHeader header;
+      std::memcpy(&header, bytes.data(), sizeof(header));
+      std::string_view rest(bytes.data() + sizeof(header),
+                            bytes.size() - sizeof(header));
+      format(out, header, rest.substr(0, header.func_length),
+             rest.substr(header.func_length, header.message_length));
+    }
+  }
+
+  if (!released.empty()) {
+    std::lock_guard _(m_rings_mutex);
+    std::erase_if(m_rings, [&released](const auto& ring) {
+      return std::find(released.begin(), released.end(), ring) !=
+             released.end();
+    });
+  }
+
+  auto dropped = m_dropped.load(std::memory_order_relaxed);
+  if (dropped != m_reported_dropped) {
+    out += "AsyncLogAppender dropped " +
+           std::to_string(dropped - m_reported_dropped) + " records\n";
+    m_reported_dropped = dropped;
+  }
+  if (out.empty())
+    return false;
+  m_stream << out;
+  return true;
+}
+
+std::size_t AsyncLogAppender::ringCount() {
+  std::lock_guard _(m_rings_mutex);
+  return m_rings.size();
+}
+
+void AsyncLogAppender::thread() {
+  while (m_running) {
+    if (!drain())
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  drain();
+  std::lock_guard _(m_drain_mutex);
+  m_stream.flush();
+}
+
+}  // namespace ATgBot::Tools
@@ -0,0 +1,272 @@
+#include "atgbot/tools/broadcast.hpp"
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+
+#include "atgbot/tools/log.hpp"
+
+namespace ATgBot::Tools {
+
+namespace {
+
+constexpr std::uint64_t kMagic = 0x3154534143445242;  // "BRDCAST1"
+constexpr auto kRetryDelay = std::chrono::milliseconds(200);
+// upper bound of one sleep, so stop() is noticed quickly
+constexpr auto kMaxSleep = std::chrono::milliseconds(100);
+
+struct CheckpointData {
+  std::uint64_t magic;
+  std::uint64_t position;
+};
+
+}  // namespace
+
+struct Broadcast::Checkpoint {
+  boost::interprocess::file_mapping file;
+  boost::interprocess::mapped_region region;
+
+  CheckpointData* data() {
+    return static_cast<CheckpointData*>(region.get_address());
+  }
+};
+
+Broadcast::Broadcast(Recipients recipients, Send send)
+    : Broadcast(std::move(recipients), std::move(send), Options()) {}
+
+Broadcast::Broadcast(Recipients recipients, Send send, Options options)
+    : m_recipients(std::move(recipients)),
+      m_send(std::move(send)),
+      m_options(std::move(options)) {
+  namespace bip = boost::interprocess;
+  m_options.in_flight = std::max<std::size_t>(m_options.in_flight, 1);
+  if (m_options.checkpoint.empty())
+    return;
+
+  auto& path = m_options.checkpoint;
+  if (!std::filesystem::exists(path))
+    std::ofstream(path, std::ios::binary);
+  if (std::filesystem::file_size(path) != sizeof(CheckpointData))
+    std::filesystem::resize_file(path, sizeof(CheckpointData));
+
+  bip::file_mapping file(path.c_str(), bip::read_write);
+  bip::mapped_region region(file, bip::read_write, 0, sizeof(CheckpointData));
+  m_checkpoint = std::unique_ptr<Checkpoint>(
+      new Checkpoint{std::move(file), std::move(region)});
+  CheckpointData* data = m_checkpoint->data();
+  if (data->magic != kMagic)
+    *data = CheckpointData{.magic = kMagic, .position = 0};
+}
+
+Broadcast::~Broadcast() {
+  stop();
+  wait();
+  if (m_checkpoint)
+    m_checkpoint->region.flush();
+}
+
+void Broadcast::start() {
+  if (!m_threads.empty())
+    return;
+  {
+    std::lock_guard _(m_mutex);
+    if (m_checkpoint) {
+      auto position = m_checkpoint->data()->position;
+      while (m_next < position && m_recipients())
+        ++m_next;
+      m_position = m_next;
+      PLOGI << "Broadcast resumes after " << m_position << " recipients";
+    }
+    m_started = m_refill = std::chrono::steady_clock::now();
+  }
+  m_active = static_cast<int>(m_options.in_flight);
+  for (std::size_t i = 0; i < m_options.in_flight; ++i)
+    m_threads.emplace_back(&Broadcast::worker, this);
+}
+
+void Broadcast::stop() {
+  m_stopped = true;
+}
+
+void Broadcast::wait() {
+  for (auto& thread : m_threads)
+    if (thread.joinable())
+      thread.join();
+}
+
+Broadcast::Stats Broadcast::stats() const {
+  Stats stats;
+  stats.sent = m_sent;
+  stats.blocked = m_blocked;
+  stats.failed = m_failed;
+  stats.retried = m_retried;
+  stats.rate_limited = m_rate_limited;
+  std::lock_guard _(m_mutex);
+  stats.position = m_position;
+  if (m_started != std::chrono::steady_clock::time_point{}) {
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - m_started;
+    if (elapsed.count() > 0)
+      stats.per_second = static_cast<double>(stats.sent) / elapsed.count();
+  }
+  return stats;
+}
+
+Broadcast::Recipients Broadcast::fromIdFile(const std::string& path) {
+  namespace bip = boost::interprocess;
+  auto count = std::filesystem::file_size(path) / sizeof(std::int64_t);
+  if (count == 0)
+    return []() -> std::optional<std::int64_t> { return std::nullopt; };
+
+  bip::file_mapping file(path.c_str(), bip::read_only);
+  auto region = std::make_shared<bip::mapped_region>(
+      file, bip::read_only, 0, count * sizeof(std::int64_t));
+  region->advise(bip::mapped_region::advice_sequential);
+  auto ids = static_cast<const std::int64_t*>(region->get_address());
+  return [region, ids, count,
+          index = std::size_t(0)]() mutable -> std::optional<std::int64_t> {
+    if (index == count)
+      return std::nullopt;
+    return ids[index++];
+  };
+}
+
+Broadcast::Send Broadcast::textMessage(const TgBot::Api& api,
+                                       std::string text) {
+  return [&api, text = std::move(text)](std::int64_t chat_id) {
+    api.sendMessage(chat_id, text);
+  };
+}
+
+std::optional<std::chrono::seconds> Broadcast::retryAfter(
+    const TgBot::TgException& e) {
+  constexpr std::string_view kMarker = "retry after ";
+  std::string_view description = e.what();
+  auto at = description.find(kMarker);
+  if (at != std::string_view::npos) {
+    long seconds = 0;
+    for (auto c : description.substr(at + kMarker.size())) {
+      if (c < '0' || c > '9')
+        break;
+      seconds = seconds * 10 + (c - '0');
+    }
+    return std::chrono::seconds(seconds);
+  }
+  if (e.errorCode == TgBot::TgException::ErrorCode::TooManyRequests)
+    return std::chrono::seconds(1);
+  return std::nullopt;
+}
+
+//the token is taken before the recipient is claimed, so a recipient is
+//never left waiting while later ones are sent
+void Broadcast::worker() {
+  while (acquireToken()) {
+    auto next = claim();
+    if (!next || !deliver(next->second))
+      break;
+    finish(next->first);
+  }
+  if (--m_active == 0) {
+    std::lock_guard _(m_mutex);
+    m_done = m_exhausted && m_position == m_next;
+    if (m_done)
+      PLOGI << "Broadcast finished after " << m_position << " recipients";
+  }
+}
+
+std::optional<std::pair<std::uint64_t, std::int64_t>> Broadcast::claim() {
+  std::lock_guard _(m_mutex);
+  if (m_exhausted)
+    return std::nullopt;
+  auto chat_id = m_recipients();
+  if (!chat_id) {
+    m_exhausted = true;
+    return std::nullopt;
+  }
+  return std::make_pair(m_next++, *chat_id);
+}
+
+bool Broadcast::deliver(std::int64_t chat_id) {
+  std::size_t attempt = 0;
+  do {
+    try {
+      m_send(chat_id);
+      ++m_sent;
+      return true;
+    } catch (const TgBot::TgException& e) {
+      if (auto delay = retryAfter(e)) {
+        ++m_rate_limited;
+        std::lock_guard _(m_mutex);
+        m_paused_until = std::max(m_paused_until,
+                                  std::chrono::steady_clock::now() + *delay);
+        continue;
+      }
+      using ErrorCode = TgBot::TgException::ErrorCode;
+      if (e.errorCode == ErrorCode::Forbidden) {
+        ++m_blocked;
+        return true;
+      }
+      if (e.errorCode == ErrorCode::BadRequest) {
+        ATGBOT_LOGD << "Broadcast to " << chat_id << " failed: " << e.what();
+        ++m_failed;
+        return true;
+      }
+      PLOGW << "Broadcast to " << chat_id << " failed: " << e.what();
+    } catch (const std::exception& e) {
+      PLOGW << "Broadcast to " << chat_id << " failed: " << e.what();
+    }
+    if (attempt == m_options.max_retries) {
+      ++m_failed;
+      return true;
+    }
+    ++m_retried;
+    std::this_thread::sleep_for(kRetryDelay * (1 << attempt++));
+  } while (acquireToken());
+  return false;
+}
+
+//token bucket with a burst of one message, so sends are evenly spaced
+bool Broadcast::acquireToken() {
+  while (!m_stopped) {
+    std::chrono::steady_clock::duration wait;
+    {
+      std::lock_guard _(m_mutex);
+      auto now = std::chrono::steady_clock::now();
+      if (now < m_paused_until) {
+        wait = m_paused_until - now;
+      } else {
+        std::chrono::duration<double> elapsed = now - m_refill;
+        m_refill = now;
+        m_tokens = std::min(1.0, m_tokens + elapsed.count() * m_options.rate);
+        if (m_tokens >= 1) {
+          m_tokens -= 1;
+          return true;
+        }
+        wait = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>((1 - m_tokens) / m_options.rate));
+      }
+    }
+    std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(
+        wait, kMaxSleep));
+  }
+  return false;
+}
+
+void Broadcast::finish(std::uint64_t index) {
+  std::lock_guard _(m_mutex);
+  m_finished.insert(index);
+  auto begin = m_finished.begin();
+  while (begin != m_finished.end() && *begin == m_position) {
+    begin = m_finished.erase(begin);
+    ++m_position;
+  }
+  if (m_checkpoint && m_checkpoint->data()->position != m_position) {
+    m_checkpoint->data()->position = m_position;
+    m_checkpoint->region.flush(0, sizeof(CheckpointData), false);
+  }
+}
+
+}  // namespace ATgBot::Tools
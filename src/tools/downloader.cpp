@@ -0,0 +1,181 @@
+#include "atgbot/tools/downloader.hpp"
+
+#include <boost/asio/connect.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ssl.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/beast/version.hpp>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/time.h>
+#endif
+
+namespace ATgBot::Tools {
+
+namespace {
+
+namespace asio = boost::asio;
+namespace beast = boost::beast;
+namespace http = beast::http;
+
+constexpr int kSocketTimeoutSeconds = 30;
+
+//synchronous reads would wait forever on a dead connection
+void setSocketTimeout(asio::ip::tcp::socket& socket) {
+#ifdef _WIN32
+  DWORD timeout = kSocketTimeoutSeconds * 1000;
+  auto value = reinterpret_cast<const char*>(&timeout);
+#else
+  timeval timeout{kSocketTimeoutSeconds, 0};
+  auto value = &timeout;
+#endif
+  setsockopt(socket.native_handle(), SOL_SOCKET, SO_RCVTIMEO, value,
+             sizeof(timeout));
+  setsockopt(socket.native_handle(), SOL_SOCKET, SO_SNDTIMEO, value,
+             sizeof(timeout));
+}
+
+}  // namespace
+
+Downloader::Downloader(std::size_t concurrency, Fetch fetch,
+                       FilePath file_path)
+    : m_fetch(std::move(fetch)), m_file_path(std::move(file_path)) {
+  for (std::size_t i = 0; i < concurrency; ++i)
+    m_threads.emplace_back(&Downloader::thread, this);
+}
+
+Downloader::~Downloader() {
+  std::queue<Job> pending;
+  {
+    std::lock_guard _(m_mutex);
+    m_running = false;
+    pending.swap(m_jobs);
+  }
+  m_condition.notify_all();
+  //their coroutines would otherwise wait forever
+  auto error =
+      std::make_exception_ptr(std::runtime_error("downloader stopped"));
+  for (; !pending.empty(); pending.pop()) {
+    auto& job = pending.front();
+    if (job.finish) {
+      try {
+        job.finish();
+      } catch (...) {
+      }
+    }
+    job.done(error);
+  }
+  for (auto& thread : m_threads)
+    thread.join();
+}
+
+Downloader& Downloader::shared() {
+  static Downloader downloader;
+  return downloader;
+}
+
+void Downloader::submit(Job job) {
+  {
+    std::lock_guard _(m_mutex);
+    m_jobs.push(std::move(job));
+  }
+  m_condition.notify_one();
+}
+
+void Downloader::thread() {
+  while (true) {
+    Job job;
+    {
+      std::unique_lock lock(m_mutex);
+      m_condition.wait(lock,
+                       [this]() { return !m_jobs.empty() || !m_running; });
+      if (!m_running)
+        return;
+      job = std::move(m_jobs.front());
+      m_jobs.pop();
+    }
+    process(job);
+  }
+}
+
+void Downloader::process(Job& job) {
+  std::exception_ptr error;
+  try {
+    if (job.abort->load())
+      throw std::runtime_error("download aborted");
+    auto path = m_file_path(*job.bot, job.file_id);
+    m_fetch(kHost, "/file/bot" + job.bot->getToken() + "/" + path, job.sink,
+            *job.abort);
+  } catch (...) {
+    error = std::current_exception();
+  }
+  if (job.finish) {
+    try {
+      job.finish();
+    } catch (...) {
+      if (!error)
+        error = std::current_exception();
+    }
+  }
+  job.done(error);
+}
+
+std::string Downloader::apiFilePath(const TgBot::Bot& bot,
+                                    const std::string& file_id) {
+  return bot.getApi().getFile(file_id)->filePath;
+}
+
+void Downloader::httpsFetch(const std::string& host, const std::string& target,
+                            const ChunkSink& sink,
+                            const std::atomic<bool>& abort) {
+  asio::io_context context;
+  asio::ssl::context tls(asio::ssl::context::tlsv12_client);
+  tls.set_default_verify_paths();
+  tls.set_verify_mode(asio::ssl::verify_peer);
+
+  asio::ssl::stream<asio::ip::tcp::socket> stream(context, tls);
+  if (!SSL_set_tlsext_host_name(stream.native_handle(), host.c_str()))
+    throw std::runtime_error("cannot set the TLS host name");
+  stream.set_verify_callback(asio::ssl::host_name_verification(host));
+
+  asio::ip::tcp::resolver resolver(context);
+  asio::connect(stream.next_layer(), resolver.resolve(host, "443"));
+  setSocketTimeout(stream.next_layer());
+  stream.handshake(asio::ssl::stream_base::client);
+
+  http::request<http::empty_body> request(http::verb::get, target, 11);
+  request.set(http::field::host, host);
+  request.set(http::field::user_agent, BOOST_BEAST_VERSION_STRING);
+  http::write(stream, request);
+
+  beast::flat_buffer buffer;
+  http::response_parser<http::buffer_body> parser;
+  parser.body_limit(boost::none);
+  http::read_header(stream, buffer, parser);
+  if (parser.get().result() != http::status::ok)
+    throw std::runtime_error("file download failed with HTTP " +
+                             std::to_string(parser.get().result_int()));
+
+  std::vector<char> chunk(kChunkSize);
+  while (!parser.is_done()) {
+    if (abort)
+      throw std::runtime_error("download aborted");
+    parser.get().body().data = chunk.data();
+    parser.get().body().size = chunk.size();
+    beast::error_code ec;
+    http::read(stream, buffer, parser, ec);
+    if (ec && ec != http::error::need_buffer)
+      throw beast::system_error(ec);
+    auto size = chunk.size() - parser.get().body().size;
+    if (size != 0)
+      sink(std::string_view(chunk.data(), size));
+  }
+
+  beast::error_code ec;
+  stream.shutdown(ec);  // the server often closes without a TLS shutdown
+}
+
+}  // namespace ATgBot::Tools
@@ -0,0 +1,288 @@
+#include "atgbot/tools/fileidcache.hpp"
+
+#include <openssl/evp.h>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#include "atgbot/tools/log.hpp"
+
+namespace ATgBot::Tools {
+
+namespace bip = boost::interprocess;
+
+namespace {
+
+constexpr std::uint64_t kMagic = 0x3144494c46544241;  // "ABTFLID1"
+constexpr std::size_t kHeaderSize = 64;
+constexpr std::size_t kReadChunk = 64 * 1024;
+
+struct TableHeader {
+  std::uint64_t magic;
+  std::uint64_t capacity;
+  std::uint64_t size;
+};
+
+//length is written last, a slot with a zero length is free
+struct Slot {
+  FileIdCache::Digest digest;
+  std::uint8_t length;
+  char file_id[FileIdCache::kMaxFileId];
+};
+
+static_assert(sizeof(TableHeader) <= kHeaderSize);
+static_assert(sizeof(Slot) == 256);
+
+std::size_t fileSize(std::size_t capacity) {
+  return kHeaderSize + capacity * sizeof(Slot);
+}
+
+}  // namespace
+
+struct FileIdCache::Table {
+  bip::file_mapping file;
+  bip::mapped_region region;
+
+  TableHeader* header() const {
+    return static_cast<TableHeader*>(region.get_address());
+  }
+
+  Slot* slots() const {
+    return reinterpret_cast<Slot*>(
+        static_cast<unsigned char*>(region.get_address()) + kHeaderSize);
+  }
+
+  //slot holding the digest, else the free slot for it, nullptr when full
+  Slot* lookup(const Digest& digest) const {
+    const std::uint64_t capacity = header()->capacity;
+    std::uint64_t start;
+    std::memcpy(&start, digest.data(), sizeof(start));
+    for (std::uint64_t i = 0; i < capacity; ++i) {
+      auto& slot = slots()[(start + i) % capacity];
+      if (slot.length == 0 || slot.digest == digest)
+        return &slot;
+    }
+    return nullptr;
+  }
+};
+
+FileIdCache::FileIdCache(const std::filesystem::path& file,
+                         std::size_t capacity) {
+  if (capacity == 0)
+    throw std::invalid_argument("FileIdCache needs a non-zero capacity");
+
+  bool created = !std::filesystem::exists(file) ||
+                 std::filesystem::file_size(file) == 0;
+  if (created) {
+    std::ofstream(file, std::ios::binary);
+    std::filesystem::resize_file(file, fileSize(capacity));
+  }
+
+  bip::file_mapping mapping(file.string().c_str(), bip::read_write);
+  bip::mapped_region region(mapping, bip::read_write);
+  m_table = std::unique_ptr<Table>(
+      new Table{std::move(mapping), std::move(region)});
+
+  auto header = m_table->header();
+  if (created) {
+    header->capacity = capacity;
+    header->size = 0;
+    header->magic = kMagic;
+  } else if (header->magic != kMagic ||
+             m_table->region.get_size() < fileSize(header->capacity)) {
+    throw std::runtime_error(file.string() + " is not a file_id cache");
+  }
+}
+
+FileIdCache::~FileIdCache() {
+  m_table->region.flush();
+}
+
+TgBot::Message::Ptr FileIdCache::send(const std::filesystem::path& path,
+                                      const std::string& mime_type,
+                                      const Send& send) {
+  auto digest = digestOf(path);
+  bool stale = false;
+
+  while (true) {
+    std::optional<std::string> file_id;
+    Upload pending;
+    Upload done;
+    {
+      std::lock_guard _(m_mutex);
+      auto slot = stale ? nullptr : m_table->lookup(digest);
+      if (slot && slot->length != 0) {
+        file_id.emplace(slot->file_id, slot->length);
+      } else if (auto it = m_uploading.find(digest);
+                 it != m_uploading.end()) {
+        pending = it->second;
+      } else {
+        done = std::make_shared<Upload::element_type>();
+        m_uploading.emplace(digest, done);
+      }
+    }
+
+    if (done)
+      return upload(digest, path, mime_type, send, done);
+    if (pending) {
+      // waiters try on their own after a failed upload
+      file_id = pending->wait();
+      if (!file_id)
+        continue;
+    }
+
+    try {
+      auto message = send(*file_id);
+      ++m_reuses;
+      return message;
+    } catch (TgBot::TgException& e) {
+      if (stale || e.errorCode != TgBot::TgException::ErrorCode::BadRequest)
+        throw;
+      PLOGW << "Cached file_id for " << path << " was rejected, uploading "
+            << "again: " << e.what();
+      stale = true;
+    }
+  }
+}
+
+FileIdCache::Upload FileIdCache::pendingUpload(
+    const std::filesystem::path& path) {
+  auto digest = digestOf(path);
+  std::lock_guard _(m_mutex);
+  auto it = m_uploading.find(digest);
+  return it != m_uploading.end() ? it->second : nullptr;
+}
+
+TgBot::Message::Ptr FileIdCache::upload(const Digest& digest,
+                                        const std::filesystem::path& path,
+                                        const std::string& mime_type,
+                                        const Send& send, const Upload& done) {
+  auto finish = [this, &digest, &done](std::optional<std::string> file_id) {
+    {
+      std::lock_guard _(m_mutex);
+      m_uploading.erase(digest);
+    }
+    done->setValue(std::move(file_id));
+  };
+
+  TgBot::Message::Ptr message;
+  try {
+    message = send(TgBot::InputFile::fromFile(path.string(), mime_type));
+  } catch (...) {
+    finish(std::nullopt);
+    throw;
+  }
+  ++m_uploads;
+
+  auto file_id = fileIdOf(message);
+  if (file_id.empty()) {
+    finish(std::nullopt);
+    return message;
+  }
+  if (!store(digest, file_id))
+    PLOGW << "file_id of " << path << " is not cached, the table is full";
+  finish(file_id);
+  return message;
+}
+
+std::optional<std::string> FileIdCache::find(const Digest& digest) const {
+  std::lock_guard _(m_mutex);
+  auto slot = m_table->lookup(digest);
+  if (!slot || slot->length == 0)
+    return std::nullopt;
+  return std::string(slot->file_id, slot->length);
+}
+
+bool FileIdCache::store(const Digest& digest, const std::string& file_id) {
+  if (file_id.empty() || file_id.size() > kMaxFileId)
+    return false;
+
+  std::lock_guard _(m_mutex);
+  auto slot = m_table->lookup(digest);
+  if (!slot)
+    return false;
+  if (slot->length == 0)
+    ++m_table->header()->size;
+  else
+    slot->length = 0;  // a reader must not see a half written id
+  slot->digest = digest;
+  std::memcpy(slot->file_id, file_id.data(), file_id.size());
+  slot->length = static_cast<std::uint8_t>(file_id.size());
+  return true;
+}
+
+std::size_t FileIdCache::size() const {
+  std::lock_guard _(m_mutex);
+  return m_table->header()->size;
+}
+
+std::size_t FileIdCache::capacity() const {
+  return m_table->header()->capacity;
+}
+
+FileIdCache::Digest FileIdCache::hashFile(const std::filesystem::path& path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+    throw std::runtime_error("cannot open " + path.string());
+
+  std::unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)> context(
+      EVP_MD_CTX_new(), &EVP_MD_CTX_free);
+  if (!context || !EVP_DigestInit_ex(context.get(), EVP_sha256(), nullptr))
+    throw std::runtime_error("cannot initialize SHA-256");
+
+  std::vector<char> chunk(kReadChunk);
+  while (file) {
+    file.read(chunk.data(), chunk.size());
+    EVP_DigestUpdate(context.get(), chunk.data(), file.gcount());
+  }
+
+  Digest digest;
+  EVP_DigestFinal_ex(context.get(), digest.data(), nullptr);
+  return digest;
+}
+
+std::string FileIdCache::fileIdOf(const TgBot::Message::Ptr& message) {
+  if (!message)
+    return {};
+  if (!message->photo.empty())
+    return message->photo.back()->fileId;  // the largest size
+  if (message->document)
+    return message->document->fileId;
+  if (message->sticker)
+    return message->sticker->fileId;
+  if (message->video)
+    return message->video->fileId;
+  if (message->animation)
+    return message->animation->fileId;
+  if (message->audio)
+    return message->audio->fileId;
+  if (message->voice)
+    return message->voice->fileId;
+  if (message->videoNote)
+    return message->videoNote->fileId;
+  return {};
+}
+
+//rehashes a file only when its size or modification time changes
+FileIdCache::Digest FileIdCache::digestOf(const std::filesystem::path& path) {
+  auto size = std::filesystem::file_size(path);
+  auto modified = std::filesystem::last_write_time(path);
+  {
+    std::lock_guard _(m_mutex);
+    auto it = m_stamps.find(path);
+    if (it != m_stamps.end() && it->second.size == size &&
+        it->second.modified == modified)
+      return it->second.digest;
+  }
+
+  auto digest = hashFile(path);
+  std::lock_guard _(m_mutex);
+  m_stamps[path] = Stamp{size, modified, digest};
+  return digest;
+}
+
+}  // namespace ATgBot::Tools
@@ -0,0 +1,318 @@
+#include "atgbot/tools/flatmessage.hpp"
+
+#include <array>
+#include <cstring>
+#include <new>
+#include <string>
+#include <utility>
+
+namespace ATgBot::Tools {
+
+//followed by the entities and then the characters of the strings
+struct FlatMessage::Header {
+  struct StringRef {
+    std::uint32_t offset;
+    std::uint32_t length;
+  };
+
+  std::atomic<std::uint32_t> references;
+  std::uint32_t size;
+  std::int64_t chat_id;
+  std::int64_t from_id;
+  std::int32_t message_id;
+  std::int32_t message_thread_id;
+  std::int32_t reply_to_message_id;
+  std::uint32_t date;
+  std::uint32_t entity_count;
+  TgBot::Chat::Type chat_type;
+  MediaKind media_kind;
+  bool has_chat;
+  bool has_from;
+  bool from_is_bot;
+  std::array<StringRef, kFieldCount> strings;
+
+  const Entity* entities() const {
+    return reinterpret_cast<const Entity*>(this + 1);
+  }
+  const char* characters() const {
+    return reinterpret_cast<const char*>(entities() + entity_count);
+  }
+};
+
+static_assert(alignof(FlatMessage::Entity) <= alignof(std::int64_t));
+
+namespace {
+
+using MediaKind = FlatMessage::MediaKind;
+
+std::pair<MediaKind, std::string_view> media(const TgBot::Message& message) {
+  if (!message.photo.empty() && message.photo.back())
+    return {MediaKind::kPhoto, message.photo.back()->fileId};
+  if (message.document)
+    return {MediaKind::kDocument, message.document->fileId};
+  if (message.sticker)
+    return {MediaKind::kSticker, message.sticker->fileId};
+  if (message.video)
+    return {MediaKind::kVideo, message.video->fileId};
+  if (message.animation)
+    return {MediaKind::kAnimation, message.animation->fileId};
+  if (message.audio)
+    return {MediaKind::kAudio, message.audio->fileId};
+  if (message.voice)
+    return {MediaKind::kVoice, message.voice->fileId};
+  if (message.videoNote)
+    return {MediaKind::kVideoNote, message.videoNote->fileId};
+  return {MediaKind::kNone, {}};
+}
+
+template <class T>
+std::shared_ptr<T> withFileId(std::string_view file_id) {
+  auto media = std::make_shared<T>();
+  media->fileId = file_id;
+  return media;
+}
+
+}  // namespace
+
+FlatMessage::FlatMessage(const TgBot::Message& message) {
+  std::array<std::string_view, kFieldCount> strings{};
+  strings[kText] = message.text;
+  strings[kCaption] = message.caption;
+  if (message.chat) {
+    strings[kChatTitle] = message.chat->title;
+    strings[kChatUsername] = message.chat->username;
+  }
+  if (message.from) {
+    strings[kFromUsername] = message.from->username;
+    strings[kFromFirstName] = message.from->firstName;
+    strings[kFromLastName] = message.from->lastName;
+  }
+  auto [media_kind, file_id] = media(message);
+  strings[kFileId] = file_id;
+
+  std::size_t entity_count = 0;
+  for (auto& entity : message.entities)
+    entity_count += entity != nullptr;
+
+  std::size_t size = sizeof(Header) + entity_count * sizeof(Entity);
+  for (auto string : strings)
+    size += string.size();
+
+  auto memory = ::operator new(size, std::align_val_t(alignof(Header)));
+  auto header = new (memory) Header{};
+  header->references.store(1, std::memory_order_relaxed);
+  header->size = static_cast<std::uint32_t>(size);
+  header->message_id = message.messageId;
+  header->message_thread_id = message.messageThreadId;
+  header->date = message.date;
+  header->reply_to_message_id =
+      message.replyToMessage ? message.replyToMessage->messageId : 0;
+  header->media_kind = media_kind;
+  if (message.chat) {
+    header->has_chat = true;
+    header->chat_id = message.chat->id;
+    header->chat_type = message.chat->type;
+  }
+  if (message.from) {
+    header->has_from = true;
+    header->from_id = message.from->id;
+    header->from_is_bot = message.from->isBot;
+  }
+
+  header->entity_count = static_cast<std::uint32_t>(entity_count);
+  auto entities = const_cast<Entity*>(header->entities());
+  for (auto& entity : message.entities)
+    if (entity)
+      *entities++ = {entity->type, entity->offset, entity->length};
+
+  auto characters = const_cast<char*>(header->characters());
+  std::uint32_t offset = 0;
+  for (unsigned i = 0; i < kFieldCount; ++i) {
+    std::memcpy(characters + offset, strings[i].data(), strings[i].size());
+    auto length = static_cast<std::uint32_t>(strings[i].size());
+    header->strings[i] = {offset, length};
+    offset += length;
+  }
+  m_data = header;
+}
+
+FlatMessage::FlatMessage(const FlatMessage& other) noexcept
+    : m_data(other.m_data) {
+  if (m_data)
+    m_data->references.fetch_add(1, std::memory_order_relaxed);
+}
+
+FlatMessage::FlatMessage(FlatMessage&& other) noexcept
+    : m_data(std::exchange(other.m_data, nullptr)) {}
+
+FlatMessage& FlatMessage::operator=(FlatMessage other) noexcept {
+  std::swap(m_data, other.m_data);
+  return *this;
+}
+
+FlatMessage::~FlatMessage() {
+  if (m_data &&
+      m_data->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    m_data->~Header();
+    ::operator delete(m_data, std::align_val_t(alignof(Header)));
+  }
+}
+
+std::int32_t FlatMessage::messageId() const {
+  return m_data ? m_data->message_id : 0;
+}
+
+std::int32_t FlatMessage::messageThreadId() const {
+  return m_data ? m_data->message_thread_id : 0;
+}
+
+std::uint32_t FlatMessage::date() const {
+  return m_data ? m_data->date : 0;
+}
+
+std::optional<std::int64_t> FlatMessage::chatId() const {
+  if (m_data && m_data->has_chat)
+    return m_data->chat_id;
+  return std::nullopt;
+}
+
+TgBot::Chat::Type FlatMessage::chatType() const {
+  return m_data ? m_data->chat_type : TgBot::Chat::Type::Private;
+}
+
+std::string_view FlatMessage::chatTitle() const {
+  return field(kChatTitle);
+}
+
+std::string_view FlatMessage::chatUsername() const {
+  return field(kChatUsername);
+}
+
+std::optional<std::int64_t> FlatMessage::fromId() const {
+  if (m_data && m_data->has_from)
+    return m_data->from_id;
+  return std::nullopt;
+}
+
+bool FlatMessage::fromIsBot() const {
+  return m_data && m_data->from_is_bot;
+}
+
+std::string_view FlatMessage::fromUsername() const {
+  return field(kFromUsername);
+}
+
+std::string_view FlatMessage::fromFirstName() const {
+  return field(kFromFirstName);
+}
+
+std::string_view FlatMessage::fromLastName() const {
+  return field(kFromLastName);
+}
+
+std::int32_t FlatMessage::replyToMessageId() const {
+  return m_data ? m_data->reply_to_message_id : 0;
+}
+
+std::string_view FlatMessage::text() const {
+  return field(kText);
+}
+
+std::string_view FlatMessage::caption() const {
+  return field(kCaption);
+}
+
+std::span<const FlatMessage::Entity> FlatMessage::entities() const {
+  if (!m_data)
+    return {};
+  return {m_data->entities(), m_data->entity_count};
+}
+
+std::string_view FlatMessage::fileId() const {
+  return field(kFileId);
+}
+
+FlatMessage::MediaKind FlatMessage::mediaKind() const {
+  return m_data ? m_data->media_kind : MediaKind::kNone;
+}
+
+TgBot::Message::Ptr FlatMessage::toMessage() const {
+  if (!m_data)
+    return nullptr;
+
+  auto message = std::make_shared<TgBot::Message>();
+  message->messageId = m_data->message_id;
+  message->messageThreadId = m_data->message_thread_id;
+  message->date = m_data->date;
+  message->text = text();
+  message->caption = caption();
+  if (m_data->has_chat) {
+    message->chat = std::make_shared<TgBot::Chat>();
+    message->chat->id = m_data->chat_id;
+    message->chat->type = m_data->chat_type;
+    message->chat->title = chatTitle();
+    message->chat->username = chatUsername();
+  }
+  if (m_data->has_from) {
+    message->from = std::make_shared<TgBot::User>();
+    message->from->id = m_data->from_id;
+    message->from->isBot = m_data->from_is_bot;
+    message->from->username = fromUsername();
+    message->from->firstName = fromFirstName();
+    message->from->lastName = fromLastName();
+  }
+  if (m_data->reply_to_message_id != 0) {
+    message->replyToMessage = std::make_shared<TgBot::Message>();
+    message->replyToMessage->messageId = m_data->reply_to_message_id;
+    message->replyToMessage->chat = message->chat;
+  }
+  for (auto& entity : entities()) {
+    auto copy = std::make_shared<TgBot::MessageEntity>();
+    copy->type = entity.type;
+    copy->offset = entity.offset;
+    copy->length = entity.length;
+    message->entities.push_back(std::move(copy));
+  }
+  switch (m_data->media_kind) {
+    case MediaKind::kNone:
+      break;
+    case MediaKind::kPhoto:
+      message->photo.push_back(withFileId<TgBot::PhotoSize>(fileId()));
+      break;
+    case MediaKind::kDocument:
+      message->document = withFileId<TgBot::Document>(fileId());
+      break;
+    case MediaKind::kSticker:
+      message->sticker = withFileId<TgBot::Sticker>(fileId());
+      break;
+    case MediaKind::kVideo:
+      message->video = withFileId<TgBot::Video>(fileId());
+      break;
+    case MediaKind::kAnimation:
+      message->animation = withFileId<TgBot::Animation>(fileId());
+      break;
+    case MediaKind::kAudio:
+      message->audio = withFileId<TgBot::Audio>(fileId());
+      break;
+    case MediaKind::kVoice:
+      message->voice = withFileId<TgBot::Voice>(fileId());
+      break;
+    case MediaKind::kVideoNote:
+      message->videoNote = withFileId<TgBot::VideoNote>(fileId());
+      break;
+  }
+  return message;
+}
+
+std::size_t FlatMessage::allocationSize() const {
+  return m_data ? m_data->size : 0;
+}
+
+std::string_view FlatMessage::field(Field field) const {
+  if (!m_data)
+    return {};
+  auto string = m_data->strings[field];
+  return {m_data->characters() + string.offset, string.length};
+}
+
+}  // namespace ATgBot::Tools
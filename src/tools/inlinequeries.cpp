@@ -0,0 +1,113 @@
+#include "atgbot/tools/inlinequeries.hpp"
+
+namespace ATgBot::Tools {
+
+std::string normalizeInlineQuery(std::string_view text) {
+  std::string normalized;
+  normalized.reserve(text.size());
+  bool space = false;
+  for (char c : text) {
+    if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+      space = !normalized.empty();
+      continue;
+    }
+    if (space)
+      normalized.push_back(' ');
+    space = false;
+    normalized.push_back(c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c);
+  }
+  return normalized;
+}
+
+std::unordered_set<std::int32_t> InlineDebouncer::supersededInBatch(
+    const std::vector<TgBot::Update::Ptr>& updates) {
+  std::unordered_map<std::int64_t, std::int32_t> latest;
+  std::unordered_set<std::int32_t> superseded;
+  for (auto& update : updates) {
+    if (!update->inlineQuery || !update->inlineQuery->from)
+      continue;
+    auto [it, inserted] =
+        latest.try_emplace(update->inlineQuery->from->id, update->updateId);
+    if (!inserted) {
+      superseded.insert(it->second);
+      it->second = update->updateId;
+    }
+  }
+  return superseded;
+}
+
+InlineDebouncer::Task InlineDebouncer::replace(std::int64_t user_id,
+                                               const Task& session) {
+  std::lock_guard _(m_mutex);
+  auto& latest = m_latest[user_id];
+  Task previous = latest.lock();
+  latest = session;
+  if (previous)
+    ++m_superseded;
+
+  // users come and go, forget the ones whose handler finished
+  if (m_latest.size() >= m_prune_at) {
+    std::erase_if(m_latest, [](auto& entry) { return entry.second.expired(); });
+    m_prune_at = std::max(kPruneThreshold, 2 * m_latest.size());
+  }
+  return previous;
+}
+
+std::optional<InlineResultCache::Answer> InlineResultCache::find(
+    std::string_view query, const std::string& offset) {
+  std::lock_guard _(m_mutex);
+  auto it = m_index.find(key(query, offset));
+  if (it == m_index.end()) {
+    ++m_misses;
+    return std::nullopt;
+  }
+  if (it->second->expires <= DefaultTimer::now()) {
+    erase(it->second);
+    ++m_misses;
+    return std::nullopt;
+  }
+  m_entries.splice(m_entries.begin(), m_entries, it->second);
+  ++m_hits;
+  return it->second->answer;
+}
+
+void InlineResultCache::store(std::string_view query,
+                              const std::string& offset, Answer answer) {
+  if (answer.cache_time <= 0 || answer.results.size() > m_max_results)
+    return;
+
+  std::lock_guard _(m_mutex);
+  auto entry_key = key(query, offset);
+  if (auto it = m_index.find(entry_key); it != m_index.end())
+    erase(it->second);
+
+  m_results += answer.results.size();
+  auto expires =
+      DefaultTimer::now() + std::chrono::seconds(answer.cache_time);
+  m_entries.push_front({entry_key, std::move(answer), expires});
+  m_index.emplace(std::move(entry_key), m_entries.begin());
+
+  while (m_entries.size() > m_max_entries || m_results > m_max_results)
+    erase(std::prev(m_entries.end()));
+}
+
+std::size_t InlineResultCache::size() const {
+  std::lock_guard _(m_mutex);
+  return m_entries.size();
+}
+
+std::string InlineResultCache::key(std::string_view query,
+                                   const std::string& offset) {
+  auto entry_key = normalizeInlineQuery(query);
+  entry_key.push_back('\0');
+  entry_key += offset;
+  return entry_key;
+}
+
+void InlineResultCache::erase(List::iterator entry) {
+  m_results -= entry->answer.results.size();
+  m_index.erase(entry->key);
+  m_entries.erase(entry);
+}
+
+}  // namespace ATgBot::Tools
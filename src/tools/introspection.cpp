@@ -0,0 +1,103 @@
+#include "atgbot/tools/introspection.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <unordered_map>
+
+namespace ATgBot::Tools {
+
+namespace {
+
+std::atomic<std::uint64_t> g_dump_requests{0};
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free,
+              "the signal handler needs a lock-free counter");
+
+extern "C" void onDumpSignal(int) {
+  g_dump_requests.fetch_add(1, std::memory_order_relaxed);
+}
+
+void add(SessionReport::Group& group, const SessionInfo& info) {
+  ++group.sessions;
+  group.frame_bytes += info.frame_size;
+  group.queued_events += info.queued_events;
+}
+
+void writeGroup(std::ostream& stream, const SessionReport::Group& group) {
+  stream << group.sessions << " sessions, " << group.frame_bytes
+         << " frame bytes, " << group.queued_events << " queued events";
+}
+
+}  // namespace
+
+SessionReport::SessionReport(std::vector<SessionInfo> infos)
+    : sessions(std::move(infos)) {
+  std::unordered_map<std::int64_t, Group> chats;
+  for (auto& info : sessions) {
+    add(total, info);
+    add(by_origin[info.origin.empty() ? "unknown" : info.origin], info);
+    add(by_awaiting[info.awaiting.empty() ? "not started" : info.awaiting],
+        info);
+    if (info.keys.chat)
+      add(chats[*info.keys.chat], info);
+
+    auto seconds =
+        std::chrono::duration_cast<std::chrono::seconds>(info.suspended)
+            .count();
+    auto bucket = std::upper_bound(kSuspendedBuckets.begin(),
+                                   kSuspendedBuckets.end(), seconds) -
+                  kSuspendedBuckets.begin();
+    ++suspended_histogram[bucket];
+  }
+
+  hot_chats.assign(chats.begin(), chats.end());
+  std::sort(hot_chats.begin(), hot_chats.end(),
+            [](const auto& a, const auto& b) {
+              return a.second.sessions > b.second.sessions;
+            });
+  if (hot_chats.size() > kHotChats)
+    hot_chats.resize(kHotChats);
+}
+
+std::ostream& operator<<(std::ostream& stream, const SessionReport& report) {
+  stream << "Live sessions: ";
+  writeGroup(stream, report.total);
+  stream << "\nBy origin:\n";
+  for (auto& [origin, group] : report.by_origin) {
+    stream << "  " << origin << ": ";
+    writeGroup(stream, group);
+    stream << '\n';
+  }
+  stream << "By awaitable:\n";
+  for (auto& [awaiting, group] : report.by_awaiting) {
+    stream << "  " << awaiting << ": ";
+    writeGroup(stream, group);
+    stream << '\n';
+  }
+  stream << "Suspended for:\n";
+  for (std::size_t i = 0; i < report.suspended_histogram.size(); ++i) {
+    if (i < SessionReport::kSuspendedBuckets.size())
+      stream << "  < " << SessionReport::kSuspendedBuckets[i] << "s: ";
+    else
+      stream << "  >= " << SessionReport::kSuspendedBuckets.back() << "s: ";
+    stream << report.suspended_histogram[i] << '\n';
+  }
+  stream << "Hot chats:\n";
+  for (auto& [chat, group] : report.hot_chats) {
+    stream << "  " << chat << ": ";
+    writeGroup(stream, group);
+    stream << '\n';
+  }
+  return stream;
+}
+
+void dumpSessionsOnSignal(int signum) {
+  std::signal(signum, onDumpSignal);
+}
+
+std::uint64_t sessionDumpRequests() {
+  return g_dump_requests.load(std::memory_order_relaxed);
+}
+
+}  // namespace ATgBot::Tools
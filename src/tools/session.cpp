@@ -1,5 +1,7 @@
 #include "atgbot/tools/session.hpp"
 
+#include <string_view>
+
 namespace ATgBot::Tools {
 
 void Session::execute() {
@@ -13,22 +15,150 @@ void Session::pushCoro(Coroutine&& coro) const {
 //creates shared object
 std::shared_ptr<Session> Session::create(Coroutine&& coro,
                                          QueueCallback q_callback,
-                                         CoroCallback c_callback) {
+                                         CoroCallback c_callback,
+                                         bool synchronized) {
   auto ptr = std::shared_ptr<Session>{new Session(std::move(coro))};
   ptr->coro.coro.promise().m_session = ptr.get();
   ptr->add_to_queue_callback = q_callback;
   ptr->add_new_coro_callback = c_callback;
+  ptr->synchronized = synchronized;
   return ptr;
 }
 
 Coroutine::state_type Session::getStatus() const {
-  std::lock_guard _(mutex);
+  std::unique_lock lock(mutex, std::defer_lock);
+  if (synchronized)
+    lock.lock();
   return coro.getState();
 }
 
 bool Session::tryResume() {
-  std::lock_guard _(mutex);
-  return coro.tryResume();
+  std::unique_lock lock(mutex, std::defer_lock);
+  if (synchronized)
+    lock.lock();
+  bool resumed = coro.tryResume();
+  //only a wakeup whose condition held counts as activity
+  if (resumed) {
+    suspended_at = now();
+    touch();
+  }
+  return resumed;
+}
+
+void Session::touch() {
+  last_activity = now();
+}
+
+DefaultTimer::time_point Session::lastActivity() const {
+  return last_activity;
+}
+
+void Session::setIdleTtl(DefaultTimer::duration ttl) {
+  idle_ttl = ttl;
+}
+
+DefaultTimer::duration Session::idleTtl() const {
+  return idle_ttl;
+}
+
+void Session::cancel() {
+  coro.cancel();
+}
+
+bool Session::isCancelled() const {
+  return coro.coro && coro.coro.promise().isCancelled();
+}
+
+std::size_t Session::frameSize() const {
+  return coro.frameSize();
+}
+
+std::uint64_t Session::id() const {
+  return session_id;
+}
+
+const char* Session::awaiting() const {
+  return coro.coro ? coro.coro.promise().m_awaiting.load() : nullptr;
+}
+
+FilterKeys Session::waitKeys() const {
+  std::string_view kind = awaiting() ? awaiting() : "";
+  if (kind == "getMessage")
+    return message_queue.getFilter().keys();
+  if (kind == "getCBQuery")
+    return callback_queue.getFilter().keys();
+  if (kind == "getFlatMessage")
+    return flat_message_queue.getFilter().keys();
+  return {};
+}
+
+DefaultTimer::time_point Session::suspendedSince() const {
+  return suspended_at;
+}
+
+bool Session::started() const {
+  return suspended_at.load().time_since_epoch().count() != 0;
+}
+
+std::size_t Session::queuedEvents() const {
+  return message_queue.queued() + callback_queue.queued() +
+         timer_queue.queued() + flat_message_queue.queued();
+}
+
+void Session::setOrigin(std::string origin) {
+  spawn_origin = std::move(origin);
+}
+
+const std::string& Session::origin() const {
+  return spawn_origin;
+}
+
+void Session::setPriority(Priority priority) {
+  priority_class = priority;
+}
+
+Priority Session::priority() const {
+  return priority_class;
+}
+
+void Session::setDeadline(DefaultTimer::time_point deadline) {
+  deadline_point = deadline;
+}
+
+DefaultTimer::time_point Session::deadline() const {
+  return deadline_point;
+}
+
+void Session::setAnswered() {
+  update_answered = true;
+}
+
+bool Session::answered() const {
+  return update_answered;
+}
+
+void Session::setClock(const VirtualClock* virtual_clock) {
+  clock = virtual_clock;
+}
+
+DefaultTimer::time_point Session::now() const {
+  return clock ? clock->now() : DefaultTimer::now();
+}
+
+void Session::setBot(BotId bot) {
+  bot_id = bot;
+}
+
+BotId Session::bot() const {
+  return bot_id;
+}
+
+void Session::setUpdateId(std::int64_t id) {
+  update_id.store(id, std::memory_order_relaxed);
+}
+
+std::int64_t Session::updateId() const {
+  return update_id.load(std::memory_order_relaxed);
 }
 
 }  // namespace ATgBot::Tools
@@ -0,0 +1,305 @@
+#include "atgbot/tools/sharding.hpp"
+
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include "atgbot/tools/log.hpp"
+#include "atgbot/tools/shmring.hpp"
+
+namespace ATgBot::Tools {
+
+namespace bip = boost::interprocess;
+
+namespace {
+
+constexpr std::uint64_t kMagic = 0x31445248535f4241;  // "AB_SHRD1"
+
+struct SegmentHeader {
+  std::uint64_t magic;
+  std::uint64_t shards;
+  std::uint64_t ring_bytes;
+};
+
+std::size_t ringOffset(std::size_t ring_bytes, std::size_t index) {
+  constexpr std::size_t kHeader = 64;
+  static_assert(sizeof(SegmentHeader) <= kHeader);
+  return kHeader + index * ShmRing::footprint(ring_bytes);
+}
+
+std::size_t segmentSize(std::size_t shards, std::size_t ring_bytes) {
+  return ringOffset(ring_bytes, 2 * shards);
+}
+
+//inbound rings first, then outbound rings
+void* ringAddress(bip::mapped_region& region, std::size_t ring_bytes,
+                  std::size_t index) {
+  return static_cast<unsigned char*>(region.get_address()) +
+         ringOffset(ring_bytes, index);
+}
+
+std::string encodeCall(const std::string& method, const std::string& args) {
+  std::string record = method;
+  record.push_back('\0');
+  record += args;
+  return record;
+}
+
+}  // namespace
+
+struct ShardIngest::Segment {
+  std::string name;
+  bip::shared_memory_object memory;
+  bip::mapped_region region;
+  std::vector<ShmRing> inbound;
+  std::vector<ShmRing> outbound;
+
+  ~Segment() { bip::shared_memory_object::remove(name.c_str()); }
+};
+
+ShardIngest::ShardIngest(const std::string& name, std::size_t shards,
+                         std::size_t ring_bytes) {
+  if (shards == 0)
+    throw std::invalid_argument("ShardIngest needs at least one shard");
+
+  bip::shared_memory_object::remove(name.c_str());
+  bip::shared_memory_object memory(bip::create_only, name.c_str(),
+                                   bip::read_write);
+  memory.truncate(segmentSize(shards, ring_bytes));
+  bip::mapped_region region(memory, bip::read_write);
+
+  m_segment = std::unique_ptr<Segment>(
+      new Segment{name, std::move(memory), std::move(region)});
+  for (std::size_t i = 0; i < 2 * shards; ++i) {
+    auto ring = ShmRing::create(
+        ringAddress(m_segment->region, ring_bytes, i), ring_bytes);
+    (i < shards ? m_segment->inbound : m_segment->outbound).push_back(ring);
+  }
+  // the header goes last, workers attach only to a complete segment
+  auto header = static_cast<SegmentHeader*>(m_segment->region.get_address());
+  header->shards = shards;
+  header->ring_bytes = ring_bytes;
+  std::atomic_thread_fence(std::memory_order_release);
+  header->magic = kMagic;
+}
+
+ShardIngest::~ShardIngest() {
+  stop();
+}
+
+std::int64_t ShardIngest::partitionKey(const TgBot::Update::Ptr& update) {
+  auto chat = [](const TgBot::Message::Ptr& message) -> std::int64_t {
+    return message && message->chat ? message->chat->id : 0;
+  };
+  auto user = [](const TgBot::User::Ptr& user) -> std::int64_t {
+    return user ? user->id : 0;
+  };
+
+  if (update->message)
+    return chat(update->message);
+  if (update->editedMessage)
+    return chat(update->editedMessage);
+  if (update->channelPost)
+    return chat(update->channelPost);
+  if (update->editedChannelPost)
+    return chat(update->editedChannelPost);
+  if (update->callbackQuery)
+    return update->callbackQuery->message
+               ? chat(update->callbackQuery->message)
+               : user(update->callbackQuery->from);
+  if (update->inlineQuery)
+    return user(update->inlineQuery->from);
+  if (update->chosenInlineResult)
+    return user(update->chosenInlineResult->from);
+  if (update->shippingQuery)
+    return user(update->shippingQuery->from);
+  if (update->preCheckoutQuery)
+    return user(update->preCheckoutQuery->from);
+  if (update->pollAnswer)
+    return user(update->pollAnswer->user);
+  if (update->myChatMember && update->myChatMember->chat)
+    return update->myChatMember->chat->id;
+  if (update->chatMember && update->chatMember->chat)
+    return update->chatMember->chat->id;
+  if (update->chatJoinRequest && update->chatJoinRequest->chat)
+    return update->chatJoinRequest->chat->id;
+  return 0;
+}
+
+std::size_t ShardIngest::shardOf(const TgBot::Update::Ptr& update) const {
+  return static_cast<std::uint64_t>(partitionKey(update)) % shards();
+}
+
+std::size_t ShardIngest::shards() const {
+  return m_segment->inbound.size();
+}
+
+bool ShardIngest::dispatch(const TgBot::Update::Ptr& update) {
+  auto record = TgBot::TgTypeParser().parseUpdate(update);
+  if (!m_segment->inbound[shardOf(update)].push(record))
+    return false;
+  ++m_dispatched;
+  return true;
+}
+
+void ShardIngest::setCallRate(double per_second, std::size_t burst) {
+  m_rate = per_second;
+  m_burst = static_cast<double>(burst);
+  m_tokens = std::min(m_tokens, m_burst);
+}
+
+std::size_t ShardIngest::pumpCalls(const CallHandler& handler) {
+  auto now = std::chrono::steady_clock::now();
+  std::chrono::duration<double> elapsed = now - m_refill;
+  m_refill = now;
+  m_tokens = std::min(m_burst, m_tokens + elapsed.count() * m_rate);
+
+  std::size_t executed = 0, idle = 0;
+  std::string record;
+  // round robin, so one busy worker does not starve the others
+  while (m_tokens >= 1 && idle < shards()) {
+    auto& ring = m_segment->outbound[m_next_shard];
+    m_next_shard = (m_next_shard + 1) % shards();
+    if (!ring.pop(record)) {
+      ++idle;
+      continue;
+    }
+    idle = 0;
+    m_tokens -= 1;
+    ++executed;
+    auto separator = record.find('\0');
+    try {
+      handler(record.substr(0, separator), record.substr(separator + 1));
+    } catch (const std::exception& e) {
+      //a throwing handler must not end the calls thread
+      PLOGE << "Sharded api call failed: " << e.what();
+    }
+  }
+  return executed;
+}
+
+void ShardIngest::run(TgBot::Bot& bot, const CallHandler& handler) {
+  constexpr std::int32_t kPollLimit = 100;
+  constexpr std::int32_t kPollTimeout = 10;
+
+  m_running = true;
+  std::thread calls([this, &handler]() {
+    while (m_running) {
+      if (pumpCalls(handler) == 0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  });
+
+  PLOGI << "Shard ingest started with " << shards() << " shards";
+  std::int32_t offset = 0;
+  try {
+    while (m_running) {
+      auto updates =
+          bot.getApi().getUpdates(offset, kPollLimit, kPollTimeout, nullptr);
+      for (auto& update : updates) {
+        if (update->updateId >= offset)
+          offset = update->updateId + 1;
+        if (!m_seen_updates.insert(update->updateId))
+          continue;
+        //the next getUpdates confirms the update to Telegram, so the poll
+        //waits until its worker made room in the ring
+        if (dispatch(update))
+          continue;
+        PLOGW << "Shard " << shardOf(update) << " is full, waiting";
+        ++m_stalled;
+        while (m_running && !dispatch(update))
+          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        if (!m_running)
+          break;
+      }
+    }
+  } catch (TgBot::TgException& e) {
+    PLOGE << e.what();
+    m_running = false;
+    calls.join();
+    throw;
+  }
+  calls.join();
+  PLOGI << "Shard ingest stopped";
+}
+
+void ShardIngest::stop() {
+  m_running = false;
+}
+
+struct ShardWorker::Segment {
+  bip::shared_memory_object memory;
+  bip::mapped_region region;
+  ShmRing inbound;
+  ShmRing outbound;
+};
+
+ShardWorker::ShardWorker(const std::string& name, std::size_t shard)
+    : m_shard(shard) {
+  bip::shared_memory_object memory(bip::open_only, name.c_str(),
+                                   bip::read_write);
+  bip::mapped_region region(memory, bip::read_write);
+
+  auto header = static_cast<const SegmentHeader*>(region.get_address());
+  if (header->magic != kMagic)
+    throw std::runtime_error("Shard segment " + name + " is not ready");
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (shard >= header->shards)
+    throw std::out_of_range("Shard " + std::to_string(shard) +
+                            " does not exist");
+
+  ShmRing inbound(ringAddress(region, header->ring_bytes, shard));
+  ShmRing outbound(
+      ringAddress(region, header->ring_bytes, header->shards + shard));
+  m_segment = std::unique_ptr<Segment>(
+      new Segment{std::move(memory), std::move(region), inbound, outbound});
+}
+
+ShardWorker::~ShardWorker() = default;
+
+std::vector<TgBot::Update::Ptr> ShardWorker::poll(std::size_t max) {
+  auto& ring = m_segment->inbound;
+  //a fresh worker or one whose polled updates are all acknowledged
+  if (m_polled.empty())
+    m_cursor = ring.readPosition();
+
+  std::vector<TgBot::Update::Ptr> updates;
+  std::string record;
+  while (updates.size() < max && ring.peek(m_cursor, record)) {
+    boost::property_tree::ptree tree;
+    std::istringstream stream(record);
+    try {
+      boost::property_tree::read_json(stream, tree);
+    } catch (boost::property_tree::json_parser_error& e) {
+      PLOGE << "Shard " << m_shard << " got a broken update: " << e.what();
+      if (m_polled.empty())
+        ring.release(m_cursor);
+      continue;
+    }
+    updates.push_back(TgBot::TgTypeParser().parseJsonAndGetUpdate(tree));
+    m_polled.push_back(m_cursor);
+  }
+  return updates;
+}
+
+void ShardWorker::acknowledge(std::size_t count) {
+  if (count == 0 || m_polled.empty())
+    return;
+  if (count >= m_polled.size()) {
+    //also releases broken records after the last update
+    m_segment->inbound.release(m_cursor);
+    m_polled.clear();
+    return;
+  }
+  m_segment->inbound.release(m_polled[count - 1]);
+  m_polled.erase(m_polled.begin(), m_polled.begin() + count);
+}
+
+bool ShardWorker::call(const std::string& method, const std::string& args) {
+  return m_segment->outbound.push(encodeCall(method, args));
+}
+
+}  // namespace ATgBot::Tools
@@ -0,0 +1,194 @@
+#include "atgbot/tools/trace.hpp"
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace ATgBot::Tools {
+
+namespace {
+
+struct Event {
+  const char* name;
+  std::uint64_t timestamp;  // ns
+  std::uint64_t duration;   // ns, complete events only
+  std::uint64_t session;
+  std::int64_t update;
+  char phase;
+};
+
+//written by its thread only, read by the exporter after stop()
+struct Buffer {
+  std::vector<Event> events;
+  std::atomic<std::size_t> size{0};
+  std::uint64_t generation = 0;
+  std::uint32_t thread = 0;
+};
+
+std::mutex g_registry_mutex;
+std::vector<std::shared_ptr<Buffer>> g_buffers;
+// buffers of exited threads
+std::vector<std::shared_ptr<Buffer>> g_free;
+std::atomic<std::uint64_t> g_generation{0};
+std::atomic<std::size_t> g_capacity{Trace::kDefaultCapacity};
+std::atomic<std::size_t> g_dropped{0};
+const auto g_epoch = std::chrono::steady_clock::now();
+
+//gives the buffer back when the thread exits
+struct BufferHolder {
+  std::shared_ptr<Buffer> buffer;
+
+  ~BufferHolder() {
+    if (!buffer)
+      return;
+    std::lock_guard _(g_registry_mutex);
+    g_free.push_back(std::move(buffer));
+  }
+};
+
+thread_local BufferHolder t_buffer;
+thread_local std::int64_t t_update = 0;
+
+Buffer& threadBuffer() {
+  auto& buffer = t_buffer.buffer;
+  if (!buffer) {
+    std::lock_guard _(g_registry_mutex);
+    if (!g_free.empty()) {
+      buffer = std::move(g_free.back());
+      g_free.pop_back();
+    } else {
+      buffer = std::make_shared<Buffer>();
+      buffer->thread = static_cast<std::uint32_t>(g_buffers.size() + 1);
+      g_buffers.push_back(buffer);
+    }
+  }
+  // a new trace was started since this thread recorded last
+  auto generation = g_generation.load(std::memory_order_acquire);
+  if (buffer->generation != generation) {
+    buffer->generation = generation;
+    buffer->events.resize(g_capacity);
+    buffer->size.store(0, std::memory_order_relaxed);
+  }
+  return *buffer;
+}
+
+void record(const Event& event) {
+  Buffer& buffer = threadBuffer();
+  auto size = buffer.size.load(std::memory_order_relaxed);
+  if (size == buffer.events.size()) {
+    g_dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  buffer.events[size] = event;
+  buffer.size.store(size + 1, std::memory_order_release);
+}
+
+void writeEvent(std::ostream& stream, const Event& event,
+                std::uint32_t thread) {
+  stream << "{\"name\":\"" << event.name << "\",\"ph\":\"" << event.phase
+         << "\",\"pid\":1,\"tid\":" << thread
+         << ",\"ts\":" << event.timestamp / 1000.0;
+  if (event.phase == 'X')
+    stream << ",\"dur\":" << event.duration / 1000.0;
+  if (event.phase == 'b' || event.phase == 'e')
+    stream << ",\"cat\":\"session\",\"id\":" << event.session;
+  if (event.phase == 'i')
+    stream << ",\"s\":\"t\"";
+  stream << ",\"args\":{\"session\":" << event.session
+         << ",\"update\":" << event.update << "}}";
+}
+
+}  // namespace
+
+void Trace::start(std::size_t events_per_thread) {
+  g_capacity = events_per_thread;
+  g_dropped = 0;
+  g_generation.fetch_add(1, std::memory_order_release);
+  s_enabled = true;
+}
+
+void Trace::stop() {
+  s_enabled = false;
+}
+
+std::size_t Trace::droppedCount() {
+  return g_dropped;
+}
+
+std::size_t Trace::bufferCount() {
+  std::lock_guard _(g_registry_mutex);
+  return g_buffers.size();
+}
+
+void Trace::writeChromeJson(std::ostream& stream) {
+  std::lock_guard _(g_registry_mutex);
+  auto generation = g_generation.load(std::memory_order_acquire);
+  stream << "{\"traceEvents\":[";
+  bool first = true;
+  for (auto& buffer : g_buffers) {
+    if (buffer->generation != generation)
+      continue;
+    auto size = buffer->size.load(std::memory_order_acquire);
+    for (std::size_t i = 0; i < size; ++i) {
+      if (!first)
+        stream << ",\n";
+      first = false;
+      writeEvent(stream, buffer->events[i], buffer->thread);
+    }
+  }
+  stream << "],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+std::uint64_t Trace::now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - g_epoch)
+      .count();
+}
+
+void Trace::instant(const char* name, std::uint64_t session) {
+  if (enabled())
+    record({name, now(), 0, session, t_update, 'i'});
+}
+
+void Trace::asyncBegin(const char* name, std::uint64_t session) {
+  if (enabled())
+    record({name, now(), 0, session, t_update, 'b'});
+}
+
+void Trace::asyncEnd(const char* name, std::uint64_t session) {
+  if (enabled())
+    record({name, now(), 0, session, t_update, 'e'});
+}
+
+void Trace::complete(const char* name, std::uint64_t begin,
+                     std::uint64_t session) {
+  record({name, begin, now() - begin, session, t_update, 'X'});
+}
+
+std::int64_t Trace::currentUpdate() {
+  return t_update;
+}
+
+Trace::UpdateTag::UpdateTag(std::int64_t update_id) : m_previous(t_update) {
+  t_update = update_id;
+}
+
+Trace::UpdateTag::~UpdateTag() {
+  t_update = m_previous;
+}
+
+Trace::UpdateScope::UpdateScope(std::int64_t update_id)
+    : m_previous(t_update), m_recorded(enabled()) {
+  t_update = update_id;
+  if (m_recorded)
+    m_begin = now();
+}
+
+Trace::UpdateScope::~UpdateScope() {
+  if (m_recorded)
+    complete("update", m_begin, 0);
+  t_update = m_previous;
+}
+
+}  // namespace ATgBot::Tools
@@ -0,0 +1,74 @@
+#include "atgbot/tools/updatecheckpoint.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+namespace ATgBot::Tools {
+
+namespace {
+
+constexpr std::uint64_t kMagic = 0x32504b4354474241;  // "ABGTCKP2"
+
+}  // namespace
+
+struct UpdateCheckpoint::Data {
+  std::uint64_t magic;
+  std::int64_t offset;
+  std::int64_t window_base;
+  UpdateIdWindow::Words window;
+
+  bool operator==(const Data&) const = default;
+};
+
+UpdateCheckpoint::UpdateCheckpoint(const std::string& path)
+    : m_path(path),
+      m_data(new Data{.magic = kMagic, .offset = 0, .window_base = 0}) {
+  m_data->window.fill(0);
+
+  // a missing or foreign file starts from scratch
+  Data data;
+  std::ifstream file(path, std::ios::binary);
+  if (file.read(reinterpret_cast<char*>(&data), sizeof(data)) &&
+      data.magic == kMagic)
+    *m_data = data;
+}
+
+UpdateCheckpoint::~UpdateCheckpoint() = default;
+
+std::int32_t UpdateCheckpoint::offset() const {
+  return static_cast<std::int32_t>(m_data->offset);
+}
+
+UpdateIdWindow UpdateCheckpoint::window() const {
+  return UpdateIdWindow(m_data->window_base, m_data->window);
+}
+
+void UpdateCheckpoint::commit(std::int32_t offset,
+                              const UpdateIdWindow& window) {
+  Data data{.magic = kMagic,
+            .offset = std::max<std::int64_t>(m_data->offset, offset),
+            .window_base = window.base(),
+            .window = window.words()};
+  if (data == *m_data)
+    return;
+
+  auto temporary = m_path + ".tmp";
+  int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    throw std::runtime_error("cannot open " + temporary);
+  bool written = ::write(fd, &data, sizeof(data)) ==
+                     static_cast<ssize_t>(sizeof(data)) &&
+                 ::fsync(fd) == 0;
+  ::close(fd);
+  if (!written)
+    throw std::runtime_error("cannot write " + temporary);
+  std::filesystem::rename(temporary, m_path);
+  *m_data = data;
+}
+
+}  // namespace ATgBot::Tools
@@ -0,0 +1,69 @@
+#include <boost/test/unit_test.hpp>
+
+#include <atgbot/awaitables/bus.hpp>
+#include <atgbot/tools/scheduler.hpp>
+#include <string>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(BusTests)
+
+using namespace ATgBot::Awaitables;
+using namespace ATgBot::Tools;
+
+namespace {
+
+using Events = std::vector<std::shared_ptr<const std::string>>;
+
+ATgBot::Coroutine Listener(Bus<std::string>& bus, std::string topic,
+                           Events& events, int count) {
+  auto subscription = bus.subscribe(std::move(topic));
+  for (int i = 0; i < count; ++i)
+    events.push_back(co_await subscription.next());
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(FansOutToTopicSubscribers) {
+  Events lobby_a;
+  Events lobby_b;
+  Events other;
+  Bus<std::string> bus;
+  BasicScheduler<Simulated> scheduler;
+
+  scheduler.pushCoro(Listener(bus, "lobby", lobby_a, 2));
+  scheduler.pushCoro(Listener(bus, "lobby", lobby_b, 2));
+  scheduler.pushCoro(Listener(bus, "admin", other, 1));
+  scheduler.runPending();
+  BOOST_CHECK_EQUAL(bus.subscribers("lobby"), 2);
+
+  BOOST_CHECK_EQUAL(bus.publish("lobby", std::string("start")), 2);
+  BOOST_CHECK_EQUAL(bus.publish("nobody", std::string("lost")), 0);
+  scheduler.runPending();
+  BOOST_REQUIRE_EQUAL(lobby_a.size(), 1);
+  BOOST_REQUIRE_EQUAL(lobby_b.size(), 1);
+  BOOST_CHECK(lobby_a[0] == lobby_b[0]);
+  BOOST_CHECK_EQUAL(*lobby_a[0], "start");
+  BOOST_CHECK(other.empty());
+
+  bus.publish("lobby", std::string("end"));
+  scheduler.runPending();
+  BOOST_CHECK_EQUAL(*lobby_b.back(), "end");
+  BOOST_CHECK_EQUAL(bus.subscribers("lobby"), 0);
+  BOOST_CHECK_EQUAL(scheduler.sessionCount(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(BuffersUpToTheLimit) {
+  Bus<int> bus;
+  auto subscription =
+      bus.subscribe("ticks", {.max_events = 2,
+                              .policy = OverflowPolicy::kDropOldest});
+  for (int i = 0; i < 5; ++i)
+    bus.publish("ticks", i);
+
+  BOOST_CHECK_EQUAL(*subscription.tryNext().value(), 3);
+  BOOST_CHECK_EQUAL(*subscription.tryNext().value(), 4);
+  BOOST_CHECK(!subscription.tryNext());
+  BOOST_CHECK_EQUAL(subscription.droppedCount(), 3);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
@@ -0,0 +1,101 @@
+#include <boost/test/unit_test.hpp>
+
+#include <atgbot/awaitables/channel.hpp>
+#include <atgbot/awaitables/timer.hpp>
+#include <atgbot/tools/scheduler.hpp>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(ChannelTests)
+
+using namespace ATgBot::Awaitables;
+using namespace ATgBot::Tools;
+
+namespace {
+
+ATgBot::Coroutine Producer(Channel<std::unique_ptr<int>>& channel,
+                           std::vector<int>& sent, int count) {
+  for (int i = 0; i < count; ++i) {
+    if (!co_await channel.send(std::make_unique<int>(i)))
+      co_return;
+    sent.push_back(i);
+  }
+  channel.close();
+}
+
+ATgBot::Coroutine Consumer(Channel<std::unique_ptr<int>>& channel,
+                           std::vector<int>& received) {
+  while (auto value = co_await channel.receive()) {
+    received.push_back(**value);
+    co_await waitFor(std::chrono::seconds(1));
+  }
+}
+
+ATgBot::Coroutine ReceiveOne(Channel<int>& channel, std::vector<int>& log,
+                             int id) {
+  auto value = co_await channel.receive();
+  log.push_back(id * 10 + value.value_or(-1));
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(SenderWaitsForSpace) {
+  std::vector<int> sent;
+  std::vector<int> received;
+  Channel<std::unique_ptr<int>> channel(2);
+  BasicScheduler<Simulated> scheduler;
+
+  scheduler.pushCoro(Producer(channel, sent, 5));
+  scheduler.runPending();
+  BOOST_CHECK((sent == std::vector<int>{0, 1}));
+  BOOST_CHECK_EQUAL(channel.size(), 2);
+
+  scheduler.pushCoro(Consumer(channel, received));
+  scheduler.runPending();
+  BOOST_CHECK((received == std::vector<int>{0}));
+  BOOST_CHECK((sent == std::vector<int>{0, 1, 2}));
+
+  scheduler.advance(std::chrono::minutes(1));
+  BOOST_CHECK((received == std::vector<int>{0, 1, 2, 3, 4}));
+  BOOST_CHECK(channel.closed());
+  BOOST_CHECK_EQUAL(scheduler.sessionCount(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(ReceiversAreServedInOrder) {
+  std::vector<int> log;
+  Channel<int> channel(1);
+  BasicScheduler<Simulated> scheduler;
+
+  for (int id : {1, 2, 3})
+    scheduler.pushCoro(ReceiveOne(channel, log, id));
+  scheduler.runPending();
+  BOOST_CHECK(channel.trySend(7));
+  BOOST_CHECK(channel.trySend(8));
+  scheduler.runPending();
+  BOOST_CHECK((log == std::vector<int>{17, 28}));
+  BOOST_CHECK_EQUAL(channel.size(), 0);
+
+  channel.close();
+  scheduler.runPending();
+  BOOST_CHECK((log == std::vector<int>{17, 28, 29}));
+  BOOST_CHECK(!channel.trySend(9));
+}
+
+BOOST_AUTO_TEST_CASE(CancelledReceiverPassesValueOn) {
+  std::vector<int> log;
+  Channel<int> channel(1);
+  BasicScheduler<Simulated> scheduler;
+
+  auto first = scheduler.spawn(ReceiveOne(channel, log, 1));
+  scheduler.pushCoro(ReceiveOne(channel, log, 2));
+  scheduler.runPending();
+  BOOST_CHECK(channel.trySend(5));
+  scheduler.discard(first);
+  scheduler.runPending();
+
+  BOOST_CHECK((log == std::vector<int>{25}));
+  BOOST_CHECK_EQUAL(channel.size(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
@@ -0,0 +1,172 @@
+#include <boost/test/unit_test.hpp>
+
+#include <atgbot/awaitables/download.hpp>
+#include <atgbot/tools/session.hpp>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+BOOST_AUTO_TEST_SUITE(DownloadAwaitableTests)
+
+using namespace ATgBot::Awaitables;
+using namespace ATgBot::Tools;
+
+namespace {
+
+//serves "abc" repeated `chunks` times and tracks parallel fetches
+struct FakeFetch {
+  std::size_t chunks = 3;
+  std::atomic<int>* active = nullptr;
+  std::atomic<int>* peak = nullptr;
+  std::string* url = nullptr;
+
+  void operator()(const std::string& host, const std::string& target,
+                  const Downloader::ChunkSink& sink,
+                  const std::atomic<bool>& abort) const {
+    if (url)
+      *url = host + target;
+    if (active) {
+      int now = ++*active;
+      int seen = peak->load();
+      while (now > seen && !peak->compare_exchange_weak(seen, now)) {}
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    for (std::size_t i = 0; i < chunks && !abort; ++i)
+      sink("abc");
+    if (active)
+      --*active;
+  }
+};
+
+//stands in for getFile, no request leaves the test
+std::string FakePath(const TgBot::Bot&, const std::string& file_id) {
+  return "documents/" + file_id + ".txt";
+}
+
+ATgBot::Coroutine CoroToSink(const TgBot::Bot& bot, Downloader& downloader,
+                             std::string& data, std::size_t& bytes) {
+  bytes = co_await downloadTo(
+      bot, "file",
+      [&data](std::string_view chunk) { data.append(chunk); }, downloader);
+  co_return;
+}
+
+ATgBot::Coroutine CoroToFile(const TgBot::Bot& bot, Downloader& downloader,
+                             std::filesystem::path path, bool& failed) {
+  try {
+    co_await downloadTo(bot, "file", path, downloader);
+  } catch (std::runtime_error&) {
+    failed = true;
+  }
+  co_return;
+}
+
+void runToEnd(std::shared_ptr<Session> session) {
+  while (session->getStatus() != ATgBot::Coroutine::state_type::kDone)
+    session->tryResume();
+}
+
+std::shared_ptr<Session> makeSession(ATgBot::Coroutine&& coro) {
+  return Session::create(
+      std::move(coro), [](auto) {}, [](auto) {});
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(StreamsChunksToSink) {
+  TgBot::Bot bot("token");
+  std::string url;
+  Downloader downloader(1, FakeFetch{.url = &url}, FakePath);
+  std::string data;
+  std::size_t bytes = 0;
+
+  runToEnd(makeSession(CoroToSink(bot, downloader, data, bytes)));
+
+  BOOST_CHECK_EQUAL(data, "abcabcabc");
+  BOOST_CHECK_EQUAL(bytes, 9u);
+  BOOST_CHECK_EQUAL(url, "api.telegram.org/file/bot" + bot.getToken() +
+                             "/documents/file.txt");
+}
+
+BOOST_AUTO_TEST_CASE(WritesFileAndRemovesItOnError) {
+  TgBot::Bot bot("token");
+  auto path = std::filesystem::temp_directory_path() / "atgbot_download";
+  bool failed = false;
+
+  Downloader downloader(1, FakeFetch{2}, FakePath);
+  //the session still holds the stream, the file must be complete anyway
+  auto session = makeSession(CoroToFile(bot, downloader, path, failed));
+  runToEnd(session);
+  BOOST_CHECK(!failed);
+  std::ifstream file(path, std::ios::binary);
+  std::string content((std::istreambuf_iterator<char>(file)), {});
+  BOOST_CHECK_EQUAL(content, "abcabc");
+  file.close();
+
+  Downloader broken(
+      1, [](auto&&...) { throw std::runtime_error("reset"); }, FakePath);
+  runToEnd(makeSession(CoroToFile(bot, broken, path, failed)));
+  BOOST_CHECK(failed);
+  BOOST_CHECK(!std::filesystem::exists(path));
+}
+
+BOOST_AUTO_TEST_CASE(LimitsConcurrentDownloads) {
+  TgBot::Bot bot("token");
+  std::atomic<int> active = 0, peak = 0;
+  Downloader downloader(2, FakeFetch{1, &active, &peak}, FakePath);
+
+  std::atomic<int> finished = 0;
+  for (int i = 0; i < 6; ++i)
+    downloader.submit({.bot = &bot,
+                       .file_id = "file",
+                       .sink = [](std::string_view) {},
+                       .abort = std::make_shared<std::atomic<bool>>(false),
+                       .done = [&finished](auto) { ++finished; }});
+  while (finished != 6)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+  BOOST_CHECK_EQUAL(peak.load(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(RemovesFileOfCancelledDownload) {
+  TgBot::Bot bot("token");
+  auto path = std::filesystem::temp_directory_path() / "atgbot_cancelled";
+  bool failed = false;
+  //writes one chunk and hangs until the download is aborted
+  Downloader downloader(
+      1,
+      [](auto&&, auto&&, const Downloader::ChunkSink& sink,
+         const std::atomic<bool>& abort) {
+        sink("abc");
+        while (!abort)
+          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      },
+      FakePath);
+
+  auto session = makeSession(CoroToFile(bot, downloader, path, failed));
+  session->tryResume();
+  session->cancel();
+  runToEnd(session);
+  BOOST_CHECK(failed);
+  BOOST_CHECK(!std::filesystem::exists(path));
+}
+
+BOOST_AUTO_TEST_CASE(StoppedDownloaderFailsQueuedJobs) {
+  TgBot::Bot bot("token");
+  std::exception_ptr error;
+  {
+    Downloader downloader(0, FakeFetch{}, FakePath);
+    downloader.submit({.bot = &bot,
+                       .file_id = "file",
+                       .sink = [](std::string_view) {},
+                       .abort = std::make_shared<std::atomic<bool>>(false),
+                       .done = [&error](auto e) { error = e; }});
+  }
+  BOOST_CHECK(error);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
@@ -0,0 +1,86 @@
+#include <boost/test/unit_test.hpp>
+
+#include <atgbot/awaitables/fileidcache.hpp>
+#include <atgbot/tools/session.hpp>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+BOOST_AUTO_TEST_SUITE(SendCachedTests)
+
+using namespace ATgBot::Awaitables;
+using namespace ATgBot::Tools;
+
+namespace {
+
+//answers with a document, uploads wait until `release` is set
+struct FakeSend {
+  std::atomic<bool> release = true;
+  std::atomic<bool> uploading = false;
+  std::atomic<int> uploads = 0;
+  std::atomic<int> by_id = 0;
+
+  FileIdCache::Send callback() {
+    return [this](const FileIdCache::Media& media) {
+      auto message = std::make_shared<TgBot::Message>();
+      message->document = std::make_shared<TgBot::Document>();
+      if (auto id = boost::get<std::string>(&media)) {
+        ++by_id;
+        message->document->fileId = *id;
+        return message;
+      }
+      uploading = true;
+      while (!release)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      message->document->fileId = "id" + std::to_string(++uploads);
+      return message;
+    };
+  }
+};
+
+ATgBot::Coroutine CoroSends(FileIdCache& cache, std::filesystem::path path,
+                            FakeSend& send, std::string& file_id) {
+  auto message = co_await sendCached(cache, path, "", send.callback());
+  file_id = message->document->fileId;
+  co_return;
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(SuspendsWhileTheContentIsUploaded) {
+  auto dir = std::filesystem::temp_directory_path() / "atgbot_sendcached";
+  std::filesystem::remove_all(dir);
+  std::filesystem::create_directories(dir);
+  auto path = dir / "a.bin";
+  std::ofstream(path, std::ios::binary) << "content";
+
+  {
+    FileIdCache cache(dir / "cache");
+    FakeSend send;
+    send.release = false;
+    std::thread uploader([&]() { cache.send(path, "", send.callback()); });
+    while (!send.uploading)
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    std::atomic<int> woken = 0;
+    std::string file_id;
+    auto session = Session::create(
+        CoroSends(cache, path, send, file_id), [&woken](auto) { ++woken; },
+        [](auto) {});
+    BOOST_CHECK(session->tryResume());
+    BOOST_CHECK(session->getStatus() ==
+                ATgBot::Coroutine::state_type::kWait);
+
+    send.release = true;
+    uploader.join();
+    BOOST_CHECK_EQUAL(woken, 1);
+    BOOST_CHECK(session->tryResume());
+    BOOST_CHECK_EQUAL(file_id, "id1");
+    BOOST_CHECK_EQUAL(send.uploads, 1);
+    BOOST_CHECK_EQUAL(send.by_id, 1);
+  }
+  std::filesystem::remove_all(dir);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
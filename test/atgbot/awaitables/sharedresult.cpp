@@ -0,0 +1,63 @@
+#include <boost/test/unit_test.hpp>
+
+#include <atgbot/awaitables/sharedresult.hpp>
+#include <atgbot/tools/session.hpp>
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+
+BOOST_AUTO_TEST_SUITE(SharedResultTests)
+
+using namespace ATgBot::Awaitables;
+using namespace ATgBot::Tools;
+
+namespace {
+
+ATgBot::Coroutine CoroWaits(std::shared_ptr<SharedResult<int>> result,
+                            int& value, bool& failed) {
+  try {
+    value = co_await awaitResult(result);
+  } catch (std::runtime_error&) {
+    failed = true;
+  }
+  co_return;
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(SuspendsUntilTheResultIsSet) {
+  auto result = std::make_shared<SharedResult<int>>();
+  std::atomic<int> woken = 0;
+  int value = 0;
+  bool failed = false;
+  auto session = Session::create(
+      CoroWaits(result, value, failed), [&woken](auto) { ++woken; },
+      [](auto) {});
+
+  BOOST_CHECK(session->tryResume());
+  BOOST_CHECK(session->getStatus() == ATgBot::Coroutine::state_type::kWait);
+  BOOST_CHECK(!session->tryResume());
+
+  std::thread([result]() { result->setValue(7); }).join();
+  BOOST_CHECK_EQUAL(woken, 1);
+  BOOST_CHECK(session->tryResume());
+  BOOST_CHECK(session->getStatus() == ATgBot::Coroutine::state_type::kDone);
+  BOOST_CHECK_EQUAL(value, 7);
+  BOOST_CHECK(!failed);
+}
+
+BOOST_AUTO_TEST_CASE(ReadyResultsDoNotSuspend) {
+  auto result = std::make_shared<SharedResult<int>>();
+  result->setException(std::make_exception_ptr(std::runtime_error("")));
+  int value = 0;
+  bool failed = false;
+  auto session = Session::create(
+      CoroWaits(result, value, failed), [](auto) {}, [](auto) {});
+
+  BOOST_CHECK(session->tryResume());
+  BOOST_CHECK(session->getStatus() == ATgBot::Coroutine::state_type::kDone);
+  BOOST_CHECK(failed);
+  BOOST_CHECK_THROW(result->wait(), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
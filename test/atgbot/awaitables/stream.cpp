@@ -0,0 +1,98 @@
+#include <boost/test/unit_test.hpp>
+
+#include <atgbot/awaitables/stream.hpp>
+#include <atgbot/awaitables/timer.hpp>
+#include <atgbot/tools/scheduler.hpp>
+#include <chrono>
+#include <string>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(EventStreamTests)
+
+using namespace ATgBot::Awaitables;
+using namespace ATgBot::Tools;
+
+namespace {
+
+TgBot::Message::Ptr makeMessage(std::int64_t user, std::string text) {
+  auto message = std::make_shared<TgBot::Message>();
+  message->text = std::move(text);
+  message->from = std::make_shared<TgBot::User>();
+  message->from->id = user;
+  message->chat = std::make_shared<TgBot::Chat>();
+  message->chat->id = user;
+  return message;
+}
+
+ATgBot::Coroutine SlowReader(std::vector<std::string>& texts, int count,
+                             QueueLimit limit) {
+  auto stream = messages(ATgBot::Filters::from(1), limit);
+  for (int i = 0; i < count; ++i) {
+    auto message = co_await stream.next();
+    texts.push_back(message->text);
+    co_await waitFor(std::chrono::seconds(10));
+  }
+}
+
+ATgBot::Coroutine ReadOnce(std::vector<std::string>& texts) {
+  {
+    auto stream = messages(ATgBot::Filters::from(1));
+    texts.push_back((co_await stream.next())->text);
+  }
+  co_await waitFor(std::chrono::minutes(1));
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(BuffersEventsBetweenIterations) {
+  std::vector<std::string> texts;
+  BasicScheduler<Simulated> scheduler;
+
+  scheduler.pushCoro(SlowReader(texts, 3, kDefaultStreamLimit));
+  scheduler.runPending();
+  scheduler.handleMessage(makeMessage(1, "a"));
+  scheduler.runPending();
+  scheduler.handleMessage(makeMessage(2, "other"));
+  scheduler.handleMessage(makeMessage(1, "b"));
+  scheduler.handleMessage(makeMessage(1, "c"));
+  scheduler.runPending();
+  BOOST_CHECK((texts == std::vector<std::string>{"a"}));
+
+  scheduler.advance(std::chrono::minutes(1));
+  BOOST_CHECK((texts == std::vector<std::string>{"a", "b", "c"}));
+  BOOST_CHECK_EQUAL(scheduler.sessionCount(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(DropsOldestOverTheLimit) {
+  std::vector<std::string> texts;
+  BasicScheduler<Simulated> scheduler;
+
+  scheduler.pushCoro(SlowReader(
+      texts, 2, {.max_events = 2, .policy = OverflowPolicy::kDropOldest}));
+  scheduler.runPending();
+  for (auto text : {"1", "2", "3", "4", "5"})
+    scheduler.handleMessage(makeMessage(1, text));
+  scheduler.advance(std::chrono::minutes(1));
+
+  BOOST_CHECK((texts == std::vector<std::string>{"4", "5"}));
+  BOOST_CHECK_EQUAL(scheduler.loadStats().dropped_events, 3);
+}
+
+BOOST_AUTO_TEST_CASE(UnsubscribesOnDestruction) {
+  std::vector<std::string> texts;
+  BasicScheduler<Simulated> scheduler;
+
+  auto session = scheduler.spawn(ReadOnce(texts));
+  scheduler.runPending();
+  BOOST_CHECK(session->message_queue.getFilter().m_enabled);
+  scheduler.handleMessage(makeMessage(1, "a"));
+  scheduler.runPending();
+
+  BOOST_CHECK((texts == std::vector<std::string>{"a"}));
+  BOOST_CHECK(!session->message_queue.getFilter().m_enabled);
+  BOOST_CHECK(session->message_queue.limit().max_events == 0);
+  scheduler.advance(std::chrono::minutes(2));
+  BOOST_CHECK_EQUAL(scheduler.sessionCount(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
@@ -0,0 +1,114 @@
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <atgbot/awaitables/sync.hpp>
+#include <atgbot/awaitables/timer.hpp>
+#include <atgbot/tools/scheduler.hpp>
+#include <chrono>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(SyncTests)
+
+using namespace ATgBot::Awaitables;
+using namespace ATgBot::Tools;
+
+namespace {
+
+ATgBot::Coroutine Locker(AsyncMutex& mutex, std::vector<int>& log, int id) {
+  auto guard = co_await mutex.scopedLock();
+  log.push_back(id);
+  co_await waitFor(std::chrono::seconds(10));
+  log.push_back(-id);
+}
+
+ATgBot::Coroutine Worker(AsyncSemaphore& semaphore, int& active, int& peak) {
+  co_await semaphore.acquire();
+  peak = std::max(peak, ++active);
+  co_await waitFor(std::chrono::seconds(10));
+  --active;
+  semaphore.release();
+}
+
+ATgBot::Coroutine Waiter(AsyncLatch& latch, int& passed) {
+  co_await latch.wait();
+  ++passed;
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(MutexHandsOffInOrder) {
+  std::vector<int> log;
+  AsyncMutex mutex;
+  BasicScheduler<Simulated> scheduler;
+
+  for (int id : {1, 2, 3})
+    scheduler.pushCoro(Locker(mutex, log, id));
+  scheduler.runPending();
+  BOOST_CHECK((log == std::vector<int>{1}));
+  BOOST_CHECK(mutex.locked());
+  BOOST_CHECK(!mutex.tryLock());
+
+  scheduler.advance(std::chrono::minutes(1));
+  BOOST_CHECK((log == std::vector<int>{1, -1, 2, -2, 3, -3}));
+  BOOST_CHECK(!mutex.locked());
+  BOOST_CHECK_EQUAL(scheduler.sessionCount(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(SemaphoreCapsConcurrency) {
+  int active = 0;
+  int peak = 0;
+  AsyncSemaphore semaphore(2);
+  BasicScheduler<Simulated> scheduler;
+
+  for (int i = 0; i < 5; ++i)
+    scheduler.pushCoro(Worker(semaphore, active, peak));
+  scheduler.runPending();
+  BOOST_CHECK_EQUAL(active, 2);
+  BOOST_CHECK_EQUAL(semaphore.waiting(), 3);
+
+  scheduler.advance(std::chrono::minutes(1));
+  BOOST_CHECK_EQUAL(peak, 2);
+  BOOST_CHECK_EQUAL(active, 0);
+  BOOST_CHECK_EQUAL(semaphore.available(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(LatchReleasesAllWaiters) {
+  int passed = 0;
+  AsyncLatch latch(2);
+  BasicScheduler<Simulated> scheduler;
+
+  for (int i = 0; i < 3; ++i)
+    scheduler.pushCoro(Waiter(latch, passed));
+  scheduler.runPending();
+  latch.countDown();
+  scheduler.runPending();
+  BOOST_CHECK_EQUAL(passed, 0);
+
+  latch.countDown();
+  scheduler.runPending();
+  BOOST_CHECK_EQUAL(passed, 3);
+  BOOST_CHECK(latch.ready());
+
+  scheduler.pushCoro(Waiter(latch, passed));
+  scheduler.runPending();
+  BOOST_CHECK_EQUAL(passed, 4);
+}
+
+BOOST_AUTO_TEST_CASE(CancelledWaiterLeavesQueue) {
+  std::vector<int> log;
+  AsyncMutex mutex;
+  BasicScheduler<Simulated> scheduler;
+
+  scheduler.pushCoro(Locker(mutex, log, 1));
+  auto cancelled = scheduler.spawn(Locker(mutex, log, 2));
+  scheduler.pushCoro(Locker(mutex, log, 3));
+  scheduler.runPending();
+
+  scheduler.discard(cancelled);
+  scheduler.runPending();
+  scheduler.advance(std::chrono::minutes(1));
+  BOOST_CHECK((log == std::vector<int>{1, -1, 3, -3}));
+  BOOST_CHECK(!mutex.locked());
+}
+
+BOOST_AUTO_TEST_SUITE_END();
@@ -0,0 +1,119 @@
+#include <boost/test/unit_test.hpp>
+
+#include <atgbot/tools/apicache.hpp>
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(ApiCacheTests)
+
+using namespace ATgBot::Tools;
+
+BOOST_AUTO_TEST_CASE(CoalescesConcurrentMisses) {
+  SingleflightCache<int, int> cache;
+  std::atomic<int> loads = 0;
+  auto load = [&loads]() {
+    ++loads;
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    return 42;
+  };
+
+  std::vector<std::thread> threads;
+  std::atomic<int> sum = 0;
+  for (int i = 0; i < 8; ++i)
+    threads.emplace_back([&]() {
+      sum += cache.get(1, std::chrono::minutes(1), load);
+    });
+  for (auto& thread : threads)
+    thread.join();
+
+  BOOST_CHECK_EQUAL(loads, 1);
+  BOOST_CHECK_EQUAL(sum, 8 * 42);
+  BOOST_CHECK_EQUAL(cache.missCount(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(ExpiresAndDoesNotCacheErrors) {
+  SingleflightCache<int, int> cache;
+  int loads = 0;
+  auto load = [&loads]() { return ++loads; };
+
+  BOOST_CHECK_EQUAL(cache.get(1, std::chrono::hours(1), load), 1);
+  BOOST_CHECK_EQUAL(cache.get(1, std::chrono::hours(1), load), 1);
+  BOOST_CHECK_EQUAL(cache.get(2, std::chrono::milliseconds(0), load), 2);
+  BOOST_CHECK_EQUAL(cache.get(2, std::chrono::milliseconds(0), load), 3);
+
+  BOOST_CHECK_THROW(cache.get(3, std::chrono::hours(1),
+                              []() -> int { throw std::runtime_error(""); }),
+                    std::runtime_error);
+  BOOST_CHECK_EQUAL(cache.get(3, std::chrono::hours(1), load), 4);
+}
+
+BOOST_AUTO_TEST_CASE(HandsOutThePendingLoad) {
+  SingleflightCache<int, int> cache;
+  std::shared_ptr<SharedResult<int>> pending;
+  auto owner = cache.fetch(1, std::chrono::minutes(1), [&]() {
+    //a second caller during the load gets the same, unfinished result
+    pending = cache.fetch(1, std::chrono::minutes(1), []() { return 0; });
+    BOOST_CHECK(!pending->ready());
+    return 42;
+  });
+
+  BOOST_CHECK(owner == pending);
+  BOOST_CHECK(pending->ready());
+  BOOST_CHECK_EQUAL(pending->get(), 42);
+  BOOST_CHECK_EQUAL(cache.missCount(), 1u);
+  BOOST_CHECK_EQUAL(cache.hitCount(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(EvictsTheLeastRecentlyUsedKey) {
+  SingleflightCache<int, int> cache(2);
+  int loads = 0;
+  auto load = [&loads]() { return ++loads; };
+
+  cache.get(1, std::chrono::hours(1), load);
+  cache.get(2, std::chrono::hours(1), load);
+  cache.get(1, std::chrono::hours(1), load);
+  cache.get(3, std::chrono::hours(1), load);
+  BOOST_CHECK_EQUAL(cache.size(), 2u);
+  BOOST_CHECK_EQUAL(loads, 3);
+
+  BOOST_CHECK_EQUAL(cache.get(1, std::chrono::hours(1), load), 1);
+  BOOST_CHECK_EQUAL(cache.get(2, std::chrono::hours(1), load), 4);
+  BOOST_CHECK_EQUAL(cache.size(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(MemberUpdatesInvalidateEntries) {
+  TgBot::Api api;
+  ApiCache cache(api);
+
+  auto member = cache.getChatMember(10, 1);
+  auto other = cache.getChatMember(10, 2);
+  auto admins = cache.getChatAdministrators(10);
+  BOOST_CHECK(cache.getChatMember(10, 1) == member);
+  BOOST_CHECK_EQUAL(cache.hitCount(), 1u);
+
+  auto update = std::make_shared<TgBot::ChatMemberUpdated>();
+  update->chat = std::make_shared<TgBot::Chat>();
+  update->chat->id = 10;
+  update->newChatMember = std::make_shared<TgBot::ChatMember>();
+  update->newChatMember->user = std::make_shared<TgBot::User>();
+  update->newChatMember->user->id = 1;
+  cache.invalidate(update);
+
+  BOOST_CHECK(cache.getChatMember(10, 1) != member);
+  BOOST_CHECK(cache.getChatMember(10, 2) == other);
+
+  auto request = std::make_shared<TgBot::ChatJoinRequest>();
+  request->chat = update->chat;
+  request->from = std::make_shared<TgBot::User>();
+  request->from->id = 2;
+  cache.invalidate(request);
+  BOOST_CHECK(cache.getChatMember(10, 2) != other);
+
+  auto chat = cache.getChat(10);
+  cache.invalidateChat(10);
+  BOOST_CHECK(cache.getChat(10) != chat);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
@@ -0,0 +1,118 @@
+#include <boost/test/unit_test.hpp>
+
+#include <atgbot/awaitables/asio.hpp>
+#include <atgbot/awaitables/timer.hpp>
+#include <atgbot/tools/asioexecutor.hpp>
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(AsioExecutorTests)
+
+using namespace ATgBot::Awaitables;
+using namespace ATgBot::Tools;
+
+namespace {
+
+ATgBot::Coroutine Sleeper(std::thread::id& resumed_on, bool& done) {
+  co_await waitFor(std::chrono::milliseconds(50));
+  resumed_on = std::this_thread::get_id();
+  done = true;
+}
+
+ATgBot::Coroutine AsioUser(boost::asio::io_context& io, int& step,
+                           bool& aborted) {
+  boost::asio::steady_timer timer(io, std::chrono::milliseconds(10));
+  co_await timer.async_wait(useCoroutine);
+  step = 1;
+  co_await boost::asio::post(io, useCoroutine);
+  step = 2;
+
+  timer.expires_after(std::chrono::minutes(1));
+  boost::asio::post(io, [&timer]() { timer.cancel(); });
+  try {
+    co_await timer.async_wait(useCoroutine);
+  } catch (const boost::system::system_error& e) {
+    aborted = e.code() == boost::asio::error::operation_aborted;
+  }
+  step = 3;
+}
+
+ATgBot::Coroutine Counter(std::atomic<int>& count) {
+  co_await waitFor(std::chrono::milliseconds(5));
+  ++count;
+}
+
+template <class Predicate>
+void runUntil(boost::asio::io_context& io, Predicate predicate) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (!predicate() && std::chrono::steady_clock::now() < deadline)
+    io.run_one_for(std::chrono::milliseconds(10));
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(ResumesOnTheExecutor) {
+  boost::asio::io_context io;
+  std::thread::id resumed_on;
+  bool done = false;
+  {
+    AsioScheduler scheduler(io.get_executor());
+    auto started = std::chrono::steady_clock::now();
+    BOOST_CHECK(scheduler.pushCoro(Sleeper(resumed_on, done)));
+    runUntil(io, [&]() { return done; });
+
+    BOOST_CHECK(done);
+    BOOST_CHECK(resumed_on == std::this_thread::get_id());
+    //woken by its steady_timer, not by the one second tick
+    BOOST_CHECK(std::chrono::steady_clock::now() - started <
+                std::chrono::milliseconds(900));
+    runUntil(io, [&]() { return scheduler.sessionCount() == 0; });
+    BOOST_CHECK_EQUAL(scheduler.sessionCount(), 0);
+  }
+  //the scheduler leaves no work behind
+  io.restart();
+  BOOST_CHECK(io.run_for(std::chrono::seconds(2)) < 10);
+  BOOST_CHECK(io.stopped());
+}
+
+BOOST_AUTO_TEST_CASE(AwaitsAsioOperations) {
+  boost::asio::io_context io;
+  int step = 0;
+  bool aborted = false;
+  AsioScheduler scheduler(io.get_executor());
+
+  scheduler.pushCoro(AsioUser(io, step, aborted));
+  runUntil(io, [&]() { return step == 3; });
+  BOOST_CHECK_EQUAL(step, 3);
+  BOOST_CHECK(aborted);
+}
+
+BOOST_AUTO_TEST_CASE(SharesAThreadPool) {
+  boost::asio::io_context io;
+  auto work = boost::asio::make_work_guard(io);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i)
+    threads.emplace_back([&io]() { io.run(); });
+
+  std::atomic<int> count{0};
+  {
+    AsioScheduler scheduler(io.get_executor());
+    for (int i = 0; i < 200; ++i)
+      scheduler.pushCoro(Counter(count));
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (count < 200 && std::chrono::steady_clock::now() < deadline)
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  work.reset();
+  for (auto& thread : threads)
+    thread.join();
+  BOOST_CHECK_EQUAL(count, 200);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
@@ -0,0 +1,72 @@
+#include <boost/test/unit_test.hpp>
+
+#include <atgbot/tools/asynclogappender.hpp>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(AsyncLogAppenderTests)
+
+using namespace ATgBot::Tools;
+
+plog::Record makeRecord(plog::Severity severity, const std::string& text) {
+  plog::Record record(severity, "handler", 42, "bot.cpp", nullptr, 0);
+  record << text;
+  return record;
+}
+
+BOOST_AUTO_TEST_CASE(FormatsOnFlush) {
+  std::ostringstream stream;
+  AsyncLogAppender appender(stream);
+  appender.write(makeRecord(plog::info, "first"));
+  appender.write(makeRecord(plog::debug, "second"));
+  appender.flush();
+
+  auto text = stream.str();
+  auto first = text.find("INFO  [");
+  auto second = text.find("DEBUG [");
+  BOOST_CHECK(first != std::string::npos);
+  BOOST_CHECK(second != std::string::npos && first < second);
+  BOOST_CHECK(text.find("[handler@42] first\n") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(TruncatesLongMessages) {
+  std::ostringstream stream;
+  AsyncLogAppender appender(stream);
+  appender.write(
+      makeRecord(plog::info, std::string(AsyncLogAppender::kMaxMessage * 2,
+                                         'x')));
+  appender.flush();
+  BOOST_CHECK(stream.str().find(
+                  std::string(AsyncLogAppender::kMaxMessage, 'x') + "\n") !=
+              std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(DropsWhenRingIsFull) {
+  std::ostringstream stream;
+  {
+    AsyncLogAppender appender(stream, 256);
+    std::thread writer([&]() {
+      for (int i = 0; i < 100; ++i)
+        appender.write(makeRecord(plog::info, "record"));
+    });
+    writer.join();
+    BOOST_CHECK(appender.droppedCount() > 0);
+  }
+  BOOST_CHECK(stream.str().find("dropped") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(ReleasesRingsOfExitedThreads) {
+  std::ostringstream stream;
+  AsyncLogAppender appender(stream);
+  for (int i = 0; i < 8; ++i)
+    std::thread([&appender, i]() {
+      appender.write(makeRecord(plog::info, "thread " + std::to_string(i)));
+    }).join();
+  appender.flush();
+
+  BOOST_CHECK_EQUAL(appender.ringCount(), 0u);
+  BOOST_CHECK(stream.str().find("thread 7\n") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,125 @@
+#include <boost/test/unit_test.hpp>
+
+#include <atgbot/tools/broadcast.hpp>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <numeric>
+#include <set>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(BroadcastTests)
+
+using namespace ATgBot::Tools;
+
+namespace {
+
+std::vector<std::int64_t> chats(std::int64_t count) {
+  std::vector<std::int64_t> ids(count);
+  std::iota(ids.begin(), ids.end(), 1);
+  return ids;
+}
+
+std::string tempPath(const std::string& name) {
+  auto path = std::filesystem::temp_directory_path() / name;
+  std::filesystem::remove(path);
+  return path.string();
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(SendsToEveryRecipient) {
+  using ErrorCode = TgBot::TgException::ErrorCode;
+  auto ids = chats(100);
+  std::mutex mutex;
+  std::multiset<std::int64_t> sent;
+  bool limited = false;
+
+  Broadcast broadcast(
+      Broadcast::fromRange(ids.begin(), ids.end()),
+      [&](std::int64_t chat) {
+        std::lock_guard _(mutex);
+        if (chat % 10 == 0)
+          throw TgBot::TgException("Forbidden: bot was blocked by the user",
+                                   ErrorCode::Forbidden);
+        if (chat == 5 && !std::exchange(limited, true))
+          throw TgBot::TgException("Too Many Requests: retry after 0",
+                                   ErrorCode::TooManyRequests);
+        sent.insert(chat);
+      },
+      {.in_flight = 4, .rate = 5000});
+  broadcast.start();
+  broadcast.wait();
+
+  BOOST_CHECK(broadcast.done());
+  BOOST_CHECK_EQUAL(sent.size(), 90);
+  BOOST_CHECK_EQUAL(sent.count(5), 1);
+  auto stats = broadcast.stats();
+  BOOST_CHECK_EQUAL(stats.sent, 90);
+  BOOST_CHECK_EQUAL(stats.blocked, 10);
+  BOOST_CHECK_EQUAL(stats.rate_limited, 1);
+  BOOST_CHECK_EQUAL(stats.position, 100);
+}
+
+BOOST_AUTO_TEST_CASE(ResumesFromCheckpoint) {
+  auto checkpoint = tempPath("atgbot_broadcast_checkpoint");
+  auto id_file = tempPath("atgbot_broadcast_ids");
+  auto ids = chats(200);
+  std::ofstream(id_file, std::ios::binary)
+      .write(reinterpret_cast<const char*>(ids.data()),
+             ids.size() * sizeof(std::int64_t));
+
+  std::mutex mutex;
+  std::set<std::int64_t> sent;
+  std::uint64_t position = 0;
+  {
+    Broadcast* self = nullptr;
+    Broadcast first(
+        Broadcast::fromIdFile(id_file),
+        [&](std::int64_t chat) {
+          std::lock_guard _(mutex);
+          sent.insert(chat);
+          if (sent.size() == 50)
+            self->stop();
+        },
+        {.in_flight = 4, .rate = 5000, .checkpoint = checkpoint});
+    self = &first;
+    first.start();
+    first.wait();
+    BOOST_CHECK(!first.done());
+    position = first.stats().position;
+  }
+  BOOST_CHECK(position >= 46 && position <= 54);
+
+  std::size_t resent = 0;
+  Broadcast second(
+      Broadcast::fromIdFile(id_file),
+      [&](std::int64_t chat) {
+        std::lock_guard _(mutex);
+        resent += sent.count(chat);
+        sent.insert(chat);
+      },
+      {.in_flight = 4, .rate = 5000, .checkpoint = checkpoint});
+  second.start();
+  second.wait();
+
+  BOOST_CHECK(second.done());
+  BOOST_CHECK_EQUAL(sent.size(), 200);
+  BOOST_CHECK_LE(resent, 4);
+  BOOST_CHECK_EQUAL(second.stats().sent, 200 - position);
+
+  std::filesystem::remove(checkpoint);
+  std::filesystem::remove(id_file);
+}
+
+BOOST_AUTO_TEST_CASE(ParsesRetryAfter) {
+  using ErrorCode = TgBot::TgException::ErrorCode;
+  auto seconds = Broadcast::retryAfter(TgBot::TgException(
+      "Too Many Requests: retry after 35", ErrorCode::TooManyRequests));
+  BOOST_REQUIRE(seconds);
+  BOOST_CHECK(*seconds == std::chrono::seconds(35));
+  BOOST_CHECK(!Broadcast::retryAfter(TgBot::TgException(
+      "Bad Request: chat not found", ErrorCode::BadRequest)));
+}
+
+BOOST_AUTO_TEST_SUITE_END();
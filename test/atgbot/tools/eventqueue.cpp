@@ -1,8 +1,12 @@
 #include <boost/test/unit_test.hpp>
 
+#include <algorithm>
+#include <atomic>
 #include <optional>
 #include <string>
 #include <functional>
+#include <thread>
+#include <vector>
 
 #include <atgbot/tools/eventfilter.hpp>
 #include <atgbot/tools/eventqueue.hpp>
@@ -77,4 +81,139 @@ BOOST_AUTO_TEST_CASE(HasChanges) {
   BOOST_CHECK(!queue.hasChanges());
 }
 
-BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
+BOOST_AUTO_TEST_CASE(OverflowKeepsOrder) {
+  ATgBot::Tools::EventQueue<int, 2> queue;
+  ATgBot::Tools::EventFilter<int> filter;
+  filter.setEnabled(true);
+  queue.setFilter(filter);
+
+  for (int i = 0; i < 10; ++i)
+    queue.push(i);
+  for (int i = 0; i < 10; ++i) {
+    auto elem = queue.pop();
+    BOOST_REQUIRE(elem.has_value());
+    BOOST_CHECK_EQUAL(elem.value(), i);
+    queue.push(10 + i);
+  }
+  for (int i = 10; i < 20; ++i)
+    BOOST_CHECK_EQUAL(queue.pop().value(), i);
+  BOOST_CHECK(queue.empty());
+}
+
+BOOST_AUTO_TEST_CASE(SetFilterDropsQueuedElements) {
+  ATgBot::Tools::EventQueue<int> queue;
+  ATgBot::Tools::EventFilter<int> filter;
+  filter.setEnabled(true);
+  queue.setFilter(filter);
+
+  queue.push(1);
+  queue.setFilter(filter);
+  BOOST_CHECK(queue.empty());
+  BOOST_CHECK(!queue.pop().has_value());
+}
+
+BOOST_AUTO_TEST_CASE(MultipleProducers) {
+  constexpr int kProducers = 4;
+  constexpr int kCount = 10000;
+
+  ATgBot::Tools::EventQueue<int> queue;
+  ATgBot::Tools::EventFilter<int> filter;
+  filter.setEnabled(true);
+  queue.setFilter(filter);
+
+  std::vector<std::thread> producers;
+  for (int p = 0; p < kProducers; ++p)
+    producers.emplace_back([&queue, p]() {
+      for (int i = 0; i < kCount; ++i)
+        queue.push(p * kCount + i);
+    });
+
+  std::vector<int> last(kProducers, -1);
+  int received = 0;
+  while (received < kProducers * kCount) {
+    auto elem = queue.pop();
+    if (!elem)
+      continue;
+    int producer = elem.value() / kCount;
+    BOOST_REQUIRE(elem.value() % kCount > last[producer]);
+    last[producer] = elem.value() % kCount;
+    ++received;
+  }
+  for (auto& producer : producers)
+    producer.join();
+  BOOST_CHECK(queue.empty());
+}
+
+BOOST_AUTO_TEST_CASE(BoundedQueuePolicies) {
+  auto fill = [](OverflowPolicy policy) {
+    EventQueue<int> queue;
+    queue.setLimit({.max_events = 2, .policy = policy});
+    EventFilter<int> filter;
+    filter.setEnabled(true);
+    queue.setFilter(filter);
+    for (int i = 1; i <= 5; ++i)
+      queue.push(i);
+    std::vector<int> result;
+    while (auto elem = queue.pop())
+      result.push_back(elem.value());
+    BOOST_CHECK_EQUAL(queue.droppedCount(), 5 - result.size());
+    return result;
+  };
+
+  BOOST_CHECK((fill(OverflowPolicy::kDropOldest) == std::vector<int>{4, 5}));
+  BOOST_CHECK((fill(OverflowPolicy::kDropNew) == std::vector<int>{1, 2}));
+  BOOST_CHECK((fill(OverflowPolicy::kCoalesce) == std::vector<int>{5}));
+}
+
+BOOST_AUTO_TEST_CASE(StaleEventsDoNotCountAgainstTheLimit) {
+  EventQueue<int> queue;
+  queue.setLimit({.max_events = 2, .policy = OverflowPolicy::kDropNew});
+  EventFilter<int> filter;
+  filter.setEnabled(true);
+  queue.setFilter(filter);
+  queue.push(1);
+  queue.push(2);
+  queue.clear();
+  queue.push(3);
+  queue.push(4);
+
+  BOOST_CHECK_EQUAL(queue.size(), 2);
+  BOOST_CHECK_EQUAL(queue.pop().value(), 3);
+  BOOST_CHECK_EQUAL(queue.pop().value(), 4);
+  BOOST_CHECK(!queue.pop());
+  BOOST_CHECK_EQUAL(queue.droppedCount(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(CountsQueuedEventsForOtherThreads) {
+  EventQueue<int> queue;
+  EventFilter<int> filter;
+  filter.setEnabled(true);
+  queue.setFilter(filter);
+
+  std::vector<std::thread> producers;
+  for (int i = 0; i < 4; ++i)
+    producers.emplace_back([&queue]() {
+      for (int j = 0; j < 100; ++j)
+        queue.push(j);
+    });
+  std::atomic<bool> done = false;
+  std::size_t peak = 0;
+  std::thread reader([&]() {
+    while (!done)
+      peak = std::max(peak, queue.queued());
+  });
+  for (auto& producer : producers)
+    producer.join();
+  done = true;
+  reader.join();
+
+  BOOST_CHECK_LE(peak, 400u);
+  BOOST_CHECK_EQUAL(queue.queued(), 400u);
+  queue.pop();
+  BOOST_CHECK_EQUAL(queue.queued(), 399u);
+  queue.clear();
+  while (queue.pop()) {}
+  BOOST_CHECK_EQUAL(queue.queued(), 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
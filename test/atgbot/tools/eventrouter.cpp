@@ -0,0 +1,81 @@
+#include <boost/test/unit_test.hpp>
+
+#include <atgbot/tools/eventrouter.hpp>
+#include <atgbot/tools/filters.hpp>
+#include <memory>
+
+BOOST_AUTO_TEST_SUITE(EventRouterTests)
+
+using namespace ATgBot::Tools;
+
+ATgBot::Coroutine EmptyCoro() {
+  co_return;
+}
+
+std::shared_ptr<Session> makeSession(int& executed,
+                                     EventFilter<TgBot::Message::Ptr> filter) {
+  auto s = Session::create(
+      EmptyCoro(), [&executed](auto r1) { ++executed; }, [](auto r1) {});
+  s->message_queue.setFilter(filter);
+  return s;
+}
+
+TgBot::Message::Ptr makeMessage(int64_t user, int64_t chat) {
+  auto message = std::make_shared<TgBot::Message>();
+  message->from = std::make_shared<TgBot::User>();
+  message->from->id = user;
+  message->chat = std::make_shared<TgBot::Chat>();
+  message->chat->id = chat;
+  return message;
+}
+
+BOOST_AUTO_TEST_CASE(RoutesByIndexedKeys) {
+  int by_chat = 0, by_user = 0, unindexed = 0;
+  auto chat_session = makeSession(
+      by_chat, makeFilter<TgBot::Message::Ptr>(ATgBot::Filters::chat(10)));
+  auto user_session = makeSession(
+      by_user, makeFilter<TgBot::Message::Ptr>(ATgBot::Filters::from(1)));
+  EventFilter<TgBot::Message::Ptr> any;
+  any.setEnabled(true);
+  auto any_session = makeSession(unindexed, any);
+
+  EventRouter<TgBot::Message::Ptr> router(&Session::message_queue);
+  router.update(chat_session);
+  router.update(user_session);
+  router.update(any_session);
+
+  router.route(makeMessage(2, 20));
+  BOOST_CHECK_EQUAL(by_chat, 0);
+  BOOST_CHECK_EQUAL(by_user, 0);
+  BOOST_CHECK_EQUAL(unindexed, 1);
+
+  router.route(makeMessage(1, 10));
+  BOOST_CHECK_EQUAL(by_chat, 1);
+  BOOST_CHECK_EQUAL(by_user, 1);
+  BOOST_CHECK_EQUAL(unindexed, 2);
+  BOOST_CHECK(!chat_session->message_queue.empty());
+  BOOST_CHECK(!user_session->message_queue.empty());
+}
+
+BOOST_AUTO_TEST_CASE(RemoveAndReindex) {
+  int executed = 0;
+  auto session = makeSession(
+      executed, makeFilter<TgBot::Message::Ptr>(ATgBot::Filters::chat(10)));
+
+  EventRouter<TgBot::Message::Ptr> router(&Session::message_queue);
+  router.update(session);
+
+  session->message_queue.setFilter(
+      makeFilter<TgBot::Message::Ptr>(ATgBot::Filters::chat(20)));
+  router.update(session);
+  router.route(makeMessage(1, 10));
+  BOOST_CHECK_EQUAL(executed, 0);
+  router.route(makeMessage(1, 20));
+  BOOST_CHECK_EQUAL(executed, 1);
+
+  router.remove(session);
+  router.route(makeMessage(1, 20));
+  BOOST_CHECK_EQUAL(executed, 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
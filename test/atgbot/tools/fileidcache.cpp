@@ -0,0 +1,131 @@
+#include <boost/test/unit_test.hpp>
+
+#include <atgbot/tools/fileidcache.hpp>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(FileIdCacheTests)
+
+using namespace ATgBot::Tools;
+
+namespace {
+
+struct Files {
+  std::filesystem::path dir =
+      std::filesystem::temp_directory_path() / "atgbot_fileidcache";
+
+  Files() {
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+  }
+  ~Files() { std::filesystem::remove_all(dir); }
+
+  std::filesystem::path write(const std::string& name,
+                              const std::string& content) {
+    auto path = dir / name;
+    std::ofstream(path, std::ios::binary) << content;
+    return path;
+  }
+};
+
+//fake sendDocument, counts uploads and answers with a document
+struct FakeSend {
+  std::atomic<int> uploads = 0;
+  std::atomic<int> by_id = 0;
+
+  FileIdCache::Send callback() {
+    return [this](const FileIdCache::Media& media) {
+      auto message = std::make_shared<TgBot::Message>();
+      message->document = std::make_shared<TgBot::Document>();
+      if (auto id = boost::get<std::string>(&media)) {
+        ++by_id;
+        message->document->fileId = *id;
+      } else {
+        ++uploads;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        message->document->fileId = "id" + std::to_string(uploads.load());
+      }
+      return message;
+    };
+  }
+};
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(ReusesFileIdOfSameContent) {
+  Files files;
+  auto first = files.write("a.bin", "content");
+  auto copy = files.write("b.bin", "content");
+  auto other = files.write("c.bin", "other");
+  FakeSend send;
+  FileIdCache cache(files.dir / "cache");
+
+  BOOST_CHECK_EQUAL(cache.send(first, "", send.callback())->document->fileId,
+                    "id1");
+  BOOST_CHECK_EQUAL(cache.send(copy, "", send.callback())->document->fileId,
+                    "id1");
+  BOOST_CHECK_EQUAL(cache.send(other, "", send.callback())->document->fileId,
+                    "id2");
+
+  BOOST_CHECK_EQUAL(send.uploads, 2);
+  BOOST_CHECK_EQUAL(send.by_id, 1);
+  BOOST_CHECK_EQUAL(cache.size(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(PersistsAcrossInstances) {
+  Files files;
+  auto path = files.write("a.bin", "content");
+  FakeSend send;
+
+  {
+    FileIdCache cache(files.dir / "cache", 16);
+    cache.send(path, "", send.callback());
+  }
+  FileIdCache cache(files.dir / "cache");
+  BOOST_CHECK_EQUAL(cache.capacity(), 16u);
+  BOOST_CHECK(cache.find(FileIdCache::hashFile(path)) == "id1");
+  cache.send(path, "", send.callback());
+  BOOST_CHECK_EQUAL(send.uploads, 1);
+}
+
+BOOST_AUTO_TEST_CASE(CoalescesConcurrentFirstSends) {
+  Files files;
+  auto path = files.write("a.bin", "content");
+  FakeSend send;
+  FileIdCache cache(files.dir / "cache");
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i)
+    threads.emplace_back([&]() { cache.send(path, "", send.callback()); });
+  for (auto& thread : threads)
+    thread.join();
+
+  BOOST_CHECK_EQUAL(send.uploads, 1);
+  BOOST_CHECK_EQUAL(send.by_id, 3);
+}
+
+BOOST_AUTO_TEST_CASE(ReuploadsRejectedFileId) {
+  Files files;
+  auto path = files.write("a.bin", "content");
+  FileIdCache cache(files.dir / "cache");
+  cache.store(FileIdCache::hashFile(path), "expired");
+
+  FakeSend send;
+  auto inner = send.callback();
+  auto message = cache.send(path, "", [&](const FileIdCache::Media& media) {
+    if (boost::get<std::string>(&media))
+      throw TgBot::TgException("wrong file identifier",
+                               TgBot::TgException::ErrorCode::BadRequest);
+    return inner(media);
+  });
+
+  BOOST_CHECK_EQUAL(message->document->fileId, "id1");
+  BOOST_CHECK(cache.find(FileIdCache::hashFile(path)) == "id1");
+  BOOST_CHECK_EQUAL(cache.size(), 1u);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
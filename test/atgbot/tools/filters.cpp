@@ -0,0 +1,87 @@
+#include <boost/test/unit_test.hpp>
+
+#include <atgbot/tools/filters.hpp>
+#include <memory>
+
+BOOST_AUTO_TEST_SUITE(FiltersTests)
+
+using namespace ATgBot::Filters;
+using namespace ATgBot::Tools;
+
+TgBot::Message::Ptr makeMessage(int64_t user, int64_t chat_id,
+                                std::string text) {
+  auto message = std::make_shared<TgBot::Message>();
+  message->from = std::make_shared<TgBot::User>();
+  message->from->id = user;
+  message->chat = std::make_shared<TgBot::Chat>();
+  message->chat->id = chat_id;
+  message->text = std::move(text);
+  return message;
+}
+
+BOOST_AUTO_TEST_CASE(Terms) {
+  auto message = makeMessage(1, 2, "/start now");
+  BOOST_CHECK(from(1)(message));
+  BOOST_CHECK(!from(2)(message));
+  BOOST_CHECK(chat(2)(message));
+  BOOST_CHECK(textPrefix("/start")(message));
+  BOOST_CHECK(!textPrefix(std::string("/stop"))(message));
+}
+
+BOOST_AUTO_TEST_CASE(PrefixFromBufferIsCopied) {
+  char buffer[16] = "/start";
+  auto prefix = textPrefix(buffer);
+  buffer[1] = 'x';
+  BOOST_CHECK(prefix(makeMessage(1, 2, "/start now")));
+  BOOST_CHECK_EQUAL(*prefix.keys().prefix, "/start");
+}
+
+BOOST_AUTO_TEST_CASE(Composition) {
+  auto message = makeMessage(1, 2, "/x");
+  BOOST_CHECK((from(1) && chat(2) && textPrefix("/x"))(message));
+  BOOST_CHECK(!(from(1) && chat(3))(message));
+  BOOST_CHECK((from(3) || chat(2))(message));
+  BOOST_CHECK((!from(3))(message));
+}
+
+BOOST_AUTO_TEST_CASE(NullEventsDoNotMatch) {
+  TgBot::Message::Ptr message;
+  BOOST_CHECK(!from(1)(message));
+  BOOST_CHECK(!chat(1)(message));
+}
+
+BOOST_AUTO_TEST_CASE(KeyTerms) {
+  auto keys = (from(1) && chat(2) && textPrefix("/x")).keys();
+  BOOST_CHECK(keys.user == 1);
+  BOOST_CHECK(keys.chat == 2);
+  BOOST_CHECK(keys.prefix == "/x");
+  BOOST_CHECK(!keys.message_id);
+
+  auto or_keys = ((from(1) && chat(2)) || (from(1) && chat(3))).keys();
+  BOOST_CHECK(or_keys.user == 1);
+  BOOST_CHECK(!or_keys.chat);
+
+  BOOST_CHECK(!(!from(1)).keys().user);
+}
+
+BOOST_AUTO_TEST_CASE(MakeFilter) {
+  auto filter = makeFilter<TgBot::Message::Ptr>(from(1) && chat(2));
+  BOOST_CHECK(filter.check(makeMessage(1, 2, "")));
+  BOOST_CHECK(!filter.check(makeMessage(1, 3, "")));
+  BOOST_CHECK(filter.keys().chat == 2);
+}
+
+BOOST_AUTO_TEST_CASE(PredicateIsStoredInPlace) {
+  auto filter = makeFilter<TgBot::Message::Ptr>(
+      from(1) && textPrefix(std::string("/start with a long prefix")));
+  BOOST_CHECK(!filter.m_additional_filter);
+  BOOST_CHECK(static_cast<bool>(filter.m_predicate));
+
+  auto copy = filter;
+  filter = makeFilter<TgBot::Message::Ptr>(from(2));
+  BOOST_CHECK(copy.check(makeMessage(1, 5, "/start with a long prefix!")));
+  BOOST_CHECK(!copy.check(makeMessage(1, 5, "/start")));
+  BOOST_CHECK(filter.check(makeMessage(2, 5, "")));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
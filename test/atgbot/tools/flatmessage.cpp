@@ -0,0 +1,129 @@
+#include <boost/test/unit_test.hpp>
+
+#include <atgbot/awaitables/flatmessage.hpp>
+#include <atgbot/tools/flatmessage.hpp>
+#include <atgbot/tools/scheduler.hpp>
+#include <string>
+
+BOOST_AUTO_TEST_SUITE(FlatMessageTests)
+
+using namespace ATgBot::Awaitables;
+using namespace ATgBot::Tools;
+
+namespace {
+
+TgBot::Message::Ptr makeMessage(std::int64_t user, std::string text) {
+  auto message = std::make_shared<TgBot::Message>();
+  message->messageId = 7;
+  message->text = std::move(text);
+  message->from = std::make_shared<TgBot::User>();
+  message->from->id = user;
+  message->from->username = "alice";
+  message->chat = std::make_shared<TgBot::Chat>();
+  message->chat->id = -100;
+  message->chat->type = TgBot::Chat::Type::Supergroup;
+  message->chat->title = "group";
+  return message;
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(KeepsFieldsInOneAllocation) {
+  auto message = makeMessage(1, "/start now");
+  auto entity = std::make_shared<TgBot::MessageEntity>();
+  entity->type = TgBot::MessageEntity::Type::BotCommand;
+  entity->length = 6;
+  message->entities.push_back(entity);
+  message->replyToMessage = std::make_shared<TgBot::Message>();
+  message->replyToMessage->messageId = 3;
+  message->photo = {std::make_shared<TgBot::PhotoSize>(),
+                    std::make_shared<TgBot::PhotoSize>()};
+  message->photo.back()->fileId = "large";
+
+  FlatMessage flat(*message);
+  message.reset();
+
+  BOOST_CHECK_EQUAL(flat.messageId(), 7);
+  BOOST_CHECK(flat.fromId() == 1);
+  BOOST_CHECK(flat.chatId() == -100);
+  BOOST_CHECK(flat.chatType() == TgBot::Chat::Type::Supergroup);
+  BOOST_CHECK_EQUAL(flat.text(), "/start now");
+  BOOST_CHECK_EQUAL(flat.fromUsername(), "alice");
+  BOOST_CHECK_EQUAL(flat.chatTitle(), "group");
+  BOOST_CHECK_EQUAL(flat.replyToMessageId(), 3);
+  BOOST_CHECK_EQUAL(flat.fileId(), "large");
+  BOOST_REQUIRE_EQUAL(flat.entities().size(), 1u);
+  BOOST_CHECK(flat.entities()[0].type ==
+              TgBot::MessageEntity::Type::BotCommand);
+
+  FlatMessage copy = flat;
+  flat = FlatMessage();
+  BOOST_CHECK(!flat);
+  BOOST_CHECK_EQUAL(copy.text(), "/start now");
+  BOOST_CHECK(flat.text().empty());
+}
+
+BOOST_AUTO_TEST_CASE(ConvertsBackToMessage) {
+  FlatMessage flat(*makeMessage(1, "hi"));
+  auto message = flat.toMessage();
+
+  BOOST_CHECK_EQUAL(message->messageId, 7);
+  BOOST_CHECK_EQUAL(message->text, "hi");
+  BOOST_CHECK_EQUAL(message->from->id, 1);
+  BOOST_CHECK_EQUAL(message->from->username, "alice");
+  BOOST_CHECK_EQUAL(message->chat->id, -100);
+  BOOST_CHECK(!message->replyToMessage);
+  BOOST_CHECK(!message->document);
+  BOOST_CHECK(!FlatMessage().toMessage());
+}
+
+BOOST_AUTO_TEST_CASE(KeepsTheKindOfTheMedia) {
+  auto voice = makeMessage(1, "");
+  voice->voice = std::make_shared<TgBot::Voice>();
+  voice->voice->fileId = "voice";
+  FlatMessage flat(*voice);
+  BOOST_CHECK(flat.mediaKind() == FlatMessage::MediaKind::kVoice);
+  auto message = flat.toMessage();
+  BOOST_REQUIRE(message->voice);
+  BOOST_CHECK_EQUAL(message->voice->fileId, "voice");
+  BOOST_CHECK(!message->document);
+
+  auto photo = makeMessage(1, "");
+  photo->photo = {std::make_shared<TgBot::PhotoSize>(),
+                  std::make_shared<TgBot::PhotoSize>()};
+  photo->photo.back()->fileId = "large";
+  message = FlatMessage(*photo).toMessage();
+  BOOST_REQUIRE_EQUAL(message->photo.size(), 1u);
+  BOOST_CHECK_EQUAL(message->photo[0]->fileId, "large");
+}
+
+BOOST_AUTO_TEST_CASE(WorksWithFilters) {
+  FlatMessage flat(*makeMessage(1, "/buy apples"));
+  auto filter = makeFilter<FlatMessage>(ATgBot::Filters::from(1) &&
+                                        ATgBot::Filters::textPrefix("/buy"));
+  BOOST_CHECK(filter.check(flat));
+  BOOST_CHECK(filter.keys().user == 1);
+  BOOST_CHECK(!filter.check(FlatMessage(*makeMessage(2, "/buy"))));
+}
+
+ATgBot::Coroutine FlatCoro(std::string& text) {
+  auto message = co_await getFlatMessageU(1);
+  text = message.text();
+  co_return;
+}
+
+BOOST_AUTO_TEST_CASE(SchedulerRoutesFlatMessages) {
+  std::string text;
+  BasicScheduler<SingleThreaded> scheduler;
+
+  scheduler.pushCoro(FlatCoro(text));
+  scheduler.runPending();
+  scheduler.handleMessage(makeMessage(2, "other"));
+  scheduler.handleMessage(makeMessage(1, "mine"));
+  scheduler.runPending();
+
+  BOOST_CHECK_EQUAL(text, "mine");
+  BOOST_CHECK_EQUAL(scheduler.sessionCount(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
@@ -0,0 +1,100 @@
+#include <boost/test/unit_test.hpp>
+
+#include <atgbot/tools/inlinequeries.hpp>
+#include <thread>
+
+BOOST_AUTO_TEST_SUITE(InlineQueriesTests)
+
+using namespace ATgBot::Tools;
+
+namespace {
+
+TgBot::Update::Ptr inlineUpdate(std::int32_t id, std::int64_t user) {
+  auto update = std::make_shared<TgBot::Update>();
+  update->updateId = id;
+  update->inlineQuery = std::make_shared<TgBot::InlineQuery>();
+  update->inlineQuery->from = std::make_shared<TgBot::User>();
+  update->inlineQuery->from->id = user;
+  return update;
+}
+
+ATgBot::Coroutine EmptyCoro() {
+  co_return;
+}
+
+std::shared_ptr<Session> makeSession() {
+  return Session::create(EmptyCoro(), [](auto) {}, [](auto) {});
+}
+
+InlineResultCache::Answer answer(std::size_t results,
+                                 std::int32_t cache_time = 300) {
+  InlineResultCache::Answer answer;
+  answer.results.resize(results);
+  answer.cache_time = cache_time;
+  return answer;
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(NormalizesQueryText) {
+  BOOST_CHECK_EQUAL(normalizeInlineQuery("  Cat \t PICS  "), "cat pics");
+  BOOST_CHECK_EQUAL(normalizeInlineQuery(""), "");
+}
+
+BOOST_AUTO_TEST_CASE(SkipsQueriesSupersededInBatch) {
+  std::vector<TgBot::Update::Ptr> updates = {
+      inlineUpdate(1, 10), inlineUpdate(2, 20), inlineUpdate(3, 10),
+      inlineUpdate(4, 10)};
+  auto superseded = InlineDebouncer::supersededInBatch(updates);
+  BOOST_CHECK_EQUAL(superseded.size(), 2u);
+  BOOST_CHECK(superseded.contains(1));
+  BOOST_CHECK(superseded.contains(3));
+}
+
+BOOST_AUTO_TEST_CASE(ReplaceReturnsLiveSessionOfUser) {
+  InlineDebouncer debouncer;
+  auto first = makeSession();
+  auto second = makeSession();
+
+  BOOST_CHECK(debouncer.replace(10, first) == nullptr);
+  BOOST_CHECK(debouncer.replace(20, second) == nullptr);
+  BOOST_CHECK(debouncer.replace(10, second) == first);
+
+  auto third = makeSession();
+  second.reset();
+  BOOST_CHECK(debouncer.replace(20, third) == nullptr);
+  BOOST_CHECK_EQUAL(debouncer.supersededCount(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(CacheMatchesNormalizedQueryAndOffset) {
+  InlineResultCache cache;
+  cache.store("Cat  pics", "", answer(3));
+
+  auto hit = cache.find(" cat pics", "");
+  BOOST_REQUIRE(hit);
+  BOOST_CHECK_EQUAL(hit->results.size(), 3u);
+  BOOST_CHECK(!cache.find("cat pics", "10"));
+  BOOST_CHECK(!cache.find("dog pics", ""));
+  BOOST_CHECK_EQUAL(cache.hitCount(), 1u);
+  BOOST_CHECK_EQUAL(cache.missCount(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(CacheEvictsLeastRecentlyUsed) {
+  InlineResultCache cache(2, 10);
+  cache.store("a", "", answer(1));
+  cache.store("b", "", answer(1));
+  BOOST_CHECK(cache.find("a", ""));
+  cache.store("c", "", answer(1));
+  BOOST_CHECK(cache.find("a", ""));
+  BOOST_CHECK(!cache.find("b", ""));
+
+  // over the result limit
+  cache.store("d", "", answer(10));
+  BOOST_CHECK_EQUAL(cache.size(), 1u);
+  BOOST_CHECK(cache.find("d", ""));
+
+  cache.store("e", "", answer(1, 0));
+  BOOST_CHECK(!cache.find("e", ""));
+}
+
+BOOST_AUTO_TEST_SUITE_END();
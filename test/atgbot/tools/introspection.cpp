@@ -0,0 +1,55 @@
+#include <boost/test/unit_test.hpp>
+
+#include <atgbot/awaitables/message.hpp>
+#include <atgbot/tools/introspection.hpp>
+#include <atgbot/tools/scheduler.hpp>
+#include <csignal>
+#include <sstream>
+
+BOOST_AUTO_TEST_SUITE(IntrospectionTests)
+
+using namespace ATgBot::Awaitables;
+using namespace ATgBot::Tools;
+
+ATgBot::Coroutine ChatCoro(int64_t chat) {
+  co_await getMessageG(chat);
+  co_return;
+}
+
+BOOST_AUTO_TEST_CASE(ReportsSuspendedSessions) {
+  BasicScheduler<SingleThreaded> scheduler;
+  scheduler.pushCoro(ChatCoro(5), {.origin = "/start"});
+  scheduler.pushCoro(ChatCoro(5), {.origin = "/start"});
+  scheduler.pushCoro(ChatCoro(6), {.origin = "/help"});
+  scheduler.runPending();
+
+  auto report = scheduler.sessionReport();
+  BOOST_REQUIRE_EQUAL(report.sessions.size(), 3);
+  auto& info = report.sessions.front();
+  BOOST_CHECK_EQUAL(info.awaiting, "getMessage");
+  BOOST_CHECK(info.keys.chat == 5);
+  BOOST_CHECK(info.frame_size > 0);
+  BOOST_CHECK_EQUAL(info.origin, "/start");
+
+  BOOST_CHECK_EQUAL(report.total.sessions, 3);
+  BOOST_CHECK_EQUAL(report.by_origin["/start"].sessions, 2);
+  BOOST_CHECK_EQUAL(report.by_awaiting["getMessage"].sessions, 3);
+  BOOST_CHECK_EQUAL(report.suspended_histogram[0], 3);
+  BOOST_REQUIRE_EQUAL(report.hot_chats.size(), 2);
+  BOOST_CHECK_EQUAL(report.hot_chats.front().first, 5);
+
+  std::ostringstream stream;
+  stream << report;
+  BOOST_CHECK(stream.str().find("/help: 1 sessions") != std::string::npos);
+  scheduler.drain(std::chrono::seconds(1));
+}
+
+BOOST_AUTO_TEST_CASE(SignalRequestsDump) {
+  auto before = sessionDumpRequests();
+  dumpSessionsOnSignal(SIGUSR1);
+  std::raise(SIGUSR1);
+  BOOST_CHECK_EQUAL(sessionDumpRequests(), before + 1);
+  std::signal(SIGUSR1, SIG_DFL);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,484 @@
+#include <boost/test/unit_test.hpp>
+
+#include <atgbot/awaitables/callbackquery.hpp>
+#include <atgbot/awaitables/makeasync.hpp>
+#include <atgbot/awaitables/message.hpp>
+#include <atgbot/awaitables/timer.hpp>
+#include <atgbot/tools/scheduler.hpp>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(SchedulerTests)
+
+using namespace ATgBot::Awaitables;
+using namespace ATgBot::Tools;
+
+template <typename F>
+bool waitUntil(F condition) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (!condition()) {
+    if (std::chrono::steady_clock::now() > deadline)
+      return false;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return true;
+}
+
+ATgBot::Coroutine WaitCoro(std::atomic<int>& cancelled, int64_t user) {
+  try {
+    co_await getMessageU(user);
+  } catch (const ATgBot::CancelledError&) {
+    ++cancelled;
+  }
+  co_return;
+}
+
+BOOST_AUTO_TEST_CASE(EvictsLeastRecentlyUsedOverBudget) {
+  std::atomic<int> cancelled = 0;
+  Scheduler scheduler(1);
+  scheduler.setSessionLimits({.max_sessions = 1});
+
+  scheduler.pushCoro(WaitCoro(cancelled, 1));
+  std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  scheduler.pushCoro(WaitCoro(cancelled, 2));
+
+  BOOST_CHECK(waitUntil([&]() { return cancelled == 1; }));
+  BOOST_CHECK(waitUntil([&]() { return scheduler.sessionCount() == 1; }));
+  BOOST_CHECK_EQUAL(scheduler.evictedCount(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(EvictsIdleSessions) {
+  std::atomic<int> cancelled = 0;
+  Scheduler scheduler(1);
+  scheduler.setSessionLimits({.idle_ttl = std::chrono::milliseconds(1)});
+
+  scheduler.pushCoro(WaitCoro(cancelled, 1));
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  scheduler.enforceLimits();
+
+  BOOST_CHECK(waitUntil([&]() { return cancelled == 1; }));
+  BOOST_CHECK(waitUntil([&]() { return scheduler.sessionCount() == 0; }));
+}
+
+BOOST_AUTO_TEST_CASE(CallbackPolicyChoosesVictim) {
+  std::atomic<int> cancelled = 0;
+  Scheduler scheduler(1);
+  SessionLimits limits;
+  limits.max_sessions = 1;
+  limits.policy = EvictionPolicy::kCallback;
+  limits.on_evict = [](const std::vector<std::shared_ptr<Session>>& alive) {
+    return alive.back();
+  };
+  scheduler.setSessionLimits(limits);
+
+  scheduler.pushCoro(WaitCoro(cancelled, 1));
+  scheduler.pushCoro(WaitCoro(cancelled, 2));
+
+  BOOST_CHECK(waitUntil([&]() { return cancelled == 1; }));
+  BOOST_CHECK_EQUAL(scheduler.evictedCount(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(DrainCancelsSuspendedSessions) {
+  std::atomic<int> cancelled = 0;
+  Scheduler scheduler(1);
+
+  scheduler.pushCoro(WaitCoro(cancelled, 1));
+  scheduler.pushCoro(WaitCoro(cancelled, 2));
+
+  BOOST_CHECK(scheduler.drain(std::chrono::seconds(5)));
+  BOOST_CHECK_EQUAL(cancelled, 2);
+  BOOST_CHECK_EQUAL(scheduler.sessionCount(), 0);
+}
+
+ATgBot::Coroutine BlockingCoro(std::atomic<bool>& started) {
+  started = true;
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  co_return;
+}
+
+ATgBot::Coroutine RecordCoro(std::mutex& mutex, std::vector<int>& order,
+                             int id) {
+  std::lock_guard _(mutex);
+  order.push_back(id);
+  co_return;
+}
+
+BOOST_AUTO_TEST_CASE(HigherPriorityAndEarlierDeadlineRunFirst) {
+  std::atomic<bool> started = false;
+  std::mutex mutex;
+  std::vector<int> order;
+  Scheduler scheduler(1);
+
+  scheduler.pushCoro(BlockingCoro(started));
+  BOOST_REQUIRE(waitUntil([&]() { return started.load(); }));
+
+  auto now = DefaultTimer::now();
+  scheduler.pushCoro(RecordCoro(mutex, order, 1),
+                     {.priority = Priority::kBackground});
+  scheduler.pushCoro(RecordCoro(mutex, order, 2));
+  scheduler.pushCoro(RecordCoro(mutex, order, 3),
+                     {.priority = Priority::kHigh,
+                      .deadline = now + std::chrono::seconds(10)});
+  scheduler.pushCoro(RecordCoro(mutex, order, 4),
+                     {.priority = Priority::kHigh,
+                      .deadline = now + std::chrono::seconds(5)});
+
+  BOOST_REQUIRE(waitUntil([&]() {
+    std::lock_guard _(mutex);
+    return order.size() == 4;
+  }));
+  BOOST_CHECK((order == std::vector<int>{4, 3, 2, 1}));
+}
+
+BOOST_AUTO_TEST_CASE(DeadlineCallbackRunsOnce) {
+  std::atomic<int> cancelled = 0;
+  std::atomic<int> fired = 0;
+  Scheduler scheduler(1);
+
+  auto now = DefaultTimer::now();
+  scheduler.pushCoro(WaitCoro(cancelled, 1),
+                     {.deadline = now + std::chrono::seconds(1),
+                      .on_deadline = [&fired]() { ++fired; }});
+
+  scheduler.checkDeadlines(now - std::chrono::seconds(10));
+  BOOST_CHECK_EQUAL(fired, 0);
+  scheduler.checkDeadlines(now);
+  scheduler.checkDeadlines(now);
+  BOOST_CHECK_EQUAL(fired, 1);
+}
+
+ATgBot::Coroutine AnsweringCoro(const TgBot::Api& api, int64_t user) {
+  co_await answerCallbackQuery(api, "query");
+  co_await getMessageU(user);
+}
+
+BOOST_AUTO_TEST_CASE(DeadlineCallbackSkipsAnsweredSessions) {
+  TgBot::Bot bot("token");
+  std::atomic<int> cancelled = 0;
+  std::atomic<int> fired = 0;
+  BasicScheduler<SingleThreaded> scheduler;
+
+  auto now = DefaultTimer::now();
+  SpawnOptions options{.deadline = now + std::chrono::seconds(30),
+                       .on_deadline = [&fired]() { ++fired; }};
+  scheduler.pushCoro(AnsweringCoro(bot.getApi(), 1), options);
+  scheduler.pushCoro(WaitCoro(cancelled, 2), options);
+  scheduler.runPending();
+  BOOST_CHECK_EQUAL(fired, 0);
+
+  scheduler.checkDeadlines(now + std::chrono::seconds(30));
+  BOOST_CHECK_EQUAL(fired, 1);
+}
+
+ATgBot::Coroutine FlagCoro(std::atomic<int>& received, int64_t user) {
+  co_await getMessageU(user);
+  ++received;
+  co_return;
+}
+
+TgBot::Message::Ptr makeMessage(int64_t user) {
+  auto message = std::make_shared<TgBot::Message>();
+  message->from = std::make_shared<TgBot::User>();
+  message->from->id = user;
+  message->chat = std::make_shared<TgBot::Chat>();
+  message->chat->id = user;
+  return message;
+}
+
+BOOST_AUTO_TEST_CASE(UpdatesReachOnlyTheirBot) {
+  std::atomic<int> first = 0, second = 0;
+  Scheduler scheduler(1);
+  BotId bot1 = scheduler.addBot(), bot2 = scheduler.addBot();
+  BOOST_CHECK(bot1 != bot2);
+
+  scheduler.pushCoro(FlagCoro(first, 1), {.bot = bot1});
+  scheduler.pushCoro(FlagCoro(second, 1), {.bot = bot2});
+  BOOST_REQUIRE(waitUntil([&]() {
+    return scheduler.botStats(bot1).resumed == 1 &&
+           scheduler.botStats(bot2).resumed == 1;
+  }));
+
+  scheduler.handleMessage(makeMessage(1), bot2);
+  BOOST_CHECK(waitUntil([&]() { return second == 1; }));
+  BOOST_CHECK_EQUAL(first, 0);
+  BOOST_CHECK_EQUAL(scheduler.botStats(bot1).sessions, 1);
+  BOOST_CHECK(waitUntil(
+      [&]() { return scheduler.botStats(bot2).sessions == 0; }));
+}
+
+BOOST_AUTO_TEST_CASE(TracksUpdatesUntilTheirSessionsResume) {
+  std::atomic<int> received = 0;
+  BasicScheduler<SingleThreaded> scheduler;
+  using Updates = std::vector<std::int64_t>;
+
+  {
+    auto batch = scheduler.batch();
+    batch.setUpdate(5);
+    scheduler.pushCoro(FlagCoro(received, 1));
+  }
+  BOOST_CHECK(scheduler.unfinishedUpdates() == Updates{5});
+  scheduler.runPending();
+  BOOST_CHECK(scheduler.unfinishedUpdates().empty());
+
+  //the update of a trace tag does not count, only the one of the batch
+  {
+    Trace::UpdateTag tag(3);
+    scheduler.pushCoro(FlagCoro(received, 2));
+  }
+  BOOST_CHECK(scheduler.unfinishedUpdates().empty());
+  scheduler.runPending();
+  //a session woken twice owes its resume to the lower update
+  {
+    auto batch = scheduler.batch();
+    for (std::int64_t id : {7, 6}) {
+      batch.setUpdate(id);
+      scheduler.handleMessage(makeMessage(1));
+    }
+  }
+  BOOST_CHECK(scheduler.unfinishedUpdates() == Updates{6});
+  BOOST_CHECK(scheduler.unfinishedUpdates(1).empty());
+  scheduler.runPending();
+  BOOST_CHECK_EQUAL(received, 1);
+  BOOST_CHECK(scheduler.unfinishedUpdates().empty());
+}
+
+BOOST_AUTO_TEST_CASE(BotQuotaRejectsSessions) {
+  std::atomic<int> cancelled = 0;
+  Scheduler scheduler(1);
+  BotId bot = scheduler.addBot();
+  scheduler.setBotQuota(bot, 1);
+
+  BOOST_CHECK(scheduler.pushCoro(WaitCoro(cancelled, 1), {.bot = bot}));
+  BOOST_CHECK(!scheduler.pushCoro(WaitCoro(cancelled, 2), {.bot = bot}));
+  BOOST_CHECK(scheduler.pushCoro(WaitCoro(cancelled, 3)));
+
+  auto stats = scheduler.botStats(bot);
+  BOOST_CHECK_EQUAL(stats.sessions, 1);
+  BOOST_CHECK_EQUAL(stats.spawned, 1);
+  BOOST_CHECK_EQUAL(stats.rejected, 1);
+
+  BOOST_CHECK(scheduler.drain(std::chrono::seconds(5), bot));
+  BOOST_CHECK_EQUAL(cancelled, 1);
+  BOOST_CHECK_EQUAL(scheduler.sessionCount(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(SingleThreadedRunsOnCallingThread) {
+  std::atomic<int> received = 0;
+  BasicScheduler<SingleThreaded> scheduler;
+
+  scheduler.pushCoro(FlagCoro(received, 1));
+  BOOST_CHECK_EQUAL(scheduler.sessionCount(), 1);
+  BOOST_CHECK_EQUAL(scheduler.runPending(), 1);
+  BOOST_CHECK_EQUAL(scheduler.runPending(), 0);
+
+  scheduler.handleMessage(makeMessage(2));
+  scheduler.handleMessage(makeMessage(1));
+  BOOST_CHECK_EQUAL(received, 0);
+  scheduler.runPending();
+  BOOST_CHECK_EQUAL(received, 1);
+  BOOST_CHECK_EQUAL(scheduler.sessionCount(), 0);
+}
+
+ATgBot::Coroutine ListenCoro(std::atomic<int>& received, int64_t user) {
+  while (true) {
+    co_await getMessageU(user);
+    ++received;
+  }
+}
+
+ATgBot::Coroutine AsyncCoro(std::atomic<int>& result) {
+  result = co_await makeAsync([]() { return 42; });
+  co_return;
+}
+
+BOOST_AUTO_TEST_CASE(SingleThreadedTakesWakeupsFromOtherThreads) {
+  std::atomic<int> result = 0;
+  BasicScheduler<SingleThreaded> scheduler;
+
+  scheduler.pushCoro(AsyncCoro(result));
+  BOOST_CHECK(waitUntil([&]() {
+    scheduler.runPending();
+    return result == 42;
+  }));
+  BOOST_CHECK_EQUAL(scheduler.sessionCount(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(BatchWakesEverySessionOnce) {
+  std::atomic<int> received = 0;
+  Scheduler scheduler(2);
+  for (int64_t user = 1; user <= 3; ++user)
+    scheduler.pushCoro(ListenCoro(received, user));
+  BOOST_REQUIRE(
+      waitUntil([&]() { return scheduler.botStats(0).resumed == 3; }));
+
+  {
+    auto batch = scheduler.batch();
+    for (int i = 0; i < 4; ++i)
+      for (int64_t user = 1; user <= 3; ++user)
+        scheduler.handleMessage(makeMessage(user));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    BOOST_CHECK_EQUAL(received, 0);
+  }
+
+  // every session is resumed once for its four messages
+  BOOST_CHECK(waitUntil([&]() { return received == 3; }));
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  BOOST_CHECK_EQUAL(scheduler.botStats(0).resumed, 6);
+  scheduler.drain(std::chrono::seconds(5));
+}
+
+BOOST_AUTO_TEST_CASE(DiscardedBeforeStartNeverRuns) {
+  std::atomic<int> received = 0;
+  BasicScheduler<SingleThreaded> scheduler;
+
+  auto session = scheduler.spawn(FlagCoro(received, 1));
+  BOOST_REQUIRE(session);
+  scheduler.discard(session);
+  scheduler.runPending();
+  BOOST_CHECK(!session->started());
+  BOOST_CHECK_EQUAL(scheduler.sessionCount(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(LoadLimitsRejectAndShed) {
+  std::atomic<int> cancelled = 0;
+  BasicScheduler<SingleThreaded> scheduler;
+  scheduler.setLoadLimits({.max_sessions = 3,
+                           .max_lag = std::chrono::microseconds(1),
+                           .shed_below = Priority::kNormal});
+
+  BOOST_CHECK(scheduler.pushCoro(WaitCoro(cancelled, 1)));
+  std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  scheduler.runPending();
+
+  // the last resumed session waited longer than max_lag
+  BOOST_CHECK(scheduler.pushCoro(WaitCoro(cancelled, 2)));
+  BOOST_CHECK(!scheduler.pushCoro(WaitCoro(cancelled, 3),
+                                  {.priority = Priority::kBackground}));
+  BOOST_CHECK(scheduler.pushCoro(WaitCoro(cancelled, 4),
+                                 {.priority = Priority::kHigh}));
+  BOOST_CHECK(!scheduler.pushCoro(WaitCoro(cancelled, 5),
+                                  {.priority = Priority::kCritical}));
+
+  auto stats = scheduler.loadStats();
+  BOOST_CHECK_EQUAL(stats.shed_sessions, 1);
+  BOOST_CHECK_EQUAL(stats.rejected_sessions, 1);
+  BOOST_CHECK_EQUAL(stats.pending_tasks, 2);
+  BOOST_CHECK(stats.lag > std::chrono::microseconds(1));
+  scheduler.runPending();
+  BOOST_CHECK(scheduler.loadStats().lag == DefaultTimer::duration::zero());
+  BOOST_CHECK_EQUAL(scheduler.sessionCount(), 3);
+}
+
+ATgBot::Coroutine ThreadCoro(std::thread::id& thread) {
+  thread = std::this_thread::get_id();
+  co_return;
+}
+
+BOOST_AUTO_TEST_CASE(RunInlineFinishesWithoutSession) {
+  std::thread::id thread;
+  Scheduler scheduler(1);
+
+  BOOST_CHECK(scheduler.runInline(ThreadCoro(thread)));
+  BOOST_CHECK(thread == std::this_thread::get_id());
+  BOOST_CHECK_EQUAL(scheduler.sessionCount(), 0);
+  BOOST_CHECK_EQUAL(scheduler.botStats(0).spawned, 1);
+}
+
+BOOST_AUTO_TEST_CASE(RunInlinePromotesOnSuspend) {
+  std::atomic<int> received = 0;
+  Scheduler scheduler(1);
+
+  BOOST_CHECK(scheduler.runInline(FlagCoro(received, 1)));
+  BOOST_CHECK_EQUAL(scheduler.sessionCount(), 1);
+  BOOST_CHECK(scheduler.sessionReport().sessions[0].awaiting ==
+              "getMessage");
+
+  scheduler.handleMessage(makeMessage(1));
+  BOOST_CHECK(waitUntil([&]() { return received == 1; }));
+  BOOST_CHECK(waitUntil([&]() { return scheduler.sessionCount() == 0; }));
+}
+
+ATgBot::Coroutine AsyncFirstCoro(std::atomic<int>& result) {
+  result = co_await makeAsync([]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    return 42;
+  });
+}
+
+ATgBot::Coroutine YieldCoro(std::atomic<int>& steps) {
+  ++steps;
+  co_await std::suspend_always{};
+  ++steps;
+}
+
+BOOST_AUTO_TEST_CASE(RunInlinePromotesForMakeAsync) {
+  std::atomic<int> result = 0;
+  Scheduler scheduler(1);
+
+  BOOST_CHECK(scheduler.runInline(AsyncFirstCoro(result)));
+  BOOST_CHECK(waitUntil([&]() { return result == 42; }));
+  BOOST_CHECK(waitUntil([&]() { return scheduler.sessionCount() == 0; }));
+}
+
+BOOST_AUTO_TEST_CASE(RunInlinePromotesForPlainAwait) {
+  std::atomic<int> steps = 0;
+  Scheduler scheduler(1);
+
+  BOOST_CHECK(scheduler.runInline(YieldCoro(steps)));
+  BOOST_CHECK(waitUntil([&]() { return steps == 2; }));
+  BOOST_CHECK(waitUntil([&]() { return scheduler.sessionCount() == 0; }));
+}
+
+ATgBot::Coroutine SleepCoro(std::vector<int>& order, int id,
+                            std::chrono::minutes delay) {
+  co_await waitFor(delay);
+  order.push_back(id);
+}
+
+BOOST_AUTO_TEST_CASE(SimulationJumpsToTimers) {
+  std::vector<int> order;
+  auto real_start = std::chrono::steady_clock::now();
+  BasicScheduler<Simulated> scheduler;
+  auto start = scheduler.now();
+  scheduler.pushCoro(SleepCoro(order, 1, std::chrono::minutes(10)));
+  scheduler.pushCoro(SleepCoro(order, 2, std::chrono::minutes(3)));
+
+  scheduler.advance(std::chrono::minutes(5));
+  BOOST_CHECK((order == std::vector<int>{2}));
+  BOOST_CHECK(scheduler.now() - start == std::chrono::minutes(5));
+
+  scheduler.advance(std::chrono::hours(24));
+  BOOST_CHECK((order == std::vector<int>{2, 1}));
+  BOOST_CHECK_EQUAL(scheduler.sessionCount(), 0);
+  BOOST_CHECK(std::chrono::steady_clock::now() - real_start <
+              std::chrono::seconds(5));
+}
+
+BOOST_AUTO_TEST_CASE(SimulationsKeepTheirOwnClock) {
+  std::vector<int> first_order;
+  std::vector<int> second_order;
+  BasicScheduler<Simulated> first;
+  BasicScheduler<Simulated> second;
+  auto first_start = first.now();
+  auto second_start = second.now();
+  first.pushCoro(SleepCoro(first_order, 1, std::chrono::minutes(3)));
+  second.pushCoro(SleepCoro(second_order, 2, std::chrono::minutes(3)));
+
+  first.advance(std::chrono::minutes(5));
+  BOOST_CHECK((first_order == std::vector<int>{1}));
+  BOOST_CHECK(second_order.empty());
+  BOOST_CHECK(first.now() - first_start == std::chrono::minutes(5));
+  BOOST_CHECK(second.now() == second_start);
+
+  //the rest of the process keeps the real time
+  BOOST_CHECK(DefaultTimer::now().time_since_epoch() -
+                  DefaultTimer::Base::now().time_since_epoch() <
+              std::chrono::seconds(1));
+  second.advance(std::chrono::minutes(5));
+  BOOST_CHECK((second_order == std::vector<int>{2}));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
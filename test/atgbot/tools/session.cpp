@@ -0,0 +1,81 @@
+#include <boost/test/unit_test.hpp>
+
+#include <atgbot/awaitables/idlettl.hpp>
+#include <atgbot/awaitables/message.hpp>
+#include <atgbot/tools/session.hpp>
+#include <chrono>
+#include <thread>
+
+BOOST_AUTO_TEST_SUITE(SessionTests)
+
+using namespace ATgBot::Awaitables;
+using namespace ATgBot::Tools;
+
+ATgBot::Coroutine WaitCoro(bool& cancelled) {
+  try {
+    co_await getMessageU(1);
+  } catch (const ATgBot::CancelledError&) {
+    cancelled = true;
+  }
+  co_return;
+}
+
+BOOST_AUTO_TEST_CASE(CancelWakesWaitingCoro) {
+  bool cancelled = false;
+  auto s = Session::create(WaitCoro(cancelled), [](auto r1) {}, [](auto r1) {});
+
+  s->tryResume();
+  BOOST_CHECK(s->getStatus() == Coroutine::state_type::kWait);
+  BOOST_CHECK(!s->isCancelled());
+
+  s->cancel();
+  BOOST_CHECK(s->isCancelled());
+  BOOST_CHECK(s->getStatus() == Coroutine::state_type::kReady);
+
+  s->tryResume();
+  BOOST_CHECK(cancelled);
+  BOOST_CHECK(s->getStatus() == Coroutine::state_type::kDone);
+}
+
+BOOST_AUTO_TEST_CASE(FrameSizeIsRecorded) {
+  bool cancelled = false;
+  auto s = Session::create(WaitCoro(cancelled), [](auto r1) {}, [](auto r1) {});
+  BOOST_CHECK(s->frameSize() > 0);
+}
+
+ATgBot::Coroutine TtlCoro() {
+  co_await setIdleTtl(std::chrono::seconds(5));
+  co_return;
+}
+
+BOOST_AUTO_TEST_CASE(IdleTtlOverride) {
+  auto s = Session::create(TtlCoro(), [](auto r1) {}, [](auto r1) {});
+  BOOST_CHECK(s->idleTtl() == DefaultTimer::duration::zero());
+
+  s->tryResume();
+  BOOST_CHECK(s->idleTtl() == std::chrono::seconds(5));
+  BOOST_CHECK(s->getStatus() == Coroutine::state_type::kDone);
+}
+
+BOOST_AUTO_TEST_CASE(OnlyAcceptedEventsTouchSession) {
+  bool cancelled = false;
+  auto s = Session::create(WaitCoro(cancelled), [](auto r1) {}, [](auto r1) {});
+  s->tryResume();
+  auto before = s->lastActivity();
+  std::this_thread::sleep_for(std::chrono::milliseconds(2));
+
+  auto message = std::make_shared<TgBot::Message>();
+  message->from = std::make_shared<TgBot::User>();
+  message->from->id = 2;
+  BOOST_CHECK(!s->message_queue.push(message));
+  s->execute();
+  BOOST_CHECK(!s->tryResume());
+  BOOST_CHECK(s->lastActivity() == before);
+
+  message->from->id = 1;
+  BOOST_CHECK(s->message_queue.push(message));
+  BOOST_CHECK(s->tryResume());
+  BOOST_CHECK(s->lastActivity() > before);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
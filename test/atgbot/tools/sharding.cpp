@@ -0,0 +1,110 @@
+#include <boost/test/unit_test.hpp>
+
+#include <atgbot/tools/sharding.hpp>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(ShardingTests)
+
+using namespace ATgBot::Tools;
+
+TgBot::Update::Ptr makeUpdate(std::int32_t id, std::int64_t chat) {
+  auto update = std::make_shared<TgBot::Update>();
+  update->updateId = id;
+  update->message = std::make_shared<TgBot::Message>();
+  update->message->chat = std::make_shared<TgBot::Chat>();
+  update->message->chat->id = chat;
+  return update;
+}
+
+BOOST_AUTO_TEST_CASE(PartitionsByChat) {
+  ShardIngest ingest("atgbot_test_partition", 3);
+  BOOST_CHECK_EQUAL(ShardIngest::partitionKey(makeUpdate(1, 42)), 42);
+  BOOST_CHECK_EQUAL(ingest.shardOf(makeUpdate(1, 42)),
+                    ingest.shardOf(makeUpdate(2, 42)));
+
+  auto query = std::make_shared<TgBot::Update>();
+  query->callbackQuery = std::make_shared<TgBot::CallbackQuery>();
+  query->callbackQuery->from = std::make_shared<TgBot::User>();
+  query->callbackQuery->from->id = 7;
+  BOOST_CHECK_EQUAL(ShardIngest::partitionKey(query), 7);
+
+  ShardWorker first("atgbot_test_partition", 0);
+  ShardWorker second("atgbot_test_partition", 1);
+  BOOST_CHECK(ingest.dispatch(makeUpdate(1, 0)));
+  BOOST_CHECK(ingest.dispatch(makeUpdate(2, 1)));
+  BOOST_CHECK(ingest.dispatch(makeUpdate(3, 3)));
+  BOOST_CHECK_EQUAL(first.poll(10).size(), 2);
+  BOOST_CHECK_EQUAL(second.poll(10).size(), 1);
+  BOOST_CHECK(first.poll(10).empty());
+  BOOST_CHECK_EQUAL(ingest.dispatchedCount(), 3);
+
+  BOOST_CHECK_THROW(ShardWorker("atgbot_test_partition", 3),
+                    std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE(UnacknowledgedUpdatesSurviveRestart) {
+  ShardIngest ingest("atgbot_test_restart", 1, 1024);
+  for (int id = 1; id <= 3; ++id)
+    BOOST_CHECK(ingest.dispatch(makeUpdate(id, 5)));
+  {
+    ShardWorker crashed("atgbot_test_restart", 0);
+    BOOST_CHECK_EQUAL(crashed.poll(10).size(), 3);
+    crashed.acknowledge(1);
+  }
+  ShardWorker restarted("atgbot_test_restart", 0);
+  auto updates = restarted.poll(10);
+  BOOST_REQUIRE_EQUAL(updates.size(), 2);
+  BOOST_CHECK_EQUAL(updates[0]->updateId, 2);
+  restarted.acknowledge();
+  BOOST_CHECK(restarted.poll(10).empty());
+
+  //a full ring rejects the update instead of dropping it
+  int id = 10;
+  while (ingest.dispatch(makeUpdate(id, 5)))
+    ++id;
+  BOOST_CHECK(!ingest.dispatch(makeUpdate(id, 5)));
+  auto pending = restarted.poll(1);
+  BOOST_CHECK(!ingest.dispatch(makeUpdate(id, 5)));
+  restarted.acknowledge();
+  BOOST_CHECK(ingest.dispatch(makeUpdate(id, 5)));
+  BOOST_CHECK_EQUAL(pending[0]->updateId, 10);
+  BOOST_CHECK_EQUAL(restarted.poll(100).back()->updateId, id);
+}
+
+BOOST_AUTO_TEST_CASE(CallsAreRateLimited) {
+  ShardIngest ingest("atgbot_test_calls", 2);
+  ingest.setCallRate(0.001, 2);
+  ShardWorker first("atgbot_test_calls", 0);
+  ShardWorker second("atgbot_test_calls", 1);
+  BOOST_CHECK(first.call("sendMessage", "a"));
+  BOOST_CHECK(first.call("sendMessage", "b"));
+  BOOST_CHECK(second.call("sendPhoto", "c"));
+
+  std::vector<std::string> calls;
+  auto handler = [&calls](const std::string& method, const std::string& args) {
+    calls.push_back(method + ":" + args);
+  };
+  BOOST_CHECK_EQUAL(ingest.pumpCalls(handler), 2);
+  BOOST_CHECK((calls ==
+               std::vector<std::string>{"sendMessage:a", "sendPhoto:c"}));
+  BOOST_CHECK_EQUAL(ingest.pumpCalls(handler), 0);
+}
+
+BOOST_AUTO_TEST_CASE(FailingCallsDoNotStopThePump) {
+  ShardIngest ingest("atgbot_test_failing_calls", 1);
+  ShardWorker worker("atgbot_test_failing_calls", 0);
+  BOOST_CHECK(worker.call("sendMessage", "a"));
+  BOOST_CHECK(worker.call("sendMessage", "b"));
+
+  std::vector<std::string> calls;
+  auto handler = [&calls](const std::string&, const std::string& args) {
+    calls.push_back(args);
+    throw std::runtime_error("network is down");
+  };
+  BOOST_CHECK_EQUAL(ingest.pumpCalls(handler), 2);
+  BOOST_CHECK((calls == std::vector<std::string>{"a", "b"}));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
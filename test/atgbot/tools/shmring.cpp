@@ -0,0 +1,62 @@
+#include <boost/test/unit_test.hpp>
+
+#include <atgbot/tools/shmring.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(ShmRingTests)
+
+using namespace ATgBot::Tools;
+
+BOOST_AUTO_TEST_CASE(KeepsOrder) {
+  std::vector<unsigned char> memory(ShmRing::footprint(256));
+  auto ring = ShmRing::create(memory.data(), 256);
+  BOOST_CHECK(ring.empty());
+  BOOST_CHECK(ring.push("first"));
+  BOOST_CHECK(ring.push(""));
+  BOOST_CHECK(ring.push("third"));
+
+  std::string record;
+  BOOST_CHECK(ring.pop(record) && record == "first");
+  BOOST_CHECK(ring.pop(record) && record.empty());
+  BOOST_CHECK(ring.pop(record) && record == "third");
+  BOOST_CHECK(!ring.pop(record));
+}
+
+BOOST_AUTO_TEST_CASE(RejectsWhenFullAndWraps) {
+  std::vector<unsigned char> memory(ShmRing::footprint(64));
+  auto ring = ShmRing::create(memory.data(), 64);
+  std::string record(20, 'x');
+  BOOST_CHECK(ring.push(record));
+  BOOST_CHECK(ring.push(record));
+  BOOST_CHECK(!ring.push(record));
+  BOOST_CHECK(!ring.push(std::string(100, 'y')));
+
+  std::string out;
+  for (int i = 0; i < 10; ++i) {
+    BOOST_REQUIRE(ring.pop(out));
+    BOOST_CHECK(out == record);
+    BOOST_REQUIRE(ring.push(record));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(AttachedConsumerSeesProducer) {
+  std::vector<unsigned char> memory(ShmRing::footprint(1024));
+  auto producer = ShmRing::create(memory.data(), 1024);
+  ShmRing consumer(memory.data());
+  constexpr int kRecords = 10000;
+
+  std::thread thread([&]() {
+    for (int i = 0; i < kRecords; ++i)
+      while (!producer.push(std::to_string(i))) std::this_thread::yield();
+  });
+  std::string record;
+  for (int i = 0; i < kRecords; ++i) {
+    while (!consumer.pop(record)) std::this_thread::yield();
+    BOOST_REQUIRE(record == std::to_string(i));
+  }
+  thread.join();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
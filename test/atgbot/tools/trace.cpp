@@ -0,0 +1,123 @@
+#include <boost/test/unit_test.hpp>
+
+#include <atgbot/awaitables/message.hpp>
+#include <atgbot/tools/scheduler.hpp>
+#include <atgbot/tools/trace.hpp>
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <thread>
+
+BOOST_AUTO_TEST_SUITE(TraceTests)
+
+using namespace ATgBot::Awaitables;
+using namespace ATgBot::Tools;
+
+ATgBot::Coroutine TracedCoro() {
+  co_await getMessageU(1);
+  co_return;
+}
+
+BOOST_AUTO_TEST_CASE(RecordsSessionLifecycle) {
+  BasicScheduler<SingleThreaded> scheduler;
+  Trace::start();
+  scheduler.pushCoro(TracedCoro());
+  scheduler.runPending();
+
+  auto message = std::make_shared<TgBot::Message>();
+  message->from = std::make_shared<TgBot::User>();
+  message->from->id = 1;
+  {
+    Trace::UpdateScope update(7);
+    scheduler.handleMessage(message);
+  }
+  scheduler.runPending();
+  Trace::stop();
+
+  std::ostringstream stream;
+  Trace::writeChromeJson(stream);
+  auto json = stream.str();
+  BOOST_CHECK(json.starts_with("{\"traceEvents\":["));
+  for (auto name : {"\"spawn\"", "\"enqueue\"", "\"resume\"", "\"route\"",
+                    "\"getMessage\"", "\"done\"", "\"update\":7"})
+    BOOST_CHECK_MESSAGE(json.find(name) != std::string::npos, name);
+  BOOST_CHECK_EQUAL(Trace::droppedCount(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(WorkersRecordTheUpdateOfTheSession) {
+  Scheduler scheduler(1);
+  Trace::start();
+  {
+    Trace::UpdateScope update(11);
+    scheduler.pushCoro(TracedCoro());
+  }
+  auto message = std::make_shared<TgBot::Message>();
+  message->from = std::make_shared<TgBot::User>();
+  message->from->id = 1;
+  //the router only sees the session once its worker is done with it
+  while (scheduler.sessionCount() != 0) {
+    {
+      Trace::UpdateScope update(12);
+      scheduler.handleMessage(message);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  Trace::stop();
+
+  std::ostringstream stream;
+  Trace::writeChromeJson(stream);
+  auto json = stream.str();
+  auto resumed = [&json](int update) {
+    auto tag = "\"update\":" + std::to_string(update);
+    for (auto at = json.find("\"resume\""); at != std::string::npos;
+         at = json.find("\"resume\"", at + 1))
+      if (json.compare(json.find("\"update\":", at), tag.size(), tag) == 0)
+        return true;
+    return false;
+  };
+  BOOST_CHECK(resumed(11));
+  BOOST_CHECK(resumed(12));
+  BOOST_CHECK(json.find("\"name\":\"done\",\"ph\":\"i\"") !=
+              std::string::npos);
+  BOOST_CHECK(!resumed(0));
+}
+
+BOOST_AUTO_TEST_CASE(StoppedTraceRecordsNothing) {
+  Trace::start();
+  Trace::stop();
+  Trace::instant("ignored");
+
+  std::ostringstream stream;
+  Trace::writeChromeJson(stream);
+  BOOST_CHECK(stream.str().find("ignored") == std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(FullBufferDropsEvents) {
+  Trace::start(2);
+  for (int i = 0; i < 5; ++i)
+    Trace::instant("event");
+  Trace::stop();
+  BOOST_CHECK_EQUAL(Trace::droppedCount(), 3);
+}
+
+BOOST_AUTO_TEST_CASE(ShortThreadsReuseBuffers) {
+  Trace::start(16);
+  std::thread([]() { Trace::instant("first"); }).join();
+  auto buffers = Trace::bufferCount();
+  for (int i = 0; i < 8; ++i)
+    std::thread([]() { Trace::instant("later"); }).join();
+  Trace::stop();
+
+  BOOST_CHECK_EQUAL(Trace::bufferCount(), buffers);
+  std::ostringstream stream;
+  Trace::writeChromeJson(stream);
+  auto json = stream.str();
+  BOOST_CHECK(json.find("\"first\"") != std::string::npos);
+  std::size_t later = 0;
+  for (auto at = json.find("\"later\""); at != std::string::npos;
+       at = json.find("\"later\"", at + 1))
+    ++later;
+  BOOST_CHECK_EQUAL(later, 8u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
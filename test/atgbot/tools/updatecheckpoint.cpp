@@ -0,0 +1,75 @@
+#include <boost/test/unit_test.hpp>
+
+#include <atgbot/tools/updatecheckpoint.hpp>
+#include <atgbot/tools/updatewindow.hpp>
+#include <filesystem>
+#include <fstream>
+
+BOOST_AUTO_TEST_SUITE(UpdateCheckpointTests)
+
+using namespace ATgBot::Tools;
+
+BOOST_AUTO_TEST_CASE(WindowDropsDuplicates) {
+  UpdateIdWindow window;
+  BOOST_CHECK(window.insert(10));
+  BOOST_CHECK(window.insert(11));
+  BOOST_CHECK(!window.insert(10));
+  BOOST_CHECK(window.contains(11));
+  BOOST_CHECK(!window.contains(12));
+}
+
+BOOST_AUTO_TEST_CASE(WindowSlides) {
+  UpdateIdWindow window;
+  BOOST_CHECK(window.insert(1));
+  BOOST_CHECK(window.insert(1 + UpdateIdWindow::kSize));
+  BOOST_CHECK(window.base() == 2);
+  //ids older than the window are treated as duplicates
+  BOOST_CHECK(!window.insert(1));
+  BOOST_CHECK(window.insert(2));
+  BOOST_CHECK(window.insert(10 * UpdateIdWindow::kSize));
+  BOOST_CHECK(!window.contains(10 * UpdateIdWindow::kSize - 1));
+  window.erase(10 * UpdateIdWindow::kSize);
+  BOOST_CHECK(window.insert(10 * UpdateIdWindow::kSize));
+}
+
+BOOST_AUTO_TEST_CASE(CheckpointSurvivesReopen) {
+  auto path = (std::filesystem::temp_directory_path() / "atgbot_checkpoint")
+                  .string();
+  std::filesystem::remove(path);
+  {
+    UpdateCheckpoint checkpoint(path);
+    BOOST_CHECK_EQUAL(checkpoint.offset(), 0);
+
+    UpdateIdWindow window;
+    window.insert(41);
+    window.insert(42);
+    checkpoint.commit(43, window);
+    BOOST_CHECK_EQUAL(checkpoint.offset(), 43);
+    checkpoint.commit(40, window);
+    BOOST_CHECK_EQUAL(checkpoint.offset(), 43);
+  }
+  BOOST_CHECK(!std::filesystem::exists(path + ".tmp"));
+  {
+    UpdateCheckpoint checkpoint(path);
+    BOOST_CHECK_EQUAL(checkpoint.offset(), 43);
+    auto window = checkpoint.window();
+    BOOST_CHECK(!window.insert(42));
+    BOOST_CHECK(window.insert(43));
+  }
+  std::filesystem::remove(path);
+}
+
+BOOST_AUTO_TEST_CASE(CheckpointIgnoresForeignFiles) {
+  auto path = (std::filesystem::temp_directory_path() / "atgbot_checkpoint")
+                  .string();
+  std::ofstream(path, std::ios::binary) << "not a checkpoint";
+  {
+    UpdateCheckpoint checkpoint(path);
+    BOOST_CHECK_EQUAL(checkpoint.offset(), 0);
+    checkpoint.commit(7, UpdateIdWindow());
+  }
+  BOOST_CHECK_EQUAL(UpdateCheckpoint(path).offset(), 7);
+  std::filesystem::remove(path);
+}
+
+BOOST_AUTO_TEST_SUITE_END()